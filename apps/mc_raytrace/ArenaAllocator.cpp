@@ -0,0 +1,47 @@
+#include <algorithm>
+#include "ArenaAllocator.h"
+
+ArenaAllocator::ArenaAllocator(size_t initialSize) {
+    addBlock(initialSize);
+}
+
+void* ArenaAllocator::allocate(size_t size, size_t alignment) {
+    Block* block = &blocks.back();
+    uintptr_t base = reinterpret_cast<uintptr_t>(block->data.get());
+    size_t aligned = ((base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+    if (aligned + size > block->size) {
+        addBlock(std::max(size + alignment, block->size * 2));
+        block = &blocks.back();
+        base = reinterpret_cast<uintptr_t>(block->data.get());
+        aligned = ((base + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+    }
+
+    offset = aligned + size;
+    usedBytes += size;
+    peakBytes = std::max(peakBytes, usedBytes);
+    return block->data.get() + aligned;
+}
+
+void ArenaAllocator::reset() {
+    if (blocks.size() > 1) {
+        // Merge into a single block, with some slack for alignment padding
+        size_t size = std::max(blocks.back().size, peakBytes + peakBytes / 4);
+        blocks.clear();
+        addBlock(size);
+    }
+    offset = 0;
+    usedBytes = 0;
+}
+
+size_t ArenaAllocator::capacity() const {
+    size_t bytes = 0;
+    for (const Block& block : blocks) {
+        bytes += block.size;
+    }
+    return bytes;
+}
+
+void ArenaAllocator::addBlock(size_t minSize) {
+    blocks.push_back({ std::unique_ptr<uint8_t[]>(new uint8_t[minSize]), minSize });
+    offset = 0;
+}
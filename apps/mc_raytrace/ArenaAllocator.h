@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Bump allocator that is reset as a whole.
+// Memory comes from a list of blocks, on reset the blocks are merged into one block
+// large enough for the previous peak so steady state use does not touch the heap.
+// Not thread safe, meant to be owned by a single thread.
+class ArenaAllocator {
+	public:
+		explicit ArenaAllocator(size_t initialSize = 256 * 1024);
+
+		ArenaAllocator(const ArenaAllocator&) = delete;
+		ArenaAllocator& operator=(const ArenaAllocator&) = delete;
+
+		void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+		void reset();
+
+		// Bytes handed out since the last reset
+		size_t used() const { return usedBytes; }
+		size_t capacity() const;
+	private:
+		struct Block {
+			std::unique_ptr<uint8_t[]> data;
+			size_t size;
+		};
+
+		void addBlock(size_t minSize);
+
+		std::vector<Block> blocks;
+		size_t offset = 0; // into blocks.back()
+		size_t usedBytes = 0;
+		size_t peakBytes = 0;
+};
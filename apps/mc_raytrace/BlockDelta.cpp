@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <iostream>
+#include <string_view>
+#include "BlockDelta.h"
+#include "BlockStateRegistry.h"
+#include "NbtReader.h"
+
+bool BlockDelta::parse(const uint8_t* data, size_t size, BlockDelta& delta) {
+    // Same primitive encoding as NBT, no tags involved
+    nbt::Reader reader(data, size);
+
+    // Registry ids are never given back, so states are only interned once the whole batch
+    // checked out. Until then edits hold indices into the batch's list.
+    uint16_t stateCount = static_cast<uint16_t>(reader.i16());
+    std::vector<std::string_view> names(stateCount);
+    for (std::string_view& name : names) {
+        name = reader.string();
+    }
+
+    int32_t chunkCount = reader.i32();
+    if (!reader.ok() || chunkCount < 0) {
+        return false;
+    }
+    delta.chunks.clear();
+    delta.chunks.reserve(std::min<size_t>(static_cast<size_t>(chunkCount), size / 12));
+
+    for (int32_t i = 0; i < chunkCount && reader.ok(); ++i) {
+        ChunkEdits& chunk = delta.chunks.emplace_back();
+        chunk.pos.x = reader.i32();
+        chunk.pos.z = reader.i32();
+        int32_t editCount = reader.i32();
+        if (editCount < 0) {
+            return false;
+        }
+        chunk.edits.reserve(std::min<size_t>(static_cast<size_t>(editCount), size / 5));
+
+        for (int32_t e = 0; e < editCount && reader.ok(); ++e) {
+            Edit edit;
+            edit.sectionY = static_cast<int8_t>(reader.u8());
+            edit.index = static_cast<uint16_t>(reader.i16());
+            uint16_t state = static_cast<uint16_t>(reader.i16());
+            if (edit.index >= SECTION_VOLUME || state >= names.size()) {
+                return false;
+            }
+            edit.state = state;
+            chunk.edits.push_back(edit);
+        }
+    }
+    if (!reader.ok()) {
+        return false;
+    }
+
+    BlockStateRegistry& registry = BlockStateRegistry::instance();
+    std::vector<uint16_t> states(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        states[i] = registry.idFromString(names[i]);
+    }
+    for (ChunkEdits& chunk : delta.chunks) {
+        for (Edit& edit : chunk.edits) {
+            edit.state = states[edit.state];
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<Chunk> applyEdits(const Chunk& chunk, std::vector<BlockDelta::Edit> edits, std::vector<int32_t>& touchedSections) {
+    auto edited = std::make_shared<Chunk>();
+    edited->pos = chunk.pos;
+    edited->dataVersion = chunk.dataVersion;
+    std::copy(std::begin(chunk.heightmaps), std::end(chunk.heightmaps), std::begin(edited->heightmaps));
+    // Lazy sections get decoded here, edits are rare enough compared to loads
+    edited->sections.reserve(chunk.sectionCount() + 1);
+    for (size_t i = 0; i < chunk.sectionCount(); ++i) {
+        edited->sections.push_back(chunk.sectionAt(i));
+    }
+
+    // Stable so repeated edits of one block keep their order
+    std::stable_sort(edits.begin(), edits.end(),
+        [](const BlockDelta::Edit& a, const BlockDelta::Edit& b) { return a.sectionY < b.sectionY; });
+
+    for (size_t begin = 0; begin < edits.size();) {
+        int32_t y = edits[begin].sectionY;
+        auto it = std::lower_bound(edited->sections.begin(), edited->sections.end(), y,
+            [](const std::shared_ptr<const Section>& section, int32_t sectionY) { return section->y < sectionY; });
+
+        // Copy on write, the old section may still be used by readers of the previous version
+        std::shared_ptr<Section> section;
+        if (it != edited->sections.end() && (*it)->y == y) {
+            section = std::make_shared<Section>(**it);
+        }
+        else {
+            section = std::make_shared<Section>();
+            section->y = y;
+            section->generation = Section::nextGeneration();
+            section->palette.push_back(BlockStateRegistry::AIR);
+            it = edited->sections.insert(it, nullptr);
+        }
+
+        size_t end = begin;
+        for (; end < edits.size() && edits[end].sectionY == y; ++end) {
+            section->set(edits[end].index, edits[end].state);
+        }
+        *it = std::move(section);
+        touchedSections.push_back(y);
+        begin = end;
+    }
+
+    // Rescan the columns that were edited
+    uint64_t columns[SECTION_SIZE * SECTION_SIZE / 64] = {};
+    for (const BlockDelta::Edit& edit : edits) {
+        uint32_t column = edit.index & (SECTION_SIZE * SECTION_SIZE - 1);
+        columns[column >> 6] |= uint64_t(1) << (column & 63);
+    }
+    for (uint32_t column = 0; column < SECTION_SIZE * SECTION_SIZE; ++column) {
+        if ((columns[column >> 6] >> (column & 63)) & 1) {
+            for (size_t type = 0; type < static_cast<size_t>(HeightmapType::Count); ++type) {
+                edited->heightmaps[type].update(*edited, static_cast<HeightmapType>(type), column % SECTION_SIZE, column / SECTION_SIZE);
+            }
+        }
+    }
+    return edited;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "DataStructures.h"
+
+// Batched block edits, the payload of updateData. All values are big endian, as written by
+// java.io.DataOutputStream:
+//
+//   u16 stateCount
+//   stateCount x { u16 length, utf-8 block state "namespace:block[key=value,...]" }
+//   i32 chunkCount
+//   chunkCount x { i32 chunkX, i32 chunkZ, i32 editCount,
+//                  editCount x { i8 sectionY, u16 index (y * 256 + z * 16 + x), u16 state } }
+//
+// state indexes the batch's block state list, so ids never have to be agreed on with Java.
+// Later edits to the same block win.
+struct BlockDelta {
+    struct Edit {
+        int32_t sectionY;
+        uint16_t index;
+        uint16_t state; // global block state id once parsed
+    };
+    struct ChunkEdits {
+        ChunkPos pos;
+        std::vector<Edit> edits;
+    };
+
+    std::vector<ChunkEdits> chunks;
+
+    // Resolves block states through the registry once the whole batch is known to be well
+    // formed. Returns false on malformed data, nothing is interned then.
+    static bool parse(const uint8_t* data, size_t size, BlockDelta& delta);
+};
+
+// Copy of chunk with the edits applied. Only touched sections are copied, the y of each is
+// appended to touchedSections.
+std::shared_ptr<Chunk> applyEdits(const Chunk& chunk, std::vector<BlockDelta::Edit> edits, std::vector<int32_t>& touchedSections);
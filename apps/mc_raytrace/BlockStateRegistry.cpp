@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <iostream>
+#include "BlockStateRegistry.h"
+
+namespace {
+    constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+    constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+    uint64_t hashBytes(uint64_t hash, std::string_view bytes) {
+        for (char c : bytes) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * FNV_PRIME;
+        }
+        return hash;
+    }
+
+    // Properties must be sorted by name
+    uint64_t hashState(std::string_view name, const BlockProperty* properties, size_t numProperties) {
+        uint64_t hash = hashBytes(FNV_OFFSET, name);
+        for (size_t i = 0; i < numProperties; ++i) {
+            hash = hashBytes((hash ^ '[') * FNV_PRIME, properties[i].name);
+            hash = hashBytes((hash ^ '=') * FNV_PRIME, properties[i].value);
+        }
+        return hash;
+    }
+
+    // Block states have at most a handful of properties, sort a copy on the stack
+    constexpr size_t MAX_PROPERTIES = 16;
+}
+
+BlockStateRegistry::Table::Table(size_t capacity)
+    : mask(capacity - 1), slots(new std::atomic<uint32_t>[capacity]) {
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+BlockStateRegistry& BlockStateRegistry::instance() {
+    static BlockStateRegistry registry;
+    return registry;
+}
+
+BlockStateRegistry::BlockStateRegistry() {
+    tables.push_back(std::make_unique<Table>(1024));
+    table.store(tables.back().get(), std::memory_order_release);
+    id("minecraft:air");
+}
+
+BlockStateRegistry::~BlockStateRegistry() {
+    for (auto& page : pages) {
+        delete[] page.load();
+    }
+}
+
+uint16_t BlockStateRegistry::id(std::string_view name, const BlockProperty* properties, size_t numProperties) {
+    BlockProperty sorted[MAX_PROPERTIES];
+    numProperties = std::min(numProperties, MAX_PROPERTIES);
+    std::copy(properties, properties + numProperties, sorted);
+    std::sort(sorted, sorted + numProperties,
+        [](const BlockProperty& a, const BlockProperty& b) { return a.name < b.name; });
+
+    uint64_t hash = hashState(name, sorted, numProperties);
+    int32_t found = find(*table.load(std::memory_order_acquire), hash, name, sorted, numProperties);
+    if (found >= 0) {
+        return static_cast<uint16_t>(found);
+    }
+
+    std::lock_guard lock(writeMutex);
+    found = find(*table.load(std::memory_order_acquire), hash, name, sorted, numProperties);
+    if (found >= 0) {
+        return static_cast<uint16_t>(found);
+    }
+
+    size_t newId = numStates.load(std::memory_order_relaxed);
+    if (newId >= MAX_STATES) {
+        std::cerr << "Block state registry is full, " << name << " is mapped to air" << std::endl;
+        return AIR;
+    }
+
+    BlockState* page = pages[newId / STATES_PER_PAGE].load(std::memory_order_relaxed);
+    if (page == nullptr) {
+        page = new BlockState[STATES_PER_PAGE];
+        pages[newId / STATES_PER_PAGE].store(page, std::memory_order_release);
+    }
+    BlockState& state = page[newId % STATES_PER_PAGE];
+    state.name = name;
+    state.canonical = name;
+    for (size_t i = 0; i < numProperties; ++i) {
+        state.properties.emplace_back(sorted[i].name, sorted[i].value);
+        state.canonical += (i == 0 ? "[" : ",");
+        state.canonical.append(sorted[i].name).append("=").append(sorted[i].value);
+    }
+    if (numProperties) {
+        state.canonical += "]";
+    }
+    state.hash = hash;
+    numStates.store(newId + 1, std::memory_order_release);
+
+    // Keep the load factor under one half
+    if ((newId + 1) * 2 > table.load(std::memory_order_relaxed)->mask + 1) {
+        grow();
+    }
+    else {
+        insertSlot(*table.load(std::memory_order_relaxed), hash, static_cast<uint16_t>(newId));
+    }
+    return static_cast<uint16_t>(newId);
+}
+
+uint16_t BlockStateRegistry::idFromString(std::string_view state) {
+    size_t open = state.find('[');
+    if (open == std::string_view::npos || state.back() != ']') {
+        return id(state);
+    }
+
+    BlockProperty properties[MAX_PROPERTIES];
+    size_t numProperties = 0;
+    std::string_view list = state.substr(open + 1, state.size() - open - 2);
+    while (!list.empty() && numProperties < MAX_PROPERTIES) {
+        size_t comma = list.find(',');
+        std::string_view property = list.substr(0, comma);
+        size_t equals = property.find('=');
+        if (equals != std::string_view::npos) {
+            properties[numProperties++] = { property.substr(0, equals), property.substr(equals + 1) };
+        }
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+    }
+    return id(state.substr(0, open), properties, numProperties);
+}
+
+const BlockState& BlockStateRegistry::state(uint16_t id) const {
+    if (id >= size()) {
+        id = AIR;
+    }
+    return pages[id / STATES_PER_PAGE].load(std::memory_order_acquire)[id % STATES_PER_PAGE];
+}
+
+std::string BlockStateRegistry::name(uint16_t id) const {
+    return state(id).canonical;
+}
+
+int32_t BlockStateRegistry::find(const Table& table, uint64_t hash, std::string_view name, const BlockProperty* properties, size_t numProperties) const {
+    for (size_t slot = hash & table.mask;; slot = (slot + 1) & table.mask) {
+        uint32_t entry = table.slots[slot].load(std::memory_order_acquire);
+        if (entry == 0) {
+            return -1;
+        }
+
+        const BlockState& candidate = state(static_cast<uint16_t>(entry - 1));
+        if (candidate.hash != hash || candidate.name != name || candidate.properties.size() != numProperties) {
+            continue;
+        }
+        bool equal = true;
+        for (size_t i = 0; i < numProperties && equal; ++i) {
+            equal = candidate.properties[i].first == properties[i].name && candidate.properties[i].second == properties[i].value;
+        }
+        if (equal) {
+            return static_cast<int32_t>(entry - 1);
+        }
+    }
+}
+
+void BlockStateRegistry::insertSlot(Table& table, uint64_t hash, uint16_t id) {
+    size_t slot = hash & table.mask;
+    while (table.slots[slot].load(std::memory_order_relaxed) != 0) {
+        slot = (slot + 1) & table.mask;
+    }
+    table.slots[slot].store(static_cast<uint32_t>(id) + 1, std::memory_order_release);
+}
+
+// Rehash into a table twice the size and publish it, writeMutex must be held
+void BlockStateRegistry::grow() {
+    auto bigger = std::make_unique<Table>((table.load(std::memory_order_relaxed)->mask + 1) * 2);
+    size_t count = numStates.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        insertSlot(*bigger, state(static_cast<uint16_t>(i)).hash, static_cast<uint16_t>(i));
+    }
+    table.store(bigger.get(), std::memory_order_release);
+    tables.push_back(std::move(bigger));
+}
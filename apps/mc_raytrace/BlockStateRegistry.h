@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct BlockProperty {
+    std::string_view name;
+    std::string_view value;
+};
+
+// An interned block state, e.g. minecraft:oak_log with axis=y
+struct BlockState {
+    std::string name;                                        // namespace id
+    std::vector<std::pair<std::string, std::string>> properties; // sorted by name
+    std::string canonical;                                   // "minecraft:oak_log[axis=y]"
+    uint64_t hash;
+};
+
+// Process wide mapping between block states and dense uint16_t ids.
+// Id 0 is always "minecraft:air".
+// Lookups of known states are lock free: they probe an open addressing table that is only
+// ever replaced, never modified in place, except for filling empty slots.
+class BlockStateRegistry {
+	public:
+		static constexpr uint16_t AIR = 0;
+		static constexpr size_t MAX_STATES = UINT16_MAX + 1;
+
+		static BlockStateRegistry& instance();
+		~BlockStateRegistry();
+
+		// Returns the id of the state, registering it if needed. Property order does not matter.
+		uint16_t id(std::string_view name, const BlockProperty* properties = nullptr, size_t numProperties = 0);
+		// Parses "namespace:block[key=value,...]"
+		uint16_t idFromString(std::string_view state);
+
+		const BlockState& state(uint16_t id) const;
+		std::string name(uint16_t id) const;
+		size_t size() const { return numStates.load(std::memory_order_acquire); }
+	private:
+		static constexpr size_t STATES_PER_PAGE = 256;
+
+		struct Table {
+			explicit Table(size_t capacity);
+			size_t mask;
+			std::unique_ptr<std::atomic<uint32_t>[]> slots; // state id + 1, 0 is empty
+		};
+
+		BlockStateRegistry();
+
+		int32_t find(const Table& table, uint64_t hash, std::string_view name, const BlockProperty* properties, size_t numProperties) const;
+		void insertSlot(Table& table, uint64_t hash, uint16_t id);
+		void grow();
+
+		std::array<std::atomic<BlockState*>, MAX_STATES / STATES_PER_PAGE> pages{};
+		std::atomic<size_t> numStates{ 0 };
+		std::atomic<Table*> table{ nullptr };
+		std::vector<std::unique_ptr<Table>> tables; // every table ever published, readers may still use old ones
+		std::mutex writeMutex;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "DataStructures.h"
+
+struct ChangeEvent {
+    enum class Type : uint8_t {
+        ChunkLoaded,    // new or reloaded chunk, every section changed
+        ChunkUnloaded,
+        SectionChanged, // block edits, see Section::generation
+    };
+
+    Type type;
+    SectionPos pos;      // y is only meaningful for SectionChanged
+    uint64_t generation; // of the changed section, 0 for chunk events
+};
+
+// Bounded lock free multi producer, multi consumer queue of world changes
+// (Vyukov's array based MPMC queue). Producers never block: when the queue is full the event
+// is dropped and the overflow flag is raised, consumers then have to rescan the whole world.
+// Every event is handed to exactly one consumer, so drain once per frame and fan out from there.
+class ChangeJournal {
+	public:
+		// capacity is rounded up to a power of two
+		explicit ChangeJournal(size_t capacity = 1 << 16);
+
+		ChangeJournal(const ChangeJournal&) = delete;
+		ChangeJournal& operator=(const ChangeJournal&) = delete;
+
+		// False if the journal was full and the event was dropped
+		bool push(const ChangeEvent& event);
+		bool pop(ChangeEvent& event);
+
+		// Appends every queued event to events. Returns true if events were lost since the
+		// previous drain, the overflow flag is cleared.
+		bool drain(std::vector<ChangeEvent>& events);
+	private:
+		struct alignas(64) Cell {
+			std::atomic<size_t> sequence;
+			ChangeEvent event;
+		};
+
+		std::unique_ptr<Cell[]> cells;
+		size_t mask;
+		alignas(64) std::atomic<size_t> enqueuePos{ 0 };
+		alignas(64) std::atomic<size_t> dequeuePos{ 0 };
+		alignas(64) std::atomic<bool> overflowed{ false };
+};
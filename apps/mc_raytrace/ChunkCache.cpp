@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "ChunkCache.h"
+#include "BlockStateRegistry.h"
+
+using namespace chunkcache;
+
+namespace {
+    size_t padded(size_t size) {
+        return (size + 7) & ~size_t(7);
+    }
+
+    // Widths Section packs with, one palette entry needs no data at all
+    bool validBits(uint8_t bits, uint16_t paletteSize) {
+        switch (bits) {
+        case 0:
+            return paletteSize == 1;
+        case 1: case 2: case 4: case 8: case 16:
+            return paletteSize <= (1u << bits);
+        default:
+            return false;
+        }
+    }
+
+    // Slots past the end of the palette read as its first entry, like the NBT decoders do
+    void clampSlots(std::vector<uint64_t>& data, uint32_t bits, uint16_t paletteSize) {
+        uint32_t perWord = 64 / bits;
+        uint64_t mask = (uint64_t(1) << bits) - 1;
+        for (uint64_t& word : data) {
+            for (uint32_t i = 0; i < perWord; ++i) {
+                uint32_t shift = i * bits;
+                if (((word >> shift) & mask) >= paletteSize) {
+                    word &= ~(mask << shift);
+                }
+            }
+        }
+    }
+}
+
+bool ChunkCache::open(const std::string& path) {
+    close();
+    if (!file.open(path)) {
+        return false;
+    }
+
+    const uint8_t* data = file.data();
+    if (file.size() < sizeof(Header)) {
+        std::cerr << path << " is not a chunk cache" << std::endl;
+        close();
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.fileSize != file.size()) {
+        std::cerr << path << " is not a version " << VERSION << " chunk cache, bake it again" << std::endl;
+        close();
+        return false;
+    }
+    if (header.indexOffset % alignof(IndexEntry) != 0 ||
+        header.indexOffset + uint64_t(header.chunkCount) * sizeof(IndexEntry) > file.size() ||
+        header.stateTableOffset > header.indexOffset) {
+        std::cerr << path << " has a damaged index" << std::endl;
+        close();
+        return false;
+    }
+    index = reinterpret_cast<const IndexEntry*>(data + header.indexOffset);
+
+    BlockStateRegistry& registry = BlockStateRegistry::instance();
+    size_t pos = header.stateTableOffset;
+    stateIds.reserve(header.stateCount);
+    for (uint32_t i = 0; i < header.stateCount; ++i) {
+        uint16_t length;
+        if (pos + sizeof(length) > header.indexOffset) {
+            break;
+        }
+        std::memcpy(&length, data + pos, sizeof(length));
+        pos += sizeof(length);
+        if (pos + length > header.indexOffset) {
+            break;
+        }
+        stateIds.push_back(registry.idFromString(std::string_view(reinterpret_cast<const char*>(data + pos), length)));
+        pos += length;
+    }
+    if (stateIds.size() != header.stateCount) {
+        std::cerr << path << " has a damaged block state table" << std::endl;
+        close();
+        return false;
+    }
+
+    // Chunks are loaded in camera order, not file order
+    file.adviseRandom();
+    return true;
+}
+
+void ChunkCache::close() {
+    file.close();
+    header = {};
+    index = nullptr;
+    stateIds.clear();
+}
+
+int64_t ChunkCache::find(ChunkPos pos) const {
+    const IndexEntry* end = index + size();
+    const IndexEntry* it = std::lower_bound(index, end, pos, [](const IndexEntry& entry, ChunkPos key) {
+        return entry.x < key.x || (entry.x == key.x && entry.z < key.z);
+    });
+    return it != end && it->x == pos.x && it->z == pos.z ? it - index : -1;
+}
+
+std::shared_ptr<Chunk> ChunkCache::load(ChunkPos pos) const {
+    int64_t i = find(pos);
+    return i >= 0 ? load(static_cast<size_t>(i)) : nullptr;
+}
+
+std::shared_ptr<Chunk> ChunkCache::load(size_t i) const {
+    if (i >= size()) {
+        return nullptr;
+    }
+    const IndexEntry& entry = index[i];
+    const uint8_t* data = file.data();
+    size_t pos = entry.offset;
+
+    auto chunk = std::make_shared<Chunk>();
+    chunk->pos = { entry.x, entry.z };
+    chunk->dataVersion = entry.dataVersion;
+    // A damaged count must not reserve more records than the file holds
+    chunk->sections.reserve(std::min<size_t>(entry.sectionCount, header.stateTableOffset / sizeof(SectionRecord)));
+    for (uint32_t s = 0; s < entry.sectionCount; ++s) {
+        SectionRecord record;
+        if (pos + sizeof(record) > header.stateTableOffset) {
+            return nullptr;
+        }
+        std::memcpy(&record, data + pos, sizeof(record));
+        pos += sizeof(record);
+
+        size_t paletteBytes = padded(record.paletteSize * sizeof(uint16_t));
+        size_t dataBytes = size_t(record.dataWords) * sizeof(uint64_t);
+        if (!validBits(record.bitsPerBlock, record.paletteSize) || record.dataWords != SECTION_VOLUME * record.bitsPerBlock / 64 ||
+            pos + paletteBytes + dataBytes > header.stateTableOffset) {
+            return nullptr;
+        }
+
+        auto section = std::make_shared<Section>();
+        section->y = record.y;
+        section->generation = Section::nextGeneration();
+        section->bitsPerBlock = record.bitsPerBlock;
+        section->palette.resize(record.paletteSize);
+        std::memcpy(section->palette.data(), data + pos, record.paletteSize * sizeof(uint16_t));
+        for (uint16_t& state : section->palette) {
+            state = state < stateIds.size() ? stateIds[state] : BlockStateRegistry::AIR;
+        }
+        pos += paletteBytes;
+        section->data.resize(record.dataWords);
+        std::memcpy(section->data.data(), data + pos, dataBytes);
+        pos += dataBytes;
+        if (record.bitsPerBlock && record.paletteSize < (1u << record.bitsPerBlock)) {
+            clampSlots(section->data, record.bitsPerBlock, record.paletteSize);
+        }
+
+        chunk->sections.push_back(std::move(section));
+    }
+    // Not baked, rebuilt from the sections
+    for (size_t type = 0; type < static_cast<size_t>(HeightmapType::Count); ++type) {
+        chunk->heightmaps[type] = Heightmap::compute(*chunk, static_cast<HeightmapType>(type));
+    }
+    return chunk;
+}
+
+bool ChunkCacheWriter::open(const std::string& path) {
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to create " << path << std::endl;
+        return false;
+    }
+    // Header is rewritten by finish()
+    Header header = {};
+    write(&header, sizeof(header));
+    entries.clear();
+    fileStateOf.assign(BlockStateRegistry::MAX_STATES, -1);
+    fileStates.clear();
+    return true;
+}
+
+bool ChunkCacheWriter::add(const Chunk& chunk) {
+    IndexEntry entry = { chunk.pos.x, chunk.pos.z, chunk.dataVersion, static_cast<uint32_t>(chunk.sectionCount()), offset };
+
+    std::vector<uint16_t> palette;
+    for (size_t i = 0; i < chunk.sectionCount(); ++i) {
+        std::shared_ptr<const Section> section = chunk.sectionAt(i);
+
+        palette.clear();
+        for (uint16_t state : section->palette) {
+            if (fileStateOf[state] < 0) {
+                fileStateOf[state] = static_cast<int32_t>(fileStates.size());
+                fileStates.push_back(state);
+            }
+            palette.push_back(static_cast<uint16_t>(fileStateOf[state]));
+        }
+
+        SectionRecord record = {};
+        record.y = section->y;
+        record.paletteSize = static_cast<uint16_t>(palette.size());
+        record.bitsPerBlock = section->bitsPerBlock;
+        record.dataWords = static_cast<uint32_t>(section->data.size());
+        write(&record, sizeof(record));
+        write(palette.data(), palette.size() * sizeof(uint16_t));
+        pad();
+        write(section->data.data(), section->data.size() * sizeof(uint64_t));
+    }
+    entries.push_back(entry);
+    return static_cast<bool>(out);
+}
+
+bool ChunkCacheWriter::finish() {
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.chunkCount = static_cast<uint32_t>(entries.size());
+    header.stateCount = static_cast<uint32_t>(fileStates.size());
+
+    header.stateTableOffset = offset;
+    BlockStateRegistry& registry = BlockStateRegistry::instance();
+    for (uint16_t state : fileStates) {
+        std::string name = registry.name(state);
+        uint16_t length = static_cast<uint16_t>(name.size());
+        write(&length, sizeof(length));
+        write(name.data(), name.size());
+    }
+    pad();
+
+    // Later copies of a chunk replace earlier ones
+    std::stable_sort(entries.begin(), entries.end(), [](const IndexEntry& a, const IndexEntry& b) {
+        return a.x < b.x || (a.x == b.x && a.z < b.z);
+    });
+    auto last = std::unique(entries.rbegin(), entries.rend(), [](const IndexEntry& a, const IndexEntry& b) {
+        return a.x == b.x && a.z == b.z;
+    });
+    entries.erase(entries.begin(), last.base());
+    header.chunkCount = static_cast<uint32_t>(entries.size());
+
+    header.indexOffset = offset;
+    write(entries.data(), entries.size() * sizeof(IndexEntry));
+    header.fileSize = offset;
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    return !out.fail();
+}
+
+void ChunkCacheWriter::write(const void* data, size_t size) {
+    out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    offset += size;
+}
+
+void ChunkCacheWriter::pad() {
+    static const uint8_t zeros[8] = {};
+    write(zeros, padded(offset) - offset);
+}
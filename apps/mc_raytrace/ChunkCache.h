@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "DataStructures.h"
+#include "MappedFile.h"
+
+// Pre-baked chunks, written by the prebake tool and memory mapped by the library.
+// Sections are stored palette packed exactly like Section, so loading a chunk is a few copies
+// instead of inflating and parsing NBT. Files are little endian and meant for the machine
+// that baked them.
+//
+//   Header
+//   chunk records, 8 byte aligned:
+//     sectionCount x { SectionRecord, u16 palette[paletteSize] padded to 8 bytes, u64 data[dataWords] }
+//   block state table: stateCount x { u16 length, utf-8 "namespace:block[key=value,...]" }
+//   index: chunkCount x IndexEntry sorted by (x, z)
+//
+// Palettes index the file's block state table, ids are remapped to the registry on open.
+namespace chunkcache {
+    constexpr char MAGIC[8] = { 'M', 'C', 'R', 'T', 'C', 'A', 'C', 'H' };
+    constexpr uint32_t VERSION = 1;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t chunkCount;
+        uint32_t stateCount;
+        uint32_t reserved;
+        uint64_t stateTableOffset;
+        uint64_t indexOffset;
+        uint64_t fileSize;
+    };
+    static_assert(sizeof(Header) == 48, "cache header layout");
+
+    struct IndexEntry {
+        int32_t x;
+        int32_t z;
+        int32_t dataVersion;
+        uint32_t sectionCount;
+        uint64_t offset;
+    };
+    static_assert(sizeof(IndexEntry) == 24, "cache index layout");
+
+    struct SectionRecord {
+        int32_t y;
+        uint16_t paletteSize;
+        uint8_t bitsPerBlock;
+        uint8_t reserved;
+        uint32_t dataWords;
+        uint32_t reserved2;
+    };
+    static_assert(sizeof(SectionRecord) == 16, "cache section layout");
+}
+
+class ChunkCache {
+	public:
+		bool open(const std::string& path);
+		void close();
+		bool isOpen() const { return file.isOpen(); }
+
+		size_t size() const { return index ? header.chunkCount : 0; }
+		ChunkPos position(size_t i) const { return { index[i].x, index[i].z }; }
+		bool contains(ChunkPos pos) const { return find(pos) >= 0; }
+
+		// nullptr when the chunk is not in the cache or its record is damaged
+		std::shared_ptr<Chunk> load(ChunkPos pos) const;
+		std::shared_ptr<Chunk> load(size_t i) const;
+	private:
+		int64_t find(ChunkPos pos) const;
+
+		MappedFile file;
+		chunkcache::Header header = {};
+		const chunkcache::IndexEntry* index = nullptr;
+		std::vector<uint16_t> stateIds; // file state -> registry id
+};
+
+// Streams chunks into a cache file, the index and block state table are written by finish()
+class ChunkCacheWriter {
+	public:
+		bool open(const std::string& path);
+		bool add(const Chunk& chunk);
+		bool finish();
+
+		size_t size() const { return entries.size(); }
+	private:
+		void write(const void* data, size_t size);
+		void pad();
+
+		std::ofstream out;
+		uint64_t offset = 0;
+		std::vector<chunkcache::IndexEntry> entries;
+		std::vector<int32_t> fileStateOf; // registry id -> file state, -1 if not written yet
+		std::vector<uint16_t> fileStates; // file state -> registry id
+};
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include "ChunkCulling.h"
+
+namespace {
+    void cross(const float a[3], const float b[3], float out[3]) {
+        out[0] = a[1] * b[2] - a[2] * b[1];
+        out[1] = a[2] * b[0] - a[0] * b[2];
+        out[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    float dot(const float a[3], const float b[3]) {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+}
+
+ViewFrustum ViewFrustum::fromUVW(const float eye[3], const float U[3], const float V[3], const float W[3], float farDistance) {
+    ViewFrustum frustum = {};
+    // Corner rays in order around the screen, neighbouring corners span one side plane
+    const float signs[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+    float corners[4][3];
+    for (int32_t c = 0; c < 4; ++c) {
+        for (int32_t i = 0; i < 3; ++i) {
+            corners[c][i] = W[i] + signs[c][0] * U[i] + signs[c][1] * V[i];
+        }
+    }
+    for (int32_t c = 0; c < 4; ++c) {
+        float* plane = frustum.planes[c];
+        cross(corners[c], corners[(c + 1) % 4], plane);
+        // The handedness of U and V is up to the camera, flip so W is inside
+        if (dot(plane, W) < 0.0f) {
+            plane[0] = -plane[0];
+            plane[1] = -plane[1];
+            plane[2] = -plane[2];
+        }
+        float length = std::sqrt(dot(plane, plane));
+        for (int32_t i = 0; i < 3; ++i) {
+            plane[i] /= length;
+        }
+        plane[3] = -dot(plane, eye);
+    }
+    frustum.numPlanes = 4;
+
+    if (farDistance > 0.0f) {
+        float* plane = frustum.planes[frustum.numPlanes++];
+        float length = std::sqrt(dot(W, W));
+        for (int32_t i = 0; i < 3; ++i) {
+            plane[i] = -W[i] / length;
+        }
+        plane[3] = -dot(plane, eye) + farDistance;
+    }
+    return frustum;
+}
+
+// Only the box corner furthest along each normal is tested
+bool ViewFrustum::intersects(const float boxMin[3], const float boxMax[3]) const {
+    for (int32_t p = 0; p < numPlanes; ++p) {
+        const float* plane = planes[p];
+        float corner[3];
+        for (int32_t i = 0; i < 3; ++i) {
+            corner[i] = plane[i] >= 0.0f ? boxMax[i] : boxMin[i];
+        }
+        if (dot(plane, corner) + plane[3] < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ChunkCuller::setChunk(ChunkPos pos, std::vector<int32_t> sectionYs, const Chunk* chunk) {
+    Column& column = columns[pos];
+    std::sort(sectionYs.begin(), sectionYs.end());
+    column.sections = std::move(sectionYs);
+    column.heights.clear();
+    column.cover = INT32_MIN;
+    if (chunk && chunk->sectionCount() > 0) {
+        column.heights.resize(SECTION_SIZE * SECTION_SIZE);
+        column.cover = INT32_MAX;
+        for (int32_t z = 0; z < SECTION_SIZE; ++z) {
+            for (int32_t x = 0; x < SECTION_SIZE; ++x) {
+                int32_t height = opaqueHeight(*chunk, x, z);
+                column.heights[z * SECTION_SIZE + x] = height;
+                column.cover = std::min(column.cover, height);
+            }
+        }
+    }
+    column.visible = true;
+}
+
+// Sections without an opaque state in their palette are skipped whole
+int32_t ChunkCuller::opaqueHeight(const Chunk& chunk, int32_t x, int32_t z) {
+    for (size_t i = chunk.sectionCount(); i-- > 0;) {
+        std::shared_ptr<const Section> section = chunk.sectionAt(i);
+        if (std::none_of(section->palette.begin(), section->palette.end(),
+                [this](uint16_t state) { return classifier.material(state) == BlockMaterial::Opaque; })) {
+            continue;
+        }
+        if (section->isUniform()) {
+            return (section->y + 1) * SECTION_SIZE;
+        }
+        for (int32_t y = SECTION_SIZE - 1; y >= 0; --y) {
+            if (classifier.material(section->blockAt(x, y, z)) == BlockMaterial::Opaque) {
+                return section->y * SECTION_SIZE + y + 1;
+            }
+        }
+    }
+    return chunk.sectionAt(0)->y * SECTION_SIZE;
+}
+
+void ChunkCuller::removeChunk(ChunkPos pos) {
+    columns.erase(pos);
+}
+
+void ChunkCuller::clear() {
+    columns.clear();
+    visible.clear();
+    lastStats = {};
+}
+
+int32_t ChunkCuller::regionCover(ChunkPos pos) const {
+    int32_t cover = INT32_MAX;
+    for (int32_t dz = -1; dz <= 1; ++dz) {
+        for (int32_t dx = -1; dx <= 1; ++dx) {
+            auto it = columns.find({ pos.x + dx, pos.z + dz });
+            if (it == columns.end() || it->second.cover == INT32_MIN) {
+                return INT32_MIN;
+            }
+            cover = std::min(cover, it->second.cover);
+        }
+    }
+    return cover;
+}
+
+// Underground the camera can look up at anything, only cull by terrain from above it
+bool ChunkCuller::underOpenSky(const float eye[3]) const {
+    int32_t x = static_cast<int32_t>(std::floor(eye[0])), z = static_cast<int32_t>(std::floor(eye[2]));
+    auto it = columns.find({ x >> 4, z >> 4 });
+    if (it == columns.end() || it->second.heights.empty()) {
+        return false;
+    }
+    return eye[1] >= static_cast<float>(it->second.heights[(z & 15) * SECTION_SIZE + (x & 15)]);
+}
+
+const std::vector<ChunkPos>& ChunkCuller::cull(const ViewFrustum& frustum, const float eye[3]) {
+    visible.clear();
+    lastStats = {};
+    lastStats.chunks = columns.size();
+    bool horizon = settings.horizon && underOpenSky(eye);
+
+    for (auto& [pos, column] : columns) {
+        column.visible = false;
+        if (column.sections.empty()) {
+            continue;
+        }
+        lastStats.sections += column.sections.size();
+
+        float boxMin[3] = { static_cast<float>(pos.x * SECTION_SIZE), 0.0f, static_cast<float>(pos.z * SECTION_SIZE) };
+        float boxMax[3] = { boxMin[0] + SECTION_SIZE, 0.0f, boxMin[2] + SECTION_SIZE };
+        // Whole column first, most chunks are either fully inside or fully outside
+        boxMin[1] = static_cast<float>(column.sections.front() * SECTION_SIZE);
+        boxMax[1] = static_cast<float>((column.sections.back() + 1) * SECTION_SIZE);
+        if (settings.frustum && !frustum.intersects(boxMin, boxMax)) {
+            lastStats.frustumCulled += column.sections.size();
+            continue;
+        }
+
+        int32_t hiddenBelow = INT32_MIN;
+        if (horizon) {
+            int32_t cover = regionCover(pos);
+            if (cover != INT32_MIN) {
+                hiddenBelow = cover - settings.coverDepth;
+            }
+        }
+        for (int32_t y : column.sections) {
+            if ((y + 1) * SECTION_SIZE <= hiddenBelow) {
+                ++lastStats.horizonCulled;
+                continue;
+            }
+            boxMin[1] = static_cast<float>(y * SECTION_SIZE);
+            boxMax[1] = boxMin[1] + SECTION_SIZE;
+            if (settings.frustum && !frustum.intersects(boxMin, boxMax)) {
+                ++lastStats.frustumCulled;
+                continue;
+            }
+            column.visible = true;
+        }
+        if (column.visible) {
+            visible.push_back(pos);
+        }
+    }
+    lastStats.visibleChunks = visible.size();
+    return visible;
+}
+
+bool ChunkCuller::isVisible(ChunkPos pos) const {
+    auto it = columns.find(pos);
+    return it == columns.end() || it->second.visible;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "ChunkMesher.h"
+#include "DataStructures.h"
+
+// View frustum of a pinhole camera given by its UVW frame, as returned by Camera::UVWFrame:
+// the ray through normalised screen coordinates (s, t) in [-1, 1] has direction s * U + t * V + W.
+// Planes point inwards, a point p is inside when dot(n, p) + d >= 0 for all of them.
+struct ViewFrustum {
+    float planes[5][4]; // four sides through the eye, then the far plane
+    int32_t numPlanes;
+
+    // farDistance along W, 0 leaves the frustum open
+    static ViewFrustum fromUVW(const float eye[3], const float U[3], const float V[3], const float W[3], float farDistance = 0.0f);
+    // Conservative, boxes near a corner may pass although they are outside
+    bool intersects(const float boxMin[3], const float boxMax[3]) const;
+};
+
+// Decides every frame which chunk columns can be seen, so the renderer only traces those.
+// Sections are tested against the view frustum and, while the camera is under open sky, against
+// the terrain: a section lies below the horizon when every column of its chunk and of the eight
+// chunks around it has its highest opaque block at least coverDepth blocks above it. Water,
+// glass and leaves do not count as cover, but caves opening on a cliff face inside those chunks
+// are hidden, keep coverDepth large or turn the horizon test off where that matters.
+// A chunk stays visible while any of its sections does.
+class ChunkCuller {
+	public:
+		struct Settings {
+			bool frustum = true;
+			bool horizon = true;
+			int32_t coverDepth = 32;
+		};
+
+		struct Stats {
+			size_t chunks;
+			size_t visibleChunks;
+			size_t sections;
+			size_t frustumCulled;
+			size_t horizonCulled;
+		};
+
+		void setSettings(const Settings& settings) { this->settings = settings; }
+		const Settings& getSettings() const { return settings; }
+
+		// Replaces the chunk, sectionYs are the sections with geometry. The blocks of chunk give the
+		// cover, without them the chunk is never hidden by the horizon.
+		void setChunk(ChunkPos pos, std::vector<int32_t> sectionYs, const Chunk* chunk);
+		void removeChunk(ChunkPos pos);
+		void clear();
+
+		// Culls every chunk for the camera at eye, block coordinates. Returns the visible chunks.
+		const std::vector<ChunkPos>& cull(const ViewFrustum& frustum, const float eye[3]);
+		// Result of the last cull, chunks added since count as visible
+		bool isVisible(ChunkPos pos) const;
+
+		const Stats& stats() const { return lastStats; }
+	private:
+		struct Column {
+			std::vector<int32_t> sections; // sorted
+			std::vector<int32_t> heights;  // above the highest opaque block by z * 16 + x, empty without blocks
+			int32_t cover;                 // lowest of the heights, INT32_MIN without blocks
+			bool visible = true;
+		};
+
+		// Block y above the highest opaque block of a local column, the bottom of the chunk without one
+		int32_t opaqueHeight(const Chunk& chunk, int32_t x, int32_t z);
+
+		// Lowest cover of the chunk and its eight neighbours, INT32_MIN if any of them is unknown
+		int32_t regionCover(ChunkPos pos) const;
+		bool underOpenSky(const float eye[3]) const;
+
+		Settings settings;
+		ChunkMesher classifier;
+		std::unordered_map<ChunkPos, Column, ChunkPosHash> columns;
+		std::vector<ChunkPos> visible;
+		Stats lastStats = {};
+};
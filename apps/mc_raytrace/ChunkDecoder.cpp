@@ -0,0 +1,142 @@
+#include <algorithm>
+#include "ChunkDecoder.h"
+#include "BlockStateRegistry.h"
+#include "LazySections.h"
+#include "UnpackBits.h"
+
+// First version whose packed arrays never span two longs (1.16)
+static constexpr int32_t NON_SPANNING_DATA_VERSION = 2556;
+
+// Pre-flattening chunks store raw block ids, map them back to namespace ids
+static const char* legacyBlockName(uint8_t blockID) {
+    static const std::vector<const char*> names = [] {
+        std::vector<const char*> table(256, "minecraft:air");
+        std::vector<bool> found(256, false);
+        enkiMINamespaceAndBlockIDTable ids = enkiGetNamespaceAndBlockIDTable();
+        for (uint32_t i = 0; i < ids.size; ++i) {
+            const enkiMINamespaceAndBlockID& id = ids.namespaceAndBlockIDs[i];
+            if (!found[id.blockID]) {
+                table[id.blockID] = id.pNamespaceID;
+                found[id.blockID] = true;
+            }
+        }
+        return table;
+    }();
+    return names[blockID];
+}
+
+// Convert one enkiMI section to a packed section of global block state ids
+static std::shared_ptr<Section> decodeSection(enkiChunkBlockData* chunk, int32_t sectionNr) {
+    BlockStateRegistry& registry = BlockStateRegistry::instance();
+    uint16_t states[SECTION_VOLUME];
+
+    const enkiChunkSectionPalette& palette = chunk->palette[sectionNr];
+    if (palette.size) {
+        // Translate the palette with one registry lookup per entry
+        std::vector<uint16_t> paletteStates(palette.size);
+        for (uint32_t i = 0; i < palette.size; ++i) {
+            const enkiNBTString& name = palette.pNamespaceIDStrings[i];
+            const enkiMIProperties& stateProperties = palette.pBlockStateProperties[i];
+
+            BlockProperty properties[ENKI_MI_MAX_PROPERTIES];
+            for (uint32_t p = 0; p < stateProperties.size; ++p) {
+                const enkiMIProperty& property = stateProperties.properties[p];
+                properties[p] = { property.pName, std::string_view(property.value.pStrNotNullTerminated, property.value.size) };
+            }
+            paletteStates[i] = registry.id(std::string_view(name.pStrNotNullTerminated, name.size), properties, stateProperties.size);
+        }
+
+        const uint8_t* blockStates = chunk->sections[sectionNr];
+        uint32_t bits = palette.numBitsPerBlock;
+        if (!blockStates) {
+            // Single entry palettes come without data
+            std::fill(states, states + SECTION_VOLUME, paletteStates[0]);
+        }
+        else if (chunk->dataVersion >= NON_SPANNING_DATA_VERSION && bits >= 1 && bits <= 16 &&
+                 palette.blockArraySize >= packedLongCount(bits, SECTION_VOLUME)) {
+            // Same index order as the anvil format, unpack the whole section at once
+            unpackBits(blockStates, bits, SECTION_VOLUME, states);
+            for (uint16_t& state : states) {
+                state = paletteStates[state < palette.size ? state : 0];
+            }
+        }
+        else {
+            // Entries spanning two longs, before 1.16
+            for (int32_t y = 0; y < SECTION_SIZE; ++y)
+                for (int32_t z = 0; z < SECTION_SIZE; ++z)
+                    for (int32_t x = 0; x < SECTION_SIZE; ++x) {
+                        enkiMIVoxelData voxel = enkiGetChunkSectionVoxelData(chunk, sectionNr, { x, y, z });
+                        states[sectionIndex(x, y, z)] = paletteStates[voxel.paletteIndex >= 0 ? voxel.paletteIndex : 0];
+                    }
+        }
+    }
+    else {
+        // Legacy section, raw block ids
+        std::vector<int32_t> stateOfBlockID(256, -1);
+        for (int32_t y = 0; y < SECTION_SIZE; ++y)
+            for (int32_t z = 0; z < SECTION_SIZE; ++z)
+                for (int32_t x = 0; x < SECTION_SIZE; ++x) {
+                    uint8_t blockID = enkiGetChunkSectionVoxel(chunk, sectionNr, { x, y, z });
+                    if (stateOfBlockID[blockID] < 0) {
+                        stateOfBlockID[blockID] = registry.id(legacyBlockName(blockID));
+                    }
+                    states[sectionIndex(x, y, z)] = static_cast<uint16_t>(stateOfBlockID[blockID]);
+                }
+    }
+    return Section::pack(sectionNr - ENKI_MI_SECTIONS_Y_OFFSET, states);
+}
+
+ChunkDecoder::ChunkDecoder() {
+    nbtAllocator.pAlloc = [](void* arena, size_t size) {
+        return static_cast<ArenaAllocator*>(arena)->allocate(size);
+    };
+    nbtAllocator.pFree = nullptr;
+    nbtAllocator.pUserData = &arena;
+}
+
+std::shared_ptr<Chunk> ChunkDecoder::decode(const uint8_t* data, size_t size, DecodeMode mode) {
+    std::shared_ptr<Chunk> chunk;
+
+    if (!inflater.inflate(data, size)) {
+        return chunk;
+    }
+
+    if (mode == DecodeMode::Lazy) {
+        chunk = LazySections::makeChunk(inflater.data(), inflater.size());
+        if (chunk) {
+            return chunk;
+        }
+    }
+
+    enkiNBTDataStream stream;
+    enkiNBTInitFromMemoryUncompressed(&stream, inflater.data(), static_cast<uint32_t>(inflater.size()));
+    enkiNBTSetAllocator(&stream, &nbtAllocator);
+    if (stream.dataLength)
+    {
+        // We keep the namespace strings ourselves, skip enkiMI's block id lookup
+        enkiNBTReadChunkExParams params = enkiGetDefaultNBTReadChunkExParams();
+        params.flags |= enkiNBTReadChunkExFlags_NoPaletteTranslation | enkiNBTReadChunkExFlags_LoadHeightmaps;
+        enkiChunkBlockData aChunk = enkiNBTReadChunkEx(&stream, params);
+
+        if (aChunk.countOfSections) {
+            chunk = std::make_shared<Chunk>();
+            chunk->pos = { aChunk.xPos, aChunk.zPos };
+            chunk->dataVersion = aChunk.dataVersion;
+            for (int32_t i = 0; i < ENKI_MI_NUM_SECTIONS_PER_CHUNK; ++i) {
+                if (aChunk.sections[i] || aChunk.palette[i].size) {
+                    chunk->sections.push_back(decodeSection(&aChunk, i));
+                }
+            }
+            // Chunks saved before they were fully generated have no heightmaps, scan the blocks then
+            for (int32_t type = 0; type < enkiMIHeightmap_Count; ++type) {
+                Heightmap heightmap = Heightmap::fromNbt(aChunk.heightmaps[type], static_cast<uint32_t>(aChunk.heightmapsArraySize[type]),
+                                                         aChunk.yPos * SECTION_SIZE, aChunk.dataVersion < NON_SPANNING_DATA_VERSION);
+                chunk->heightmaps[type] = heightmap.empty() ? Heightmap::compute(*chunk, static_cast<HeightmapType>(type)) : std::move(heightmap);
+            }
+        }
+    }
+    enkiNBTFreeAllocations(&stream);
+    arena.reset();
+
+    return chunk;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <memory>
+#include "ArenaAllocator.h"
+#include "ChunkInflater.h"
+#include "DataStructures.h"
+#include "enkimi.h"
+
+enum class DecodeMode {
+    Eager, // every section is decoded up front
+    Lazy,  // sections are indexed and decoded on first access, see LazySections
+};
+
+// Turns compressed chunk NBT into a Chunk.
+// A decoder is not thread safe, use one per thread.
+class ChunkDecoder {
+	public:
+		ChunkDecoder();
+
+		// Returns nullptr when the data does not contain a chunk.
+		// Lazy mode falls back to eager decoding for chunks older than 1.16.
+		std::shared_ptr<Chunk> decode(const uint8_t* data, size_t size, DecodeMode mode = DecodeMode::Eager);
+	private:
+		ChunkInflater inflater;
+		// Backs every enkiMI allocation made while decoding, reset after each chunk
+		ArenaAllocator arena;
+		enkiNBTAllocator nbtAllocator;
+};
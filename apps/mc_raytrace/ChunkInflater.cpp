@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <cstring>
+#include "ChunkInflater.h"
+
+namespace {
+    // gzip header flags, https://tools.ietf.org/html/rfc1952#section-2.3.1
+    constexpr uint8_t GZIP_FHCRC = 1 << 1;
+    constexpr uint8_t GZIP_FEXTRA = 1 << 2;
+    constexpr uint8_t GZIP_FNAME = 1 << 3;
+    constexpr uint8_t GZIP_FCOMMENT = 1 << 4;
+    constexpr size_t GZIP_HEADER_SIZE = 10;
+    constexpr size_t GZIP_TRAILER_SIZE = 8;
+
+    constexpr uint8_t NBT_TAG_COMPOUND = 10;
+
+    // Size hints come from the data and are not trusted, no real chunk inflates past this or
+    // more than MAX_RATIO times its compressed size before the buffer has to grow
+    constexpr size_t MAX_OUTPUT_SIZE = 64 * 1024 * 1024;
+    constexpr size_t MAX_RATIO = 64;
+    // Bigger buffers are given back on the next call instead of staying around per thread
+    constexpr size_t DEFAULT_OUTPUT_SIZE = 256 * 1024;
+    constexpr size_t KEPT_OUTPUT_SIZE = 4 * 1024 * 1024;
+}
+
+ChunkInflater::ChunkInflater() : output(DEFAULT_OUTPUT_SIZE) {
+    tinfl_init(&decompressor);
+}
+
+bool ChunkInflater::inflate(const uint8_t* data, size_t size) {
+    outputSize = 0;
+    if (output.size() > KEPT_OUTPUT_SIZE) {
+        output = std::vector<uint8_t>(DEFAULT_OUTPUT_SIZE);
+    }
+    if (size < 2) {
+        return false;
+    }
+
+    if (data[0] == 0x1f && data[1] == 0x8b) {
+        // gzip, skip the header and inflate the raw deflate stream
+        if (size < GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE || data[2] != 8) {
+            return false;
+        }
+        uint8_t flags = data[3];
+        size_t pos = GZIP_HEADER_SIZE;
+        if (flags & GZIP_FEXTRA) {
+            if (pos + 2 > size) return false;
+            pos += 2 + (data[pos] | (data[pos + 1] << 8));
+        }
+        if (flags & GZIP_FNAME) {
+            while (pos < size && data[pos] != 0) ++pos;
+            ++pos;
+        }
+        if (flags & GZIP_FCOMMENT) {
+            while (pos < size && data[pos] != 0) ++pos;
+            ++pos;
+        }
+        if (flags & GZIP_FHCRC) {
+            pos += 2;
+        }
+        if (pos + GZIP_TRAILER_SIZE > size) {
+            return false;
+        }
+
+        // ISIZE trailer is the uncompressed size modulo 2^32, only a hint
+        uint32_t uncompressedSize;
+        std::memcpy(&uncompressedSize, data + size - 4, sizeof(uncompressedSize));
+        size_t sizeHint = std::min({ static_cast<size_t>(uncompressedSize), size * MAX_RATIO, MAX_OUTPUT_SIZE });
+        return inflateDeflate(data + pos, size - pos - GZIP_TRAILER_SIZE, sizeHint, 0);
+    }
+
+    if ((data[0] & 0x0f) == 8 && ((data[0] << 8) | data[1]) % 31 == 0) {
+        return inflateDeflate(data, size, std::min(size * 4 + 1024, MAX_OUTPUT_SIZE), TINFL_FLAG_PARSE_ZLIB_HEADER);
+    }
+
+    if (data[0] == NBT_TAG_COMPOUND) {
+        // Uncompressed NBT (region compression type 3), callers expect a buffer they may modify
+        if (size > MAX_OUTPUT_SIZE) {
+            return false;
+        }
+        if (output.size() < size) {
+            output.resize(size);
+        }
+        std::memcpy(output.data(), data, size);
+        outputSize = size;
+        return true;
+    }
+    return false;
+}
+
+bool ChunkInflater::inflateDeflate(const uint8_t* data, size_t size, size_t sizeHint, uint32_t flags) {
+    if (output.size() < sizeHint) {
+        output.resize(sizeHint);
+    }
+
+    tinfl_init(&decompressor);
+    flags |= TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF;
+
+    for (;;) {
+        size_t inBytes = size;
+        size_t outBytes = output.size() - outputSize;
+        tinfl_status status = tinfl_decompress(&decompressor, data, &inBytes,
+            output.data(), output.data() + outputSize, &outBytes, flags);
+        data += inBytes;
+        size -= inBytes;
+        outputSize += outBytes;
+
+        if (status == TINFL_STATUS_DONE) {
+            return true;
+        }
+        if (status != TINFL_STATUS_HAS_MORE_OUTPUT || output.size() >= MAX_OUTPUT_SIZE) {
+            outputSize = 0;
+            return false;
+        }
+        // Out of room, grow and carry on where we stopped
+        output.resize(std::min(output.size() * 2, MAX_OUTPUT_SIZE));
+    }
+}
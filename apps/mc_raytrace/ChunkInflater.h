@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "miniz.h"
+
+// Decompresses chunk payloads into a buffer that is kept between calls.
+// The compression format (gzip, zlib or uncompressed NBT) is detected from the header,
+// the output buffer grows while inflating so data is never decompressed twice. Output is
+// capped at 64 MiB, larger payloads fail to inflate.
+// Not thread safe, use one per thread.
+class ChunkInflater {
+	public:
+		ChunkInflater();
+
+		// Returns false if the data could not be decompressed.
+		// The output stays valid until the next call and may be modified by the caller.
+		bool inflate(const uint8_t* data, size_t size);
+
+		uint8_t* data() { return output.data(); }
+		size_t size() const { return outputSize; }
+	private:
+		bool inflateDeflate(const uint8_t* data, size_t size, size_t sizeHint, uint32_t flags);
+
+		tinfl_decompressor decompressor;
+		std::vector<uint8_t> output; // grows up to the cap, oversized buffers are dropped on the next call
+		size_t outputSize = 0;
+};
@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <limits>
+#include <string_view>
+#include "ChunkMesher.h"
+
+namespace {
+    bool contains(std::string_view name, std::string_view part) {
+        return name.find(part) != std::string_view::npos;
+    }
+
+    bool endsWith(std::string_view name, std::string_view suffix) {
+        return name.size() >= suffix.size() && name.substr(name.size() - suffix.size()) == suffix;
+    }
+
+    // Blocks that do not fill their cube, matched against the name without namespace
+    const std::string_view CUTOUT_PARTS[] = {
+        "leaves", "slab", "stairs", "fence", "wall", "door", "pane", "torch", "sapling", "carpet",
+        "rail", "sign", "button", "pressure_plate", "ladder", "vine", "banner", "_bed", "chest",
+        "lantern", "chain", "bars", "flower", "tulip", "fern", "coral", "candle",
+        "head", "skull", "pot", "lever", "grass", "roots", "bush", "sprouts", "dripleaf",
+    };
+    const std::string_view CUTOUT_NAMES[] = {
+        "snow", "seagrass", "kelp", "kelp_plant", "sugar_cane", "cobweb", "poppy", "dandelion",
+        "cornflower", "allium", "azure_bluet", "oxeye_daisy", "lily_of_the_valley", "lily_pad",
+        "wheat", "carrots", "potatoes", "beetroots", "bamboo", "cactus", "redstone_wire", "repeater",
+        "comparator", "scaffolding", "bell", "lectern", "cake", "hopper", "end_rod", "anvil",
+        "red_mushroom", "brown_mushroom",
+    };
+
+    // Face geometry per FaceDirection
+    struct Axes {
+        int32_t axis, u, v; // normal axis and the two axes spanning the face, u x v points along +axis
+    };
+
+    Axes axesOf(int32_t direction) {
+        int32_t axis = direction >> 1;
+        return { axis, (axis + 1) % 3, (axis + 2) % 3 };
+    }
+}
+
+std::array<float, 3> ChunkMesh::normal(FaceDirection direction) {
+    int32_t d = static_cast<int32_t>(direction);
+    std::array<float, 3> n{ 0.0f, 0.0f, 0.0f };
+    n[d >> 1] = (d & 1) ? 1.0f : -1.0f;
+    return n;
+}
+
+void ChunkMesh::clear() {
+    positions.clear();
+    texcoords.clear();
+    triangles.clear();
+    directions.clear();
+    states.clear();
+    sections.clear();
+}
+
+int32_t ChunkMesh::findSection(int32_t y) const {
+    auto it = std::lower_bound(sections.begin(), sections.end(), y,
+                               [](const SectionRange& range, int32_t y) { return range.y < y; });
+    return it != sections.end() && it->y == y ? static_cast<int32_t>(it - sections.begin()) : -1;
+}
+
+void ChunkMesh::fillPadding(const SectionRange& range) {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    uint32_t padVertex = range.firstVertex + range.vertexCount;
+    for (uint32_t v = padVertex; v < range.firstVertex + range.vertexCapacity; ++v) {
+        positions[v] = { nan, nan, nan };
+        texcoords[v] = { 0.0f, 0.0f };
+    }
+    for (uint32_t t = range.firstTriangle + range.triangleCount; t < range.firstTriangle + range.triangleCapacity; ++t) {
+        triangles[t] = { padVertex, padVertex, padVertex };
+        directions[t] = FaceDirection::NegX;
+        states[t] = BlockStateRegistry::AIR;
+    }
+}
+
+void ChunkMesh::addSlack(float slack, uint32_t minQuads) {
+    ChunkMesh padded;
+    padded.pos = pos;
+    for (const SectionRange& range : sections) {
+        uint32_t quads = range.triangleCount / 2;
+        uint32_t capacity = quads + std::max(static_cast<uint32_t>(quads * slack), minQuads);
+
+        SectionRange moved = range;
+        moved.firstVertex = static_cast<uint32_t>(padded.positions.size());
+        moved.vertexCapacity = capacity * 4;
+        moved.firstTriangle = static_cast<uint32_t>(padded.triangles.size());
+        moved.triangleCapacity = capacity * 2;
+
+        auto vertices = positions.begin() + range.firstVertex;
+        padded.positions.insert(padded.positions.end(), vertices, vertices + range.vertexCount);
+        auto uvs = texcoords.begin() + range.firstVertex;
+        padded.texcoords.insert(padded.texcoords.end(), uvs, uvs + range.vertexCount);
+        uint32_t offset = moved.firstVertex - range.firstVertex;
+        for (uint32_t t = range.firstTriangle; t < range.firstTriangle + range.triangleCount; ++t) {
+            padded.triangles.push_back({ triangles[t][0] + offset, triangles[t][1] + offset, triangles[t][2] + offset });
+        }
+        auto dirs = directions.begin() + range.firstTriangle;
+        padded.directions.insert(padded.directions.end(), dirs, dirs + range.triangleCount);
+        auto ids = states.begin() + range.firstTriangle;
+        padded.states.insert(padded.states.end(), ids, ids + range.triangleCount);
+
+        padded.positions.resize(moved.firstVertex + moved.vertexCapacity);
+        padded.texcoords.resize(moved.firstVertex + moved.vertexCapacity);
+        padded.triangles.resize(moved.firstTriangle + moved.triangleCapacity);
+        padded.directions.resize(moved.firstTriangle + moved.triangleCapacity);
+        padded.states.resize(moved.firstTriangle + moved.triangleCapacity);
+        padded.fillPadding(moved);
+        padded.sections.push_back(moved);
+    }
+    *this = std::move(padded);
+}
+
+size_t ChunkMesh::memoryUsage() const {
+    return sizeof(ChunkMesh) +
+        positions.capacity() * sizeof(positions[0]) +
+        texcoords.capacity() * sizeof(texcoords[0]) +
+        triangles.capacity() * sizeof(triangles[0]) +
+        directions.capacity() * sizeof(directions[0]) +
+        states.capacity() * sizeof(states[0]) +
+        sections.capacity() * sizeof(sections[0]);
+}
+
+BlockMaterial ChunkMesher::classify(const BlockState& state) {
+    std::string_view name = state.name;
+    if (size_t colon = name.find(':'); colon != std::string_view::npos) {
+        name = name.substr(colon + 1);
+    }
+
+    if (name == "air" || name == "cave_air" || name == "void_air" || name == "barrier" ||
+        name == "structure_void" || name == "light") {
+        return BlockMaterial::Invisible;
+    }
+    if (name == "water" || name == "bubble_column") {
+        return BlockMaterial::Water;
+    }
+    if (contains(name, "glass") || name == "ice" || name == "frosted_ice" ||
+        name == "slime_block" || name == "honey_block") {
+        return BlockMaterial::Glass;
+    }
+    // grass_block, mushroom_block, coral_block... are full cubes despite their names
+    if (endsWith(name, "_block")) {
+        return BlockMaterial::Opaque;
+    }
+    if (contains(name, "slab")) {
+        for (const auto& [key, value] : state.properties) {
+            if (key == "type" && value == "double") {
+                return BlockMaterial::Opaque;
+            }
+        }
+    }
+    for (std::string_view part : CUTOUT_PARTS) {
+        if (contains(name, part)) {
+            return BlockMaterial::Cutout;
+        }
+    }
+    for (std::string_view cutout : CUTOUT_NAMES) {
+        if (name == cutout) {
+            return BlockMaterial::Cutout;
+        }
+    }
+    return BlockMaterial::Opaque;
+}
+
+BlockMaterial ChunkMesher::material(uint16_t state) {
+    if (state >= materials.size()) {
+        size_t size = std::max(BlockStateRegistry::instance().size(), static_cast<size_t>(state) + 1);
+        materials.resize(size, UNKNOWN);
+    }
+    uint8_t& material = materials[state];
+    if (material == UNKNOWN) {
+        material = static_cast<uint8_t>(classify(BlockStateRegistry::instance().state(state)));
+    }
+    return static_cast<BlockMaterial>(material);
+}
+
+bool ChunkMesher::faceVisible(uint16_t state, uint16_t neighbour) {
+    if (state == neighbour || material(state) == BlockMaterial::Invisible) {
+        return false;
+    }
+    return material(neighbour) != BlockMaterial::Opaque;
+}
+
+void ChunkMesher::mesh(const Chunk& chunk, const Neighbours& neighbours, ChunkMesh& out) {
+    out.clear();
+    out.pos = chunk.pos;
+    size_t count = chunk.sectionCount();
+    for (size_t i = 0; i < count; ++i) {
+        std::shared_ptr<const Section> section = chunk.sectionAt(i);
+        if (!isEmpty(*section)) {
+            captureBorders(chunk, section->y, neighbours, borders);
+        }
+        meshSection(*section, borders, out);
+    }
+}
+
+void ChunkMesher::captureBorders(const Chunk& chunk, int32_t sectionY, const Neighbours& neighbours, SectionBorders& borders) {
+    constexpr int32_t LAST = SECTION_SIZE - 1;
+
+    const Section* sections[6] = {
+        neighbours.negX ? neighbours.negX->section(sectionY) : nullptr,
+        neighbours.posX ? neighbours.posX->section(sectionY) : nullptr,
+        chunk.section(sectionY - 1),
+        chunk.section(sectionY + 1),
+        neighbours.negZ ? neighbours.negZ->section(sectionY) : nullptr,
+        neighbours.posZ ? neighbours.posZ->section(sectionY) : nullptr,
+    };
+
+    for (int32_t direction = 0; direction < 6; ++direction) {
+        uint16_t* face = borders.faces[direction];
+        const Section* section = sections[direction];
+        if (!section) {
+            std::fill_n(face, SECTION_SIZE * SECTION_SIZE, BlockStateRegistry::AIR);
+            continue;
+        }
+        // The layer of the neighbour that touches us
+        int32_t layer = (direction & 1) ? 0 : LAST;
+        for (int32_t b = 0; b < SECTION_SIZE; ++b) {
+            for (int32_t a = 0; a < SECTION_SIZE; ++a) {
+                uint16_t state;
+                switch (direction >> 1) {
+                    case 0:  state = section->blockAt(layer, a, b); break;
+                    case 1:  state = section->blockAt(a, layer, b); break;
+                    default: state = section->blockAt(a, b, layer); break;
+                }
+                face[b * SECTION_SIZE + a] = state;
+            }
+        }
+    }
+}
+
+void ChunkMesher::meshSection(const Section& section, const SectionBorders& borders, ChunkMesh& out) {
+    ChunkMesh::SectionRange range{};
+    range.y = section.y;
+    range.firstVertex = static_cast<uint32_t>(out.positions.size());
+    range.firstTriangle = static_cast<uint32_t>(out.triangles.size());
+    if (isEmpty(section)) {
+        out.sections.push_back(range);
+        return;
+    }
+
+    uint16_t states[SECTION_VOLUME];
+    section.unpack(states);
+    for (int32_t y = 0; y < SECTION_SIZE; ++y)
+        for (int32_t z = 0; z < SECTION_SIZE; ++z)
+            std::copy_n(states + sectionIndex(0, y, z), SECTION_SIZE, padded + paddedIndex(0, y, z));
+
+    for (int32_t b = 0; b < SECTION_SIZE; ++b) {
+        for (int32_t a = 0; a < SECTION_SIZE; ++a) {
+            uint32_t i = b * SECTION_SIZE + a;
+            padded[paddedIndex(-1, a, b)] = borders.faces[0][i];
+            padded[paddedIndex(SECTION_SIZE, a, b)] = borders.faces[1][i];
+            padded[paddedIndex(a, -1, b)] = borders.faces[2][i];
+            padded[paddedIndex(a, SECTION_SIZE, b)] = borders.faces[3][i];
+            padded[paddedIndex(a, b, -1)] = borders.faces[4][i];
+            padded[paddedIndex(a, b, SECTION_SIZE)] = borders.faces[5][i];
+        }
+    }
+
+    const float baseY = static_cast<float>(section.y * SECTION_SIZE);
+
+    for (int32_t direction = 0; direction < 6; ++direction) {
+        const Axes axes = axesOf(direction);
+        const bool positive = direction & 1;
+
+        for (int32_t slice = 0; slice < SECTION_SIZE; ++slice) {
+            // Visible faces of this slice, the state owning the face or AIR
+            int32_t c[3];
+            c[axes.axis] = slice;
+            bool any = false;
+            for (int32_t j = 0; j < SECTION_SIZE; ++j) {
+                c[axes.v] = j;
+                for (int32_t i = 0; i < SECTION_SIZE; ++i) {
+                    c[axes.u] = i;
+                    int32_t n[3] = { c[0], c[1], c[2] };
+                    n[axes.axis] += positive ? 1 : -1;
+                    uint16_t state = padded[paddedIndex(c[0], c[1], c[2])];
+                    uint16_t neighbour = padded[paddedIndex(n[0], n[1], n[2])];
+                    bool visible = faceVisible(state, neighbour);
+                    mask[j * SECTION_SIZE + i] = visible ? state : BlockStateRegistry::AIR;
+                    any |= visible;
+                }
+            }
+            if (!any) {
+                continue;
+            }
+
+            // Grow each face along u, then along v while whole rows match
+            for (int32_t j = 0; j < SECTION_SIZE; ++j) {
+                for (int32_t i = 0; i < SECTION_SIZE;) {
+                    uint16_t state = mask[j * SECTION_SIZE + i];
+                    if (state == BlockStateRegistry::AIR) {
+                        ++i;
+                        continue;
+                    }
+
+                    int32_t width = 1;
+                    while (i + width < SECTION_SIZE && mask[j * SECTION_SIZE + i + width] == state) {
+                        ++width;
+                    }
+                    int32_t height = 1;
+                    for (; j + height < SECTION_SIZE; ++height) {
+                        const uint16_t* row = mask + (j + height) * SECTION_SIZE + i;
+                        if (std::any_of(row, row + width, [state](uint16_t s) { return s != state; })) {
+                            break;
+                        }
+                    }
+                    for (int32_t h = 0; h < height; ++h) {
+                        std::fill_n(mask + (j + h) * SECTION_SIZE + i, width, BlockStateRegistry::AIR);
+                    }
+
+                    // Corners counter clockwise seen from the outside of a positive face
+                    const int32_t du[4] = { 0, width, width, 0 };
+                    const int32_t dv[4] = { 0, 0, height, height };
+                    uint32_t first = static_cast<uint32_t>(out.positions.size());
+                    for (int32_t k = 0; k < 4; ++k) {
+                        float p[3];
+                        p[axes.axis] = static_cast<float>(slice + (positive ? 1 : 0));
+                        p[axes.u] = static_cast<float>(i + du[k]);
+                        p[axes.v] = static_cast<float>(j + dv[k]);
+                        out.positions.push_back({ p[0], p[1] + baseY, p[2] });
+                        out.texcoords.push_back({ static_cast<float>(du[k]), static_cast<float>(dv[k]) });
+                    }
+                    if (positive) {
+                        out.triangles.push_back({ first, first + 1, first + 2 });
+                        out.triangles.push_back({ first, first + 2, first + 3 });
+                    }
+                    else {
+                        out.triangles.push_back({ first, first + 2, first + 1 });
+                        out.triangles.push_back({ first, first + 3, first + 2 });
+                    }
+                    for (int32_t t = 0; t < 2; ++t) {
+                        out.directions.push_back(static_cast<FaceDirection>(direction));
+                        out.states.push_back(state);
+                    }
+                    i += width;
+                }
+            }
+        }
+    }
+
+    range.vertexCount = static_cast<uint32_t>(out.positions.size()) - range.firstVertex;
+    range.vertexCapacity = range.vertexCount;
+    range.triangleCount = static_cast<uint32_t>(out.triangles.size()) - range.firstTriangle;
+    range.triangleCapacity = range.triangleCount;
+    out.sections.push_back(range);
+}
+
+int32_t ChunkMesher::remeshSection(const Section& section, const SectionBorders& borders, ChunkMesh& mesh) {
+    int32_t index = mesh.findSection(section.y);
+    if (index < 0) {
+        return -1;
+    }
+
+    scratch.clear();
+    meshSection(section, borders, scratch);
+    ChunkMesh::SectionRange& range = mesh.sections[index];
+    if (scratch.positions.size() > range.vertexCapacity || scratch.triangles.size() > range.triangleCapacity) {
+        return -1;
+    }
+
+    std::copy(scratch.positions.begin(), scratch.positions.end(), mesh.positions.begin() + range.firstVertex);
+    std::copy(scratch.texcoords.begin(), scratch.texcoords.end(), mesh.texcoords.begin() + range.firstVertex);
+    std::copy(scratch.directions.begin(), scratch.directions.end(), mesh.directions.begin() + range.firstTriangle);
+    std::copy(scratch.states.begin(), scratch.states.end(), mesh.states.begin() + range.firstTriangle);
+    for (size_t t = 0; t < scratch.triangles.size(); ++t) {
+        const auto& triangle = scratch.triangles[t];
+        mesh.triangles[range.firstTriangle + t] = { triangle[0] + range.firstVertex, triangle[1] + range.firstVertex, triangle[2] + range.firstVertex };
+    }
+    range.vertexCount = static_cast<uint32_t>(scratch.positions.size());
+    range.triangleCount = static_cast<uint32_t>(scratch.triangles.size());
+    mesh.fillPadding(range);
+    return index;
+}
+
+uint8_t ChunkMesher::changedBorders(const Section& before, const Section& after) {
+    constexpr int32_t LAST = SECTION_SIZE - 1;
+    uint8_t changed = 0;
+    for (int32_t b = 0; b < SECTION_SIZE; ++b) {
+        for (int32_t a = 0; a < SECTION_SIZE; ++a) {
+            auto differs = [&](int32_t x, int32_t y, int32_t z) { return before.blockAt(x, y, z) != after.blockAt(x, y, z); };
+            if (differs(0, a, b))    changed |= 1 << static_cast<int>(FaceDirection::NegX);
+            if (differs(LAST, a, b)) changed |= 1 << static_cast<int>(FaceDirection::PosX);
+            if (differs(a, 0, b))    changed |= 1 << static_cast<int>(FaceDirection::NegY);
+            if (differs(a, LAST, b)) changed |= 1 << static_cast<int>(FaceDirection::PosY);
+            if (differs(a, b, 0))    changed |= 1 << static_cast<int>(FaceDirection::NegZ);
+            if (differs(a, b, LAST)) changed |= 1 << static_cast<int>(FaceDirection::PosZ);
+        }
+    }
+    return changed;
+}
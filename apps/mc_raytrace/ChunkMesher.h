@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "BlockStateRegistry.h"
+#include "DataStructures.h"
+
+// How a block state is drawn and whether it hides the faces of the blocks next to it
+enum class BlockMaterial : uint8_t {
+    Invisible, // air, barriers: no faces
+    Opaque,    // full cube, hides neighbour faces
+    Cutout,    // leaves, plants, slabs...: drawn as a cube but neighbours stay visible
+    Glass,
+    Water,
+    Count
+};
+
+// Index of the face normal, axis * 2 + positive
+enum class FaceDirection : uint8_t {
+    NegX, PosX, NegY, PosY, NegZ, PosZ
+};
+
+// Merged quads of one chunk column, two triangles per quad.
+// Positions are block coordinates relative to the chunk origin (x and z in [0, 16]).
+struct ChunkMesh {
+    // Vertices and triangles of one section, sections are stored back to back sorted by y.
+    // Past the count up to the capacity are padding vertices (NaN) and degenerate triangles on
+    // them, which ray tracing ignores, so a section can be re-meshed in place.
+    struct SectionRange {
+        int32_t y;
+        uint32_t firstVertex;
+        uint32_t vertexCount;
+        uint32_t vertexCapacity;
+        uint32_t firstTriangle;
+        uint32_t triangleCount;
+        uint32_t triangleCapacity;
+    };
+
+    ChunkPos pos;
+    std::vector<std::array<float, 3>> positions;
+    std::vector<std::array<float, 2>> texcoords;     // per vertex, in blocks so textures tile with wrap addressing
+    std::vector<std::array<uint32_t, 3>> triangles;
+    std::vector<FaceDirection> directions;          // per triangle
+    std::vector<uint16_t> states;                   // per triangle, global block state id
+    std::vector<SectionRange> sections;
+
+    static std::array<float, 3> normal(FaceDirection direction);
+
+    void clear();
+    bool empty() const { return triangles.empty(); }
+    // Give every section room for its quad count times (1 + slack), and at least minQuads more
+    void addSlack(float slack, uint32_t minQuads);
+    int32_t findSection(int32_t y) const;
+    // Turn everything past the counts of a range into padding
+    void fillPadding(const SectionRange& range);
+    size_t memoryUsage() const;
+};
+
+// Copy of the blocks touching the six faces of a section, everything the mesher needs from
+// outside the section. Indexed by FaceDirection, then [b * SECTION_SIZE + a] where a and b are
+// the two remaining coordinates in x, y, z order.
+struct SectionBorders {
+    uint16_t faces[6][SECTION_SIZE * SECTION_SIZE];
+};
+
+// Builds ChunkMeshes with greedy meshing: faces between two blocks are dropped when the
+// neighbour is opaque or the same state, the remaining faces of every slice are merged into
+// rectangles of one block state and direction.
+// A mesher keeps scratch buffers and a material cache, use one per thread.
+class ChunkMesher {
+	public:
+		// Chunks next to the one being meshed, missing neighbours count as air so border faces stay closed
+		struct Neighbours {
+			const Chunk* negX = nullptr;
+			const Chunk* posX = nullptr;
+			const Chunk* negZ = nullptr;
+			const Chunk* posZ = nullptr;
+		};
+
+		void mesh(const Chunk& chunk, const Neighbours& neighbours, ChunkMesh& out);
+		// Appends the faces of one section and its SectionRange, out is not cleared.
+		// Sections of invisible blocks get an empty range and do not need borders.
+		void meshSection(const Section& section, const SectionBorders& borders, ChunkMesh& out);
+		// Re-mesh one section of a mesh in place, within the capacity of its range.
+		// Returns the index of the rewritten range, or -1 when the mesh has no range for the
+		// section or it outgrew the capacity, mesh the whole chunk again then.
+		int32_t remeshSection(const Section& section, const SectionBorders& borders, ChunkMesh& mesh);
+		static void captureBorders(const Chunk& chunk, int32_t sectionY, const Neighbours& neighbours, SectionBorders& borders);
+		// Sides of the section whose border layer differs between two versions, as 1 << FaceDirection.
+		// The neighbours on those sides have to be re-meshed as well.
+		static uint8_t changedBorders(const Section& before, const Section& after);
+		bool isEmpty(const Section& section) { return section.isUniform() && material(section.palette[0]) == BlockMaterial::Invisible; }
+
+		BlockMaterial material(uint16_t state);
+		static BlockMaterial classify(const BlockState& state);
+	private:
+		static constexpr int32_t PADDED_SIZE = SECTION_SIZE + 2;
+
+		bool faceVisible(uint16_t state, uint16_t neighbour);
+
+		static uint32_t paddedIndex(int32_t x, int32_t y, int32_t z) {
+			return static_cast<uint32_t>(((y + 1) * PADDED_SIZE + (z + 1)) * PADDED_SIZE + (x + 1));
+		}
+
+		static constexpr uint8_t UNKNOWN = 0xFF;
+
+		std::vector<uint8_t> materials; // BlockMaterial by state id, classified on first use
+		// Section states with a one block border taken from the neighbouring sections
+		uint16_t padded[PADDED_SIZE * PADDED_SIZE * PADDED_SIZE];
+		uint16_t mask[SECTION_SIZE * SECTION_SIZE];
+		SectionBorders borders;
+		ChunkMesh scratch;
+};
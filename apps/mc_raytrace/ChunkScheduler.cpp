@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <cmath>
+#include "ChunkScheduler.h"
+
+namespace {
+    // Distance multiplier for chunks outside the view cone, they still load but after the visible ones
+    constexpr float OUT_OF_VIEW_WEIGHT = 4.0f;
+    // Ranking bonus per stage, in chunks
+    constexpr float STAGE_BONUS = 0.25f;
+    // Half the diagonal of a chunk, widens the view cone so chunks at its edge count as visible
+    constexpr float CHUNK_RADIUS = SECTION_SIZE * 0.7072f;
+    // Camera changes below these keep the current order
+    constexpr float RERANK_DISTANCE = SECTION_SIZE * 0.5f;
+    constexpr float RERANK_COS_ANGLE = 0.985f; // 10 degrees
+}
+
+ChunkScheduler::ChunkScheduler(TaskPool& pool, uint32_t maxInFlight)
+    : pool(pool), maxInFlight(maxInFlight ? maxInFlight : pool.numThreads() * 2) {
+}
+
+ChunkScheduler::~ChunkScheduler() {
+    std::vector<Task> cancelled;
+    {
+        std::unique_lock lock(mutex);
+        removeIf([](const Entry&) { return true; }, cancelled);
+    }
+    for (Task& task : cancelled) {
+        task();
+    }
+    std::unique_lock lock(mutex);
+    idle.wait(lock, [this]() { return inFlight == 0; });
+}
+
+void ChunkScheduler::setCameraPosition(double x, double z) {
+    std::vector<Task> cancelled;
+    {
+        std::lock_guard lock(mutex);
+        cameraX = static_cast<float>(x);
+        cameraZ = static_cast<float>(z);
+        rescore(cancelled, false);
+    }
+    for (Task& task : cancelled) {
+        task();
+    }
+}
+
+void ChunkScheduler::setCameraDirection(const float direction[3], float fovY, float aspect) {
+    std::vector<Task> cancelled;
+    {
+        std::lock_guard lock(mutex);
+        // Ranking is horizontal, looking straight up or down sees every direction
+        float length = std::sqrt(direction[0] * direction[0] + direction[2] * direction[2]);
+        float total = std::sqrt(length * length + direction[1] * direction[1]);
+        hasDirection = length > 0.2f * total;
+        if (hasDirection) {
+            viewX = direction[0] / length;
+            viewZ = direction[2] / length;
+        }
+        float tanHalf = std::tan(fovY * 0.5f * 3.14159265f / 180.0f);
+        halfFov = std::atan(tanHalf * std::max(aspect, 1.0f));
+        rescore(cancelled, false);
+    }
+    for (Task& task : cancelled) {
+        task();
+    }
+}
+
+void ChunkScheduler::setCancelDistance(float chunks) {
+    std::vector<Task> cancelled;
+    {
+        std::lock_guard lock(mutex);
+        cancelDistance = std::max(chunks, 0.0f);
+        rescore(cancelled, true);
+    }
+    for (Task& task : cancelled) {
+        task();
+    }
+}
+
+void ChunkScheduler::submit(ChunkPos pos, Stage stage, Job job) {
+    std::vector<Task> cancelled;
+    {
+        std::lock_guard lock(mutex);
+        Key key = { pos, stage };
+        if (queuedKeys.count(key)) {
+            removeIf([&key](const Entry& entry) { return entry.pos == key.pos && entry.stage == key.stage; }, cancelled);
+        }
+
+        if (beyondCancelDistance(pos)) {
+            ++cancelledJobs;
+            if (job.cancel) {
+                cancelled.push_back(std::move(job.cancel));
+            }
+        }
+        else {
+            uint64_t sequence = nextSequence++;
+            heap.push_back({ score(pos, stage), sequence, pos, stage, false, std::move(job) });
+            std::push_heap(heap.begin(), heap.end(), worse);
+            queuedKeys[key] = sequence;
+            dispatch();
+        }
+    }
+    for (Task& task : cancelled) {
+        task();
+    }
+}
+
+void ChunkScheduler::cancel(ChunkPos pos) {
+    std::vector<Task> cancelled;
+    {
+        std::lock_guard lock(mutex);
+        removeIf([pos](const Entry& entry) { return entry.pos == pos; }, cancelled);
+        if (heap.empty() && inFlight == 0) {
+            idle.notify_all();
+        }
+    }
+    for (Task& task : cancelled) {
+        task();
+    }
+}
+
+void ChunkScheduler::boost(ChunkPos pos) {
+    std::lock_guard lock(mutex);
+    bool found = false;
+    for (Entry& entry : heap) {
+        if (entry.pos == pos && !entry.boosted) {
+            entry.boosted = true;
+            found = true;
+        }
+    }
+    if (found) {
+        std::make_heap(heap.begin(), heap.end(), worse);
+    }
+}
+
+void ChunkScheduler::dispatchNow(ChunkPos pos) {
+    std::lock_guard lock(mutex);
+    std::vector<Task> none;
+    std::vector<Entry> removed;
+    removeIf([pos](const Entry& entry) { return entry.pos == pos; }, none, &removed);
+    // Stage order, a chunk is meshed after it is decoded
+    std::sort(removed.begin(), removed.end(), [](const Entry& a, const Entry& b) { return a.stage < b.stage; });
+    for (Entry& entry : removed) {
+        start(entry);
+    }
+}
+
+void ChunkScheduler::wait() {
+    std::unique_lock lock(mutex);
+    idle.wait(lock, [this]() { return heap.empty() && inFlight == 0; });
+}
+
+ChunkScheduler::Stats ChunkScheduler::stats() const {
+    std::lock_guard lock(mutex);
+    return { heap.size(), inFlight, completed, cancelledJobs };
+}
+
+bool ChunkScheduler::worse(const Entry& a, const Entry& b) {
+    if (a.boosted != b.boosted) {
+        return b.boosted;
+    }
+    if (a.score != b.score) {
+        return a.score > b.score;
+    }
+    return a.sequence > b.sequence;
+}
+
+// Distance in chunks from the camera to the chunk centre, stretched for chunks outside the view cone
+float ChunkScheduler::score(ChunkPos pos, Stage stage) const {
+    float dx = static_cast<float>(pos.x * SECTION_SIZE + SECTION_SIZE / 2) - cameraX;
+    float dz = static_cast<float>(pos.z * SECTION_SIZE + SECTION_SIZE / 2) - cameraZ;
+    float distance = std::sqrt(dx * dx + dz * dz);
+
+    bool visible = !hasDirection || distance <= CHUNK_RADIUS;
+    if (!visible) {
+        float cosAngle = std::clamp((dx * viewX + dz * viewZ) / distance, -1.0f, 1.0f);
+        visible = std::acos(cosAngle) <= halfFov + std::asin(CHUNK_RADIUS / distance);
+    }
+    return distance / SECTION_SIZE * (visible ? 1.0f : OUT_OF_VIEW_WEIGHT) - static_cast<float>(stage) * STAGE_BONUS;
+}
+
+bool ChunkScheduler::beyondCancelDistance(ChunkPos pos) const {
+    if (cancelDistance <= 0.0f) {
+        return false;
+    }
+    float dx = static_cast<float>(pos.x * SECTION_SIZE + SECTION_SIZE / 2) - cameraX;
+    float dz = static_cast<float>(pos.z * SECTION_SIZE + SECTION_SIZE / 2) - cameraZ;
+    float limit = cancelDistance * SECTION_SIZE;
+    return dx * dx + dz * dz > limit * limit;
+}
+
+void ChunkScheduler::rescore(std::vector<Task>& cancelled, bool force) {
+    float movedX = cameraX - rankedX, movedZ = cameraZ - rankedZ;
+    bool moved = movedX * movedX + movedZ * movedZ > RERANK_DISTANCE * RERANK_DISTANCE;
+    bool turned = hasDirection && viewX * rankedViewX + viewZ * rankedViewZ < RERANK_COS_ANGLE;
+    if (!force && !moved && !turned) {
+        return;
+    }
+    rankedX = cameraX;
+    rankedZ = cameraZ;
+    rankedViewX = hasDirection ? viewX : 0.0f;
+    rankedViewZ = hasDirection ? viewZ : 0.0f;
+
+    if (cancelDistance > 0.0f) {
+        removeIf([this](const Entry& entry) { return beyondCancelDistance(entry.pos); }, cancelled);
+    }
+    for (Entry& entry : heap) {
+        entry.score = score(entry.pos, entry.stage);
+    }
+    std::make_heap(heap.begin(), heap.end(), worse);
+}
+
+template <typename Pred>
+void ChunkScheduler::removeIf(Pred pred, std::vector<Task>& cancelled, std::vector<Entry>* removed) {
+    auto kept = std::partition(heap.begin(), heap.end(), [&pred](const Entry& entry) { return !pred(entry); });
+    if (kept == heap.end()) {
+        return;
+    }
+    for (auto it = kept; it != heap.end(); ++it) {
+        queuedKeys.erase({ it->pos, it->stage });
+        if (removed) {
+            removed->push_back(std::move(*it));
+            continue;
+        }
+        ++cancelledJobs;
+        if (it->job.cancel) {
+            cancelled.push_back(std::move(it->job.cancel));
+        }
+    }
+    heap.erase(kept, heap.end());
+    std::make_heap(heap.begin(), heap.end(), worse);
+}
+
+void ChunkScheduler::dispatch() {
+    while (inFlight < maxInFlight && !heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), worse);
+        Entry entry = std::move(heap.back());
+        heap.pop_back();
+        queuedKeys.erase({ entry.pos, entry.stage });
+        start(entry);
+    }
+}
+
+void ChunkScheduler::start(Entry& entry) {
+    ++inFlight;
+    if (entry.job.prepare) {
+        entry.job.prepare();
+    }
+    pool.submit([this, run = std::move(entry.job.run)]() {
+        if (run) {
+            run();
+        }
+        finished();
+    });
+}
+
+void ChunkScheduler::finished() {
+    std::lock_guard lock(mutex);
+    --inFlight;
+    ++completed;
+    dispatch();
+    if (heap.empty() && inFlight == 0) {
+        idle.notify_all();
+    }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "DataStructures.h"
+#include "TaskPool.h"
+
+// Camera centred priority queue in front of a TaskPool for per chunk work.
+// Jobs wait here and only a few per worker are handed to the pool at a time, always the ones
+// that matter most right now: nearest to the camera first, chunks inside the view cone before
+// the ones behind it. Moving or turning the camera re-ranks everything still waiting.
+// A job is dropped instead of run when a newer job for the same chunk and stage replaces it,
+// when its chunk is cancelled, or when it lies beyond the cancel distance.
+class ChunkScheduler {
+	public:
+		using Task = std::function<void()>;
+
+		// Later stages of a chunk go first at equal distance, they are closer to being visible
+		enum class Stage : uint8_t { Decode, Mesh, Upload, Count };
+
+		struct Job {
+			Task prepare; // optional, on the dispatching thread in dispatch order
+			Task run;     // on the pool
+			Task cancel;  // optional, runs instead of prepare and run when the job is dropped
+		};
+
+		struct Stats {
+			size_t queued;
+			size_t inFlight;
+			uint64_t completed; // since creation
+			uint64_t cancelled;
+		};
+
+		// maxInFlight == 0 allows two jobs per pool thread
+		explicit ChunkScheduler(TaskPool& pool, uint32_t maxInFlight = 0);
+		// Cancels what is still queued and waits for the jobs in flight
+		~ChunkScheduler();
+
+		ChunkScheduler(const ChunkScheduler&) = delete;
+		ChunkScheduler& operator=(const ChunkScheduler&) = delete;
+
+		// Block coordinates
+		void setCameraPosition(double x, double z);
+		// Direction does not have to be normalised. fovY is in degrees, the view cone is widened
+		// to the horizontal field of view of the aspect ratio. Without a direction every chunk
+		// counts as in view.
+		void setCameraDirection(const float direction[3], float fovY = 90.0f, float aspect = 16.0f / 9.0f);
+		// Horizontal distance in chunks past which queued jobs are cancelled, 0 keeps everything
+		void setCancelDistance(float chunks);
+
+		// Replaces a queued job of the same chunk and stage, which is cancelled
+		void submit(ChunkPos pos, Stage stage, Job job);
+		// Drops every queued job of a chunk, jobs in flight finish normally
+		void cancel(ChunkPos pos);
+		// Runs the chunk's queued jobs before anything else
+		void boost(ChunkPos pos);
+		// Hands the chunk's queued jobs to the pool right away, prepare has run when this returns
+		void dispatchNow(ChunkPos pos);
+		// Block until nothing is queued or in flight
+		void wait();
+
+		Stats stats() const;
+	private:
+		struct Entry {
+			float score;
+			uint64_t sequence; // submission order breaks ties
+			ChunkPos pos;
+			Stage stage;
+			bool boosted;
+			Job job;
+		};
+
+		struct Key {
+			ChunkPos pos;
+			Stage stage;
+			bool operator==(const Key& other) const { return pos == other.pos && stage == other.stage; }
+		};
+		struct KeyHash {
+			size_t operator()(const Key& key) const {
+				return ChunkPosHash()(key.pos) * 31 + static_cast<size_t>(key.stage);
+			}
+		};
+
+		// Heap order, the best entry is the one that compares last
+		static bool worse(const Entry& a, const Entry& b);
+
+		// mutex must be held for everything below
+		float score(ChunkPos pos, Stage stage) const;
+		bool beyondCancelDistance(ChunkPos pos) const;
+		// Re-ranks the queue once the camera moved or turned enough to change the order
+		void rescore(std::vector<Task>& cancelled, bool force);
+		// Removes the entries matching pred from the heap, their cancel tasks are appended
+		template <typename Pred>
+		void removeIf(Pred pred, std::vector<Task>& cancelled, std::vector<Entry>* removed = nullptr);
+		// Starts queued jobs until the in flight limit is reached
+		void dispatch();
+		void start(Entry& entry);
+		void finished();
+
+		TaskPool& pool;
+		uint32_t maxInFlight;
+
+		mutable std::mutex mutex;
+		std::condition_variable idle;
+		std::vector<Entry> heap;
+		std::unordered_map<Key, uint64_t, KeyHash> queuedKeys; // sequence of the queued job per chunk and stage
+		uint64_t nextSequence = 0;
+		uint32_t inFlight = 0;
+		uint64_t completed = 0;
+		uint64_t cancelledJobs = 0;
+
+		// Camera in block coordinates, the direction is horizontal and normalised
+		float cameraX = 0.0f, cameraZ = 0.0f;
+		float viewX = 0.0f, viewZ = 0.0f;
+		bool hasDirection = false;
+		float halfFov = 0.0f; // radians
+		float cancelDistance = 0.0f;
+		// Camera when the heap was last ranked
+		float rankedX = 0.0f, rankedZ = 0.0f, rankedViewX = 0.0f, rankedViewZ = 0.0f;
+};
@@ -1,4 +1,6 @@
-#include "dataManager.h"
+#include <cstdio>
+#include "DataManager.h"
+#include "BlockDelta.h"
 #include "enkimi.h"
 
 // Chunk tags
@@ -19,49 +21,387 @@
 //yPos
 //zPos
 
-void DataManager::setup() {
-    
+namespace {
+    // Decoders keep per thread state between chunks
+    thread_local ChunkDecoder decoder;
 }
 
-void DataManager::read(int x, int z) {
-    
+// Lighting a lazy chunk would decode all of it, it gets lit once it is edited
+std::shared_ptr<LightEngine::Prepared> DataManager::prepareLight(const std::shared_ptr<const Chunk>& chunk) const {
+    if (chunk->lazy || !lighting.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return std::make_shared<LightEngine::Prepared>(LightEngine::prepareChunk(chunk));
+}
+
+void DataManager::setup(size_t maxChunks, uint32_t decodeThreads) {
+    std::vector<ChunkPos> evicted;
+    world.setMaxChunks(maxChunks, &evicted);
+    unloaded(evicted);
+    if (!decodePool) {
+        decodePool = std::make_unique<TaskPool>(decodeThreads);
+        scheduler = std::make_unique<ChunkScheduler>(*decodePool);
+    }
+}
+
+std::shared_ptr<const Chunk> DataManager::read(int x, int z) {
+    world.touch({ x, z });
+    std::shared_ptr<const Chunk> chunk = world.find({ x, z });
+    if (chunk) {
+        return chunk;
+    }
+
+    std::shared_ptr<const ChunkCache> baked;
+    {
+        std::lock_guard lock(cacheMutex);
+        baked = cache;
+    }
+    if (baked) {
+        std::shared_ptr<const Chunk> loaded = baked->load(ChunkPos{ x, z });
+        if (loaded) {
+            if (!decodePool) {
+                write(loaded);
+                return loaded;
+            }
+            // In order with decodes and edits, one of the same chunk that published since the
+            // lookup above is newer than the baked copy
+            ChunkOccupancy bits = OccupancyMap::build(*loaded);
+            std::shared_ptr<LightEngine::Prepared> lit = prepareLight(loaded);
+            publish(nextTicket.fetch_add(1), [this, loaded, bits = std::move(bits), lit = std::move(lit)]() mutable {
+                if (!world.find(loaded->pos)) {
+                    store(loaded, std::move(bits), std::move(lit));
+                }
+            });
+            return loaded;
+        }
+    }
+    if (scheduler) {
+        scheduler->boost({ x, z });
+    }
+    return nullptr;
+}
+
+void DataManager::write(std::shared_ptr<const Chunk> chunk) {
+    ChunkOccupancy bits = OccupancyMap::build(*chunk);
+    std::shared_ptr<LightEngine::Prepared> lit = prepareLight(chunk);
+    store(std::move(chunk), std::move(bits), std::move(lit));
+}
+
+// Occupancy and the light of the chunk on its own are built by the caller so decode threads can
+// do it before publishing, only the light exchange with the neighbours runs under the lock
+void DataManager::store(std::shared_ptr<const Chunk> chunk, ChunkOccupancy bits, std::shared_ptr<LightEngine::Prepared> lit) {
+    ChunkPos pos = chunk->pos;
+    std::vector<ChunkPos> evicted;
+    occupancy.insert(pos, std::move(bits));
+    if (lit) {
+        light.addChunk(std::move(*lit));
+    }
+    else {
+        light.removeChunk(pos);
+    }
+    world.insert(std::move(chunk), &evicted);
+    journal.push({ ChangeEvent::Type::ChunkLoaded, { pos.x, 0, pos.z }, 0 });
+    unloaded(evicted);
+}
+
+void DataManager::touch(const std::vector<ChunkPos>& positions) {
+    world.touch(positions);
+}
+
+void DataManager::unloadChunk(int x, int z) {
+    auto erase = [this, x, z]() {
+        if (world.erase({ x, z })) {
+            unloaded({ { x, z } });
+        }
+    };
+
+    if (!decodePool) {
+        erase();
+    }
+    else {
+        // A queued load of the chunk is stale now, one that is still decoding must not bring it back
+        scheduler->cancel({ x, z });
+        publish(nextTicket.fetch_add(1), std::move(erase));
+    }
+}
+
+void DataManager::unloadAll() {
+    auto erase = [this]() {
+        std::vector<ChunkPos> positions = world.positions();
+        for (ChunkPos pos : positions) {
+            world.erase(pos);
+        }
+        unloaded(positions);
+    };
+
+    if (!decodePool) {
+        erase();
+    }
+    else {
+        publish(nextTicket.fetch_add(1), std::move(erase));
+    }
+}
+
+void DataManager::setLighting(bool enabled) {
+    bool wasEnabled = lighting.exchange(enabled);
+    if (!wasEnabled || enabled) {
+        return;
+    }
+    // Chunks stored from now on are not lit, drop the light of the ones that are
+    if (!decodePool) {
+        light.clear();
+    }
+    else {
+        publish(nextTicket.fetch_add(1), [this]() { light.clear(); });
+    }
+}
+
+void DataManager::setMemoryBudget(size_t bytes) {
+    std::vector<ChunkPos> evicted;
+    world.setMemoryBudget(bytes, &evicted);
+    unloaded(evicted);
+}
+
+void DataManager::setViewer(double x, double z) {
+    world.setViewer(x / SECTION_SIZE, z / SECTION_SIZE);
+    if (scheduler) {
+        scheduler->setCameraPosition(x, z);
+    }
+}
+
+void DataManager::setViewDirection(const float direction[3], float fovY, float aspect) {
+    if (scheduler) {
+        scheduler->setCameraDirection(direction, fovY, aspect);
+    }
+}
+
+int32_t DataManager::height(int32_t x, int32_t z, HeightmapType type) const {
+    std::shared_ptr<const Chunk> chunk = world.find({ x >> 4, z >> 4 });
+    if (!chunk || chunk->heightmap(type).empty()) {
+        return INT32_MIN;
+    }
+    return chunk->heightmap(type).height(x & 15, z & 15);
+}
+
+bool DataManager::seesSky(BlockPos pos) const {
+    int32_t top = height(pos.x, pos.z);
+    return top != INT32_MIN && pos.y >= top;
+}
+
+bool DataManager::drainChanges(std::vector<ChangeEvent>& events) {
+    return journal.drain(events);
 }
 
-void DataManager::write() {
-    
+void DataManager::unloaded(const std::vector<ChunkPos>& positions) {
+    for (ChunkPos pos : positions) {
+        occupancy.erase(pos);
+        light.removeChunk(pos);
+        journal.push({ ChangeEvent::Type::ChunkUnloaded, { pos.x, 0, pos.z }, 0 });
+    }
 }
 
 void DataManager::close() {
-    
+    flush();
+    scheduler.reset();
+    decodePool.reset();
+    world.clear();
+    occupancy.clear();
+    light.clear();
+    std::lock_guard lock(cacheMutex);
+    cache.reset();
 }
 
 // Read chunk data from byte array and add to data
-void DataManager::readChunk(uint8_t* chunkData, int size) {
-    //auto* dataStream = new ByteArrayIStream(reinterpret_cast<const char*>(chunkData), size);
+void DataManager::readChunk(uint8_t* chunkData, int size, DecodeMode mode) {
+    std::shared_ptr<Chunk> chunk = decoder.decode(chunkData, static_cast<size_t>(size), mode);
+    if (chunk) {
+        write(std::move(chunk));
+    }
+}
 
-    enkiNBTDataStream stream;
-    //enkiInitNBTDataStreamForChunk(regionFile, i, &stream);
-    enkiNBTInitFromMemoryCompressed(&stream, chunkData, size, 0);
-    if (stream.dataLength)
-    {
-        enkiChunkBlockData aChunk = enkiNBTReadChunk(&stream);
-        enkiMICoordinate chunkOriginPos = enkiGetChunkOrigin(&aChunk);
-        
-        //printf("Chunk at xyz{ %d, %d, %d }  Number of sections: %d \n",
-            //chunkOriginPos.x/16, chunkOriginPos.y, chunkOriginPos.z/16, aChunk.countOfSections);
+void DataManager::submitChunk(std::vector<uint8_t> chunkData, DecodeMode mode) {
+    auto owned = std::make_shared<std::vector<uint8_t>>(std::move(chunkData));
+    submitChunk(owned->data(), owned->size(), [owned]() mutable { owned.reset(); }, mode);
+}
+
+void DataManager::submitChunk(const uint8_t* chunkData, size_t size, std::function<void()> release, DecodeMode mode) {
+    if (!decodePool) {
+        std::shared_ptr<Chunk> chunk = decoder.decode(chunkData, size, mode);
+        release();
+        if (chunk) {
+            write(std::move(chunk));
+        }
+        return;
+    }
+
+    uint64_t ticket = nextTicket.fetch_add(1);
+    decodePool->submit([this, ticket, chunkData, size, mode, release = std::move(release)]() {
+        decode(ticket, chunkData, size, release, mode);
+    });
+}
+
+void DataManager::submitChunk(ChunkPos pos, std::vector<uint8_t> chunkData, DecodeMode mode) {
+    auto owned = std::make_shared<std::vector<uint8_t>>(std::move(chunkData));
+    submitChunk(pos, owned->data(), owned->size(), [owned]() mutable { owned.reset(); }, mode);
+}
+
+void DataManager::submitChunk(ChunkPos pos, const uint8_t* chunkData, size_t size, std::function<void()> release, DecodeMode mode) {
+    if (!scheduler) {
+        submitChunk(chunkData, size, std::move(release), mode);
+        return;
+    }
+
+    // The ticket is taken when the job leaves the queue, so results are still published in the
+    // order the decodes started and edits of the chunk flush its queued decode first
+    auto ticket = std::make_shared<uint64_t>(0);
+    ChunkScheduler::Job job;
+    job.prepare = [this, ticket]() { *ticket = nextTicket.fetch_add(1); };
+    job.run = [this, ticket, chunkData, size, mode, release]() { decode(*ticket, chunkData, size, release, mode); };
+    job.cancel = std::move(release);
+    scheduler->submit(pos, ChunkScheduler::Stage::Decode, std::move(job));
+}
+
+void DataManager::decode(uint64_t ticket, const uint8_t* chunkData, size_t size, const std::function<void()>& release, DecodeMode mode) {
+    std::shared_ptr<Chunk> chunk = decoder.decode(chunkData, size, mode);
+    release();
+    ChunkOccupancy bits;
+    std::shared_ptr<LightEngine::Prepared> lit;
+    if (chunk) {
+        bits = OccupancyMap::build(*chunk);
+        lit = prepareLight(chunk);
     }
-    enkiNBTFreeAllocations(&stream);
+    publish(ticket, [this, chunk = std::move(chunk), bits = std::move(bits), lit = std::move(lit)]() mutable {
+        if (chunk) {
+            store(std::move(chunk), std::move(bits), std::move(lit));
+        }
+    });
+}
 
-    //nbt::io::stream_reader reader(*stream);
+size_t DataManager::submitRegion(std::shared_ptr<const RegionFile> region, int32_t regionX, int32_t regionZ, DecodeMode mode) {
+    size_t submitted = 0;
+    for (int32_t z = 0; z < RegionFile::CHUNKS_PER_SIDE; ++z) {
+        for (int32_t x = 0; x < RegionFile::CHUNKS_PER_SIDE; ++x) {
+            RegionFile::ChunkSpan span = region->chunk(x, z);
+            if (span.empty()) {
+                continue;
+            }
+            // No prefetch, the scheduler decides when the chunk is read
+            ChunkPos pos = { regionX * RegionFile::CHUNKS_PER_SIDE + x, regionZ * RegionFile::CHUNKS_PER_SIDE + z };
+            submitChunk(pos, span.data, span.size, [region]() mutable { region.reset(); }, mode);
+            ++submitted;
+        }
+    }
+    return submitted;
+}
 
-    //std::pair<std::string, std::unique_ptr<nbt::tag_compound>> data = reader.read_compound();
-    //nbt::tag_compound compound = *(data.second.get());
-    //for (std::pair<const std::string, nbt::value> pair : compound) {
-    //    //std::cout << pair.first << std::endl;
-    //}
+size_t DataManager::submitRegion(std::shared_ptr<const RegionFile> region, DecodeMode mode) {
+    size_t submitted = 0;
+    for (int32_t z = 0; z < RegionFile::CHUNKS_PER_SIDE; ++z) {
+        for (int32_t x = 0; x < RegionFile::CHUNKS_PER_SIDE; ++x) {
+            RegionFile::ChunkSpan span = region->chunk(x, z);
+            if (span.empty()) {
+                continue;
+            }
+            region->prefetch(x, z);
+            submitChunk(span.data, span.size, [region]() mutable { region.reset(); }, mode);
+            ++submitted;
+        }
+    }
+    return submitted;
 }
 
-void DataManager::readData(uint8_t* data, int size) {
-    enkiNBTDataStream stream;
-    enkiNBTInitFromMemoryCompressed(&stream, data, size, 0);
-}
\ No newline at end of file
+size_t DataManager::loadRegion(const std::string& path, DecodeMode mode) {
+    auto region = std::make_shared<RegionFile>();
+    if (!region->open(path)) {
+        return 0;
+    }
+    // Region files are named r.<x>.<z>.mca
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+    int32_t regionX, regionZ;
+    char extension[4] = {};
+    if (std::sscanf(name.c_str(), "r.%d.%d.%3s", &regionX, &regionZ, extension) == 3 && std::string(extension) == "mca") {
+        return submitRegion(std::move(region), regionX, regionZ, mode);
+    }
+    return submitRegion(std::move(region), mode);
+}
+
+bool DataManager::openCache(const std::string& path) {
+    auto opened = std::make_shared<ChunkCache>();
+    if (!opened->open(path)) {
+        return false;
+    }
+    std::lock_guard lock(cacheMutex);
+    cache = std::move(opened);
+    return true;
+}
+
+void DataManager::flush() {
+    if (scheduler) {
+        scheduler->wait();
+    }
+    if (decodePool) {
+        decodePool->wait();
+    }
+}
+
+// Keep results until every earlier ticket is done so a reloaded chunk never gets
+// overwritten by an older copy that finished decoding later, and block edits always
+// land on the chunk version they were sent for
+void DataManager::publish(uint64_t ticket, std::function<void()> result) {
+    std::lock_guard lock(publishMutex);
+    pendingResults.emplace(ticket, std::move(result));
+
+    auto it = pendingResults.begin();
+    while (it != pendingResults.end() && it->first == nextPublish) {
+        it->second();
+        it = pendingResults.erase(it);
+        ++nextPublish;
+    }
+}
+
+bool DataManager::applyBlockDelta(const uint8_t* data, size_t size) {
+    auto delta = std::make_shared<BlockDelta>();
+    if (!BlockDelta::parse(data, size, *delta)) {
+        std::cerr << "Ignoring malformed block delta of " << size << " bytes" << std::endl;
+        return false;
+    }
+
+    if (scheduler) {
+        // Decodes of edited chunks that are still queued must publish before the edits
+        for (const BlockDelta::ChunkEdits& edits : delta->chunks) {
+            scheduler->dispatchNow(edits.pos);
+        }
+    }
+
+    auto apply = [this, delta]() {
+        std::vector<int32_t> touched;
+        for (BlockDelta::ChunkEdits& edits : delta->chunks) {
+            std::shared_ptr<const Chunk> chunk = world.find(edits.pos);
+            if (!chunk) {
+                continue; // not resident, Java resends the chunk when it comes back into range
+            }
+            touched.clear();
+            std::shared_ptr<const Chunk> edited = applyEdits(*chunk, std::move(edits.edits), touched);
+            // Same position, replacing never evicts
+            world.insert(edited);
+            if (lighting.load(std::memory_order_relaxed)) {
+                light.updateChunk(edited, touched);
+            }
+
+            for (int32_t y : touched) {
+                const Section* section = edited->section(y);
+                occupancy.updateSection(edits.pos, *section);
+                journal.push({ ChangeEvent::Type::SectionChanged, { edits.pos.x, y, edits.pos.z }, section->generation });
+            }
+        }
+    };
+
+    if (!decodePool) {
+        apply();
+    }
+    else {
+        // Runs right away unless chunks submitted before it are still decoding
+        publish(nextTicket.fetch_add(1), std::move(apply));
+    }
+    return true;
+}
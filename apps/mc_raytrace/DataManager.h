@@ -1,20 +1,117 @@
 #pragma once
 
-#include <windows.h>
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
+#include "ChangeJournal.h"
+#include "ChunkCache.h"
+#include "ChunkDecoder.h"
+#include "ChunkScheduler.h"
 #include "DataStructures.h"
+#include "LightEngine.h"
+#include "OccupancyMap.h"
+#include "RegionFile.h"
+#include "TaskPool.h"
+#include "WorldStore.h"
 
 class DataManager {
 	public:
-		void setup();
-		void read(int x, int z);
-		void write();
+		void setup(size_t maxChunks = 4096, uint32_t decodeThreads = 0);
+		// Marks the chunk as used for eviction. A chunk that is still waiting to be decoded is
+		// moved to the front of the queue. Chunks missing from the store are served from the
+		// cache when one is open, they are stored in order with submitted chunks.
+		std::shared_ptr<const Chunk> read(int x, int z);
+		void write(std::shared_ptr<const Chunk> chunk);
+		// Marks chunks as used for eviction, the renderer passes the chunks it draws every frame
+		void touch(const std::vector<ChunkPos>& positions);
+		// Drop a chunk, in order with submitted chunks
+		void unloadChunk(int x, int z);
+		// Drop every resident chunk together with its occupancy and light, in order with submitted chunks
+		void unloadAll();
 		void close();
-        void readChunk(uint8_t* chunkData, int size);
-        void readData(uint8_t* data, int size);
+        void readChunk(uint8_t* chunkData, int size, DecodeMode mode = DecodeMode::Eager);
+
+        // Decode on the decode pool, chunks are published to the world store in submission order.
+        // Lazy mode suits chunks that are only needed for LOD or sky visibility.
+        void submitChunk(std::vector<uint8_t> chunkData, DecodeMode mode = DecodeMode::Eager);
+        // Borrowed bytes must stay valid until release is called, which happens on a decode thread
+        // as soon as the data is no longer needed
+        void submitChunk(const uint8_t* chunkData, size_t size, std::function<void()> release, DecodeMode mode = DecodeMode::Eager);
+        // Chunks whose position is known up front wait in the scheduler and are decoded nearest
+        // to the camera first. A newer copy of the same chunk replaces one that has not started yet.
+        void submitChunk(ChunkPos pos, std::vector<uint8_t> chunkData, DecodeMode mode = DecodeMode::Eager);
+        void submitChunk(ChunkPos pos, const uint8_t* chunkData, size_t size, std::function<void()> release, DecodeMode mode = DecodeMode::Eager);
+        // Submit every chunk of a region without copying, the region stays mapped until the last
+        // of its chunks is decoded. Returns the number of chunks submitted.
+        size_t submitRegion(std::shared_ptr<const RegionFile> region, DecodeMode mode = DecodeMode::Eager);
+        // Same, for a region at known region coordinates so its chunks are scheduled by distance
+        size_t submitRegion(std::shared_ptr<const RegionFile> region, int32_t regionX, int32_t regionZ, DecodeMode mode = DecodeMode::Eager);
+        size_t loadRegion(const std::string& path, DecodeMode mode = DecodeMode::Eager);
+        // Serve chunks missing from the world store from a pre-baked cache, see ChunkCache
+        bool openCache(const std::string& path);
+        // Wait until every submitted chunk has been published
+        void flush();
+
+        // Apply a batch of block edits in the BlockDelta format, in order with submitted chunks.
+        // Returns false if the batch is malformed, nothing is applied then.
+        bool applyBlockDelta(const uint8_t* data, size_t size);
+        // Loads, unloads and section edits since the last call, meant to be drained once per frame.
+        // Returns true if the journal overflowed and events were lost, rescan everything then.
+        bool drainChanges(std::vector<ChangeEvent>& events);
+
+        // Resident chunks are evicted to stay within the budget, ranked by last use and distance to the viewer
+        void setMemoryBudget(size_t bytes);
+        // Block coordinates
+        void setViewer(double x, double z);
+        // Ranks queued decodes by the view cone, see ChunkScheduler::setCameraDirection
+        void setViewDirection(const float direction[3], float fovY, float aspect);
+
+        // Block y just above the highest block of the column that the heightmap tracks, read from
+        // the chunk's heightmaps without touching its blocks. INT32_MIN when the chunk is not
+        // resident or came without heightmaps (lazy chunks saved before they were fully generated).
+        int32_t height(int32_t x, int32_t z, HeightmapType type = HeightmapType::MotionBlocking) const;
+        // Nothing that blocks motion above the block, false when that is not known
+        bool seesSky(BlockPos pos) const;
+
+        WorldStore& worldStore() { return world; }
+        // Visible blocks of the resident chunks, follows loads, edits and unloads
+        const OccupancyMap& occupancyMap() const { return occupancy; }
+        // Block and sky light of the resident chunks that are decoded eagerly
+        const LightEngine& lightEngine() const { return light; }
+        // On by default. Tools that never read light turn it off before submitting chunks,
+        // the light of resident chunks is dropped then.
+        void setLighting(bool enabled);
+        // Decode queue once setup() ran, mesh and upload jobs of the renderer can share it
+        ChunkScheduler* chunkScheduler() { return scheduler.get(); }
 	private:
-        std::vector<ChunkPos> chunkPositions;
+        void decode(uint64_t ticket, const uint8_t* chunkData, size_t size, const std::function<void()>& release, DecodeMode mode);
+        void publish(uint64_t ticket, std::function<void()> result);
+        void store(std::shared_ptr<const Chunk> chunk, ChunkOccupancy bits, std::shared_ptr<LightEngine::Prepared> lit);
+        void unloaded(const std::vector<ChunkPos>& positions);
+        // Light of the chunk on its own, null when it is not lit
+        std::shared_ptr<LightEngine::Prepared> prepareLight(const std::shared_ptr<const Chunk>& chunk) const;
+
+        WorldStore world;
+        OccupancyMap occupancy;
+        LightEngine light;
+        std::atomic<bool> lighting{ true };
+
+        std::unique_ptr<TaskPool> decodePool;
+        std::unique_ptr<ChunkScheduler> scheduler;
+        std::atomic<uint64_t> nextTicket{ 0 };
+        std::mutex publishMutex;
+        std::map<uint64_t, std::function<void()>> pendingResults; // finished out of order, waiting to be published
+        uint64_t nextPublish = 0;
+
+        ChangeJournal journal;
+
+        std::mutex cacheMutex;
+        std::shared_ptr<const ChunkCache> cache;
 };
 
 // Stream stuff for import \\
@@ -35,4 +132,3 @@ public:
 private:
     ByteArrayStreamBuf buffer;
 };
-
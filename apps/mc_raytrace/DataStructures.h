@@ -1,9 +1,144 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
 // Data structures \\
 
-struct ChunkPos { int32_t x; int32_t z; };
+struct ChunkPos {
+    int32_t x; int32_t z;
+
+    bool operator==(const ChunkPos& other) const { return x == other.x && z == other.z; }
+    bool operator!=(const ChunkPos& other) const { return !(*this == other); }
+};
+
+struct ChunkPosHash {
+    size_t operator()(const ChunkPos& pos) const {
+        uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(pos.x)) << 32) | static_cast<uint32_t>(pos.z);
+        return std::hash<uint64_t>()(key);
+    }
+};
 
 struct BlockPos { int32_t x; int32_t y; int32_t z; };
 
-struct Section { int32_t y; };
\ No newline at end of file
+// Section coordinates, y is the section index (block y >> 4)
+struct SectionPos {
+    int32_t x; int32_t y; int32_t z;
+
+    bool operator==(const SectionPos& other) const { return x == other.x && y == other.y && z == other.z; }
+    bool operator!=(const SectionPos& other) const { return !(*this == other); }
+};
+
+struct SectionPosHash {
+    size_t operator()(const SectionPos& pos) const {
+        uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(pos.x)) << 40) ^
+                       (static_cast<uint64_t>(static_cast<uint32_t>(pos.z)) << 12) ^
+                       static_cast<uint64_t>(static_cast<uint32_t>(pos.y) & 0xFFF);
+        return std::hash<uint64_t>()(key);
+    }
+};
+
+// Chunk section dimensions, same layout as the anvil format (index = y * 256 + z * 16 + x)
+constexpr int32_t SECTION_SIZE = 16;
+constexpr int32_t SECTION_VOLUME = SECTION_SIZE * SECTION_SIZE * SECTION_SIZE;
+
+inline uint32_t sectionIndex(int32_t x, int32_t y, int32_t z) {
+    return static_cast<uint32_t>((y * SECTION_SIZE + z) * SECTION_SIZE + x);
+}
+
+// 16x16x16 block states.
+// Blocks are indices into a section local palette of global block state ids, packed at the
+// smallest power of two bit width that fits the palette so an entry never straddles two words.
+// A section made of a single block state (all air, all stone) stores no block data at all.
+struct Section {
+    int32_t y;
+    // Unique per section version, consumers compare it to what they last processed
+    uint64_t generation = 0;
+    std::vector<uint16_t> palette; // global block state ids
+    uint8_t bitsPerBlock = 0;      // 0, 1, 2, 4, 8 or 16
+    std::vector<uint64_t> data;    // SECTION_VOLUME * bitsPerBlock / 64 words
+
+    // Build a packed section from SECTION_VOLUME global block state ids
+    static std::shared_ptr<Section> pack(int32_t y, const uint16_t* states);
+    static uint64_t nextGeneration();
+
+    uint16_t stateAt(uint32_t index) const {
+        if (bitsPerBlock == 0) {
+            return palette[0];
+        }
+        uint32_t bit = index * bitsPerBlock;
+        uint32_t mask = (1u << bitsPerBlock) - 1;
+        return palette[static_cast<uint32_t>(data[bit >> 6] >> (bit & 63)) & mask];
+    }
+    uint16_t blockAt(int32_t x, int32_t y, int32_t z) const { return stateAt(sectionIndex(x, y, z)); }
+    // In place edit, only for sections that are not shared yet. Repacks when the palette outgrows the bit width.
+    void set(uint32_t index, uint16_t state);
+    bool isUniform() const { return bitsPerBlock == 0; }
+
+    // Expand to SECTION_VOLUME global block state ids
+    void unpack(uint16_t* states) const;
+    size_t memoryUsage() const;
+};
+
+struct Chunk;
+
+// Which blocks a heightmap tracks, same as the Heightmaps entries of the chunk NBT
+enum class HeightmapType : uint8_t {
+    MotionBlocking, // blocks that stop movement or hold fluid, first thing hiding the sky
+    WorldSurface,   // any block but air
+    Count
+};
+
+// For every column of a chunk the block y just above its highest block of one type.
+// Packed like the anvil format, floor(64 / bitsPerEntry) entries per word starting at the least
+// significant bit, index z * 16 + x. Entries are relative to minY, 0 is a column without any
+// matching block.
+struct Heightmap {
+    int32_t minY = 0;
+    uint8_t bitsPerEntry = 0; // 0 when the chunk has no such heightmap
+    std::vector<uint64_t> data;
+
+    // From a raw big endian long array of the chunk NBT. Before 1.16 entries span two longs.
+    // Stays empty when the array length does not fit 256 entries.
+    static Heightmap fromNbt(const uint8_t* longs, uint32_t numLongs, int32_t minY, bool spanning);
+    // Scans the chunk's blocks, decodes lazy sections
+    static Heightmap compute(const Chunk& chunk, HeightmapType type);
+    // Whether a block state counts for a heightmap type
+    static bool matches(HeightmapType type, uint16_t state);
+
+    bool empty() const { return bitsPerEntry == 0; }
+    // Local column coordinates. minY for an empty column.
+    int32_t height(int32_t x, int32_t z) const {
+        uint32_t index = static_cast<uint32_t>(z * SECTION_SIZE + x);
+        uint32_t perWord = 64u / bitsPerEntry;
+        uint32_t shift = (index % perWord) * bitsPerEntry;
+        return minY + static_cast<int32_t>((data[index / perWord] >> shift) & ((1u << bitsPerEntry) - 1));
+    }
+    // Rescans one column of chunk from the top, widens entries when the height does not fit
+    void update(const Chunk& chunk, HeightmapType type, int32_t x, int32_t z);
+    size_t memoryUsage() const { return data.capacity() * sizeof(uint64_t); }
+};
+
+class LazySections;
+
+// A decoded chunk column. Chunks are immutable once stored, sections are shared between
+// versions of a chunk so an edit only has to copy the sections it touches.
+// Lazily decoded chunks leave sections empty and decode each section on first access,
+// go through section(), sectionCount() and sectionAt() to handle both kinds.
+struct Chunk {
+    ChunkPos pos;
+    int32_t dataVersion;
+    std::vector<std::shared_ptr<const Section>> sections; // sorted by y
+    std::shared_ptr<const LazySections> lazy;
+    Heightmap heightmaps[static_cast<size_t>(HeightmapType::Count)];
+
+    const Section* section(int32_t y) const;
+    size_t sectionCount() const;
+    // Sorted by y
+    std::shared_ptr<const Section> sectionAt(size_t i) const;
+    const Heightmap& heightmap(HeightmapType type) const { return heightmaps[static_cast<size_t>(type)]; }
+    size_t memoryUsage() const;
+};
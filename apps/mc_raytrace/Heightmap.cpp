@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <bit>
+#include "DataStructures.h"
+#include "BlockStateRegistry.h"
+#include "ChunkMesher.h"
+
+namespace {
+    constexpr int32_t COLUMNS = SECTION_SIZE * SECTION_SIZE;
+
+    // Cutout blocks without collision, everything else that is drawn stops movement
+    const std::string_view PASSABLE_PARTS[] = {
+        "torch", "sapling", "flower", "tulip", "fern", "grass", "vine", "rail", "sign", "banner",
+        "button", "pressure_plate", "roots", "sprouts", "coral", "lever", "bush",
+    };
+    const std::string_view PASSABLE_NAMES[] = {
+        "cobweb", "sugar_cane", "poppy", "dandelion", "cornflower", "allium", "azure_bluet",
+        "oxeye_daisy", "lily_of_the_valley", "wheat", "carrots", "potatoes", "beetroots",
+        "redstone_wire", "red_mushroom", "brown_mushroom",
+    };
+
+    bool classify(HeightmapType type, const BlockState& state) {
+        std::string_view name = state.name;
+        if (size_t colon = name.find(':'); colon != std::string_view::npos) {
+            name = name.substr(colon + 1);
+        }
+        if (name == "air" || name == "cave_air" || name == "void_air") {
+            return false;
+        }
+        if (type == HeightmapType::WorldSurface) {
+            return true;
+        }
+        for (const auto& [key, value] : state.properties) {
+            if (key == "waterlogged" && value == "true") {
+                return true;
+            }
+        }
+        switch (ChunkMesher::classify(state)) {
+            case BlockMaterial::Invisible:
+                return name == "barrier";
+            case BlockMaterial::Cutout:
+                for (std::string_view part : PASSABLE_PARTS) {
+                    if (name.find(part) != std::string_view::npos) {
+                        return false;
+                    }
+                }
+                return std::find(std::begin(PASSABLE_NAMES), std::end(PASSABLE_NAMES), name) == std::end(PASSABLE_NAMES);
+            default:
+                return true;
+        }
+    }
+
+    // Entries are wide enough for every height of the chunk's sections
+    uint8_t bitsForRange(int32_t range) {
+        return static_cast<uint8_t>(std::max(1, static_cast<int32_t>(std::bit_width(static_cast<uint32_t>(std::max(range, 1))))));
+    }
+
+    uint64_t readLong(const uint8_t* longs, uint32_t i) {
+        uint64_t word = 0;
+        for (int32_t b = 0; b < 8; ++b) {
+            word = (word << 8) | longs[i * 8 + b];
+        }
+        return word;
+    }
+
+    // Block y above the highest matching block of a local column, minY when there is none
+    int32_t scan(const Chunk& chunk, HeightmapType type, int32_t x, int32_t z, int32_t minY) {
+        for (size_t i = chunk.sectionCount(); i-- > 0;) {
+            std::shared_ptr<const Section> section = chunk.sectionAt(i);
+            int32_t base = section->y * SECTION_SIZE;
+            if (section->isUniform()) {
+                if (Heightmap::matches(type, section->palette[0])) {
+                    return std::max(base + SECTION_SIZE, minY);
+                }
+                continue;
+            }
+            for (int32_t y = SECTION_SIZE - 1; y >= 0; --y) {
+                if (Heightmap::matches(type, section->blockAt(x, y, z))) {
+                    return std::max(base + y + 1, minY);
+                }
+            }
+        }
+        return minY;
+    }
+
+    void setEntry(Heightmap& heightmap, uint32_t index, uint32_t value) {
+        uint32_t perWord = 64u / heightmap.bitsPerEntry;
+        uint32_t shift = (index % perWord) * heightmap.bitsPerEntry;
+        uint64_t mask = ((uint64_t(1) << heightmap.bitsPerEntry) - 1) << shift;
+        uint64_t& word = heightmap.data[index / perWord];
+        word = (word & ~mask) | (static_cast<uint64_t>(value) << shift);
+    }
+
+    void resize(Heightmap& heightmap, uint8_t bits) {
+        heightmap.bitsPerEntry = bits;
+        heightmap.data.assign((COLUMNS + 64 / bits - 1) / (64 / bits), 0);
+    }
+}
+
+bool Heightmap::matches(HeightmapType type, uint16_t state) {
+    // Per thread so decode threads never share the table, bit 0 is set once classified
+    thread_local std::vector<uint8_t> flags;
+    if (state >= flags.size()) {
+        flags.resize(std::max(BlockStateRegistry::instance().size(), static_cast<size_t>(state) + 1), 0);
+    }
+    uint8_t& flag = flags[state];
+    if (!flag) {
+        const BlockState& blockState = BlockStateRegistry::instance().state(state);
+        flag = 1;
+        for (int32_t t = 0; t < static_cast<int32_t>(HeightmapType::Count); ++t) {
+            flag |= classify(static_cast<HeightmapType>(t), blockState) ? 2 << t : 0;
+        }
+    }
+    return (flag >> (static_cast<int32_t>(type) + 1)) & 1;
+}
+
+Heightmap Heightmap::fromNbt(const uint8_t* longs, uint32_t numLongs, int32_t minY, bool spanning) {
+    Heightmap heightmap;
+    if (!longs || numLongs == 0) {
+        return heightmap;
+    }
+
+    uint8_t bits = 0;
+    if (spanning) {
+        if (numLongs * 64 % COLUMNS == 0 && numLongs * 64 / COLUMNS <= 16) {
+            bits = static_cast<uint8_t>(numLongs * 64 / COLUMNS);
+        }
+    }
+    else {
+        // Widths with the same number of entries per word give the same length, take the narrowest.
+        // Default worlds of 256 and 384 blocks use 9 bits, which is unambiguous.
+        for (uint32_t candidate = 1; candidate <= 16 && !bits; ++candidate) {
+            uint32_t perWord = 64 / candidate;
+            bits = (COLUMNS + perWord - 1) / perWord == numLongs ? static_cast<uint8_t>(candidate) : 0;
+        }
+    }
+    if (bits == 0) {
+        return heightmap;
+    }
+
+    heightmap.minY = minY;
+    if (!spanning) {
+        heightmap.bitsPerEntry = bits;
+        heightmap.data.resize(numLongs);
+        for (uint32_t i = 0; i < numLongs; ++i) {
+            heightmap.data[i] = readLong(longs, i);
+        }
+        return heightmap;
+    }
+
+    // Repack so lookups never straddle two words
+    resize(heightmap, bits);
+    const uint64_t mask = (uint64_t(1) << bits) - 1;
+    for (uint32_t i = 0; i < COLUMNS; ++i) {
+        uint32_t bit = i * bits;
+        uint64_t value = readLong(longs, bit >> 6) >> (bit & 63);
+        if ((bit & 63) + bits > 64) {
+            value |= readLong(longs, (bit >> 6) + 1) << (64 - (bit & 63));
+        }
+        setEntry(heightmap, i, static_cast<uint32_t>(value & mask));
+    }
+    return heightmap;
+}
+
+Heightmap Heightmap::compute(const Chunk& chunk, HeightmapType type) {
+    Heightmap heightmap;
+    size_t count = chunk.sectionCount();
+    if (count == 0) {
+        return heightmap;
+    }
+    int32_t bottom = chunk.sectionAt(0)->y, top = chunk.sectionAt(count - 1)->y + 1;
+    heightmap.minY = std::min(bottom, 0) * SECTION_SIZE;
+    resize(heightmap, bitsForRange(top * SECTION_SIZE - heightmap.minY));
+    for (int32_t z = 0; z < SECTION_SIZE; ++z) {
+        for (int32_t x = 0; x < SECTION_SIZE; ++x) {
+            int32_t height = scan(chunk, type, x, z, heightmap.minY);
+            setEntry(heightmap, static_cast<uint32_t>(z * SECTION_SIZE + x), static_cast<uint32_t>(height - heightmap.minY));
+        }
+    }
+    return heightmap;
+}
+
+void Heightmap::update(const Chunk& chunk, HeightmapType type, int32_t x, int32_t z) {
+    if (empty()) {
+        *this = compute(chunk, type);
+        return;
+    }
+    uint32_t value = static_cast<uint32_t>(scan(chunk, type, x, z, minY) - minY);
+    if (std::bit_width(value) > bitsPerEntry) {
+        // Edited above the heights the chunk came with
+        Heightmap wider;
+        wider.minY = minY;
+        resize(wider, static_cast<uint8_t>(std::bit_width(value)));
+        for (uint32_t i = 0; i < COLUMNS; ++i) {
+            setEntry(wider, i, static_cast<uint32_t>(height(i % SECTION_SIZE, i / SECTION_SIZE) - minY));
+        }
+        *this = std::move(wider);
+    }
+    setEntry(*this, static_cast<uint32_t>(z * SECTION_SIZE + x), value);
+}
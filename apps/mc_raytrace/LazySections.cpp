@@ -0,0 +1,292 @@
+#include <algorithm>
+#include "LazySections.h"
+#include "BlockStateRegistry.h"
+#include "NbtReader.h"
+#include "UnpackBits.h"
+
+namespace {
+    // First version whose block data never spans two longs (1.16)
+    constexpr int32_t NON_SPANNING_DATA_VERSION = 2556;
+    constexpr size_t MAX_PROPERTIES = 16;
+
+    struct SectionOffsets {
+        int32_t y = 0;
+        size_t palette = 0;
+        size_t data = 0;
+        uint32_t numLongs = 0;
+        bool hasPalette = false;
+    };
+
+    // Skips a palette list or block data array and records where its payload starts
+    void recordPalette(nbt::Reader& reader, uint8_t type, SectionOffsets& offsets) {
+        if (type == nbt::TAG_List) {
+            offsets.palette = reader.position();
+            offsets.hasPalette = true;
+        }
+        reader.skip(type);
+    }
+
+    void recordData(nbt::Reader& reader, uint8_t type, SectionOffsets& offsets) {
+        if (type != nbt::TAG_Long_Array) {
+            reader.skip(type);
+            return;
+        }
+        int32_t numLongs = reader.i32();
+        offsets.data = reader.position();
+        offsets.numLongs = numLongs > 0 ? static_cast<uint32_t>(numLongs) : 0;
+        reader.take(static_cast<size_t>(offsets.numLongs) * 8);
+    }
+
+    // One compound of the sections list, 1.18+ nests the block data in block_states
+    void indexSection(nbt::Reader& reader, SectionOffsets& offsets) {
+        uint8_t type;
+        std::string_view name;
+        while (reader.nextTag(type, name)) {
+            if (name == "Y" && type == nbt::TAG_Byte) {
+                offsets.y = static_cast<int8_t>(reader.u8());
+            }
+            else if (name == "Y" && type == nbt::TAG_Int) {
+                offsets.y = reader.i32();
+            }
+            else if (name == "block_states" && type == nbt::TAG_Compound) {
+                uint8_t childType;
+                std::string_view childName;
+                while (reader.nextTag(childType, childName)) {
+                    if (childName == "palette") {
+                        recordPalette(reader, childType, offsets);
+                    }
+                    else if (childName == "data") {
+                        recordData(reader, childType, offsets);
+                    }
+                    else {
+                        reader.skip(childType);
+                    }
+                }
+            }
+            else if (name == "Palette") {
+                recordPalette(reader, type, offsets);
+            }
+            else if (name == "BlockStates") {
+                recordData(reader, type, offsets);
+            }
+            else {
+                reader.skip(type);
+            }
+        }
+    }
+
+    struct HeightmapArray {
+        const uint8_t* longs = nullptr;
+        uint32_t numLongs = 0;
+    };
+
+    // Remembers the arrays of a Heightmaps compound, they stay in the caller's buffer
+    void recordHeightmaps(nbt::Reader& reader, HeightmapArray (&arrays)[static_cast<size_t>(HeightmapType::Count)]) {
+        uint8_t type;
+        std::string_view name;
+        while (reader.nextTag(type, name)) {
+            HeightmapArray* array = nullptr;
+            if (name == "MOTION_BLOCKING") {
+                array = &arrays[static_cast<size_t>(HeightmapType::MotionBlocking)];
+            }
+            else if (name == "WORLD_SURFACE") {
+                array = &arrays[static_cast<size_t>(HeightmapType::WorldSurface)];
+            }
+            if (!array || type != nbt::TAG_Long_Array) {
+                reader.skip(type);
+                continue;
+            }
+            int32_t numLongs = reader.i32();
+            array->numLongs = numLongs > 0 ? static_cast<uint32_t>(numLongs) : 0;
+            array->longs = reader.take(static_cast<size_t>(array->numLongs) * 8);
+        }
+    }
+
+    // Palettes are padded to at least 4 bits, fall back to the width that matches the array length
+    uint32_t bitsForData(uint32_t paletteSize, uint32_t numLongs) {
+        uint32_t bits = 4;
+        while (bits < 16 && (1u << bits) < paletteSize) {
+            ++bits;
+        }
+        for (uint32_t candidate = bits; candidate <= 16; ++candidate) {
+            if (packedLongCount(candidate, SECTION_VOLUME) == numLongs) {
+                return candidate;
+            }
+        }
+        return 0;
+    }
+}
+
+std::shared_ptr<Chunk> LazySections::makeChunk(const uint8_t* nbt, size_t size) {
+    nbt::Reader reader(nbt, size);
+    if (reader.u8() != nbt::TAG_Compound) {
+        return nullptr;
+    }
+    reader.string();
+
+    ChunkPos pos = { 0, 0 };
+    int32_t dataVersion = 0;
+    int32_t minSectionY = 0;
+    size_t listStart = 0, listEnd = 0;
+    HeightmapArray heightmaps[static_cast<size_t>(HeightmapType::Count)];
+
+    // Pre 1.18 chunks keep everything but DataVersion in a Level compound
+    int depth = 0;
+    uint8_t type;
+    std::string_view name;
+    while (true) {
+        if (!reader.nextTag(type, name)) {
+            if (depth == 0 || !reader.ok()) {
+                break;
+            }
+            --depth;
+            continue;
+        }
+        if (name == "DataVersion" && type == nbt::TAG_Int) {
+            dataVersion = reader.i32();
+        }
+        else if (name == "xPos" && type == nbt::TAG_Int) {
+            pos.x = reader.i32();
+        }
+        else if (name == "zPos" && type == nbt::TAG_Int) {
+            pos.z = reader.i32();
+        }
+        else if (name == "yPos" && type == nbt::TAG_Int) {
+            minSectionY = reader.i32();
+        }
+        else if (name == "Heightmaps" && type == nbt::TAG_Compound) {
+            recordHeightmaps(reader, heightmaps);
+        }
+        else if (name == "Level" && type == nbt::TAG_Compound && depth == 0) {
+            ++depth;
+        }
+        else if ((name == "sections" || name == "Sections") && type == nbt::TAG_List) {
+            listStart = reader.position();
+            reader.skip(type);
+            listEnd = reader.position();
+        }
+        else {
+            reader.skip(type);
+        }
+    }
+    if (!reader.ok() || dataVersion < NON_SPANNING_DATA_VERSION || listEnd == 0) {
+        return nullptr;
+    }
+
+    auto lazy = std::make_shared<LazySections>();
+    lazy->raw.assign(nbt + listStart, nbt + listEnd);
+
+    nbt::Reader list(lazy->raw.data(), lazy->raw.size());
+    uint8_t elementType = list.u8();
+    int32_t numSections = list.i32();
+    std::vector<SectionOffsets> found;
+    if (elementType == nbt::TAG_Compound) {
+        for (int32_t i = 0; i < numSections && list.ok(); ++i) {
+            SectionOffsets offsets;
+            indexSection(list, offsets);
+            // Sections above and below the world only carry light
+            if (offsets.hasPalette) {
+                found.push_back(offsets);
+            }
+        }
+    }
+    if (!list.ok()) {
+        return nullptr;
+    }
+
+    std::sort(found.begin(), found.end(), [](const SectionOffsets& a, const SectionOffsets& b) { return a.y < b.y; });
+    lazy->count = found.size();
+    lazy->slots.reset(new Slot[found.size()]);
+    for (size_t i = 0; i < found.size(); ++i) {
+        Slot& slot = lazy->slots[i];
+        slot.y = found[i].y;
+        slot.palette = static_cast<uint32_t>(found[i].palette);
+        slot.data = static_cast<uint32_t>(found[i].data);
+        slot.numLongs = found[i].numLongs;
+    }
+
+    auto chunk = std::make_shared<Chunk>();
+    chunk->pos = pos;
+    chunk->dataVersion = dataVersion;
+    chunk->lazy = std::move(lazy);
+    // Computing missing heightmaps would decode every section, leave them empty
+    for (size_t i = 0; i < static_cast<size_t>(HeightmapType::Count); ++i) {
+        chunk->heightmaps[i] = Heightmap::fromNbt(heightmaps[i].longs, heightmaps[i].numLongs, minSectionY * SECTION_SIZE, false);
+    }
+    return chunk;
+}
+
+int32_t LazySections::find(int32_t y) const {
+    const Slot* begin = slots.get();
+    const Slot* end = begin + count;
+    const Slot* it = std::lower_bound(begin, end, y, [](const Slot& slot, int32_t sectionY) { return slot.y < sectionY; });
+    return it != end && it->y == y ? static_cast<int32_t>(it - begin) : -1;
+}
+
+const std::shared_ptr<const Section>& LazySections::section(size_t i) const {
+    Slot& slot = slots[i];
+    std::call_once(slot.once, [&] {
+        slot.decoded = decode(slot);
+        decodedBytes += slot.decoded->memoryUsage();
+    });
+    return slot.decoded;
+}
+
+size_t LazySections::memoryUsage() const {
+    return sizeof(LazySections) + raw.capacity() + count * sizeof(Slot) + decodedBytes.load(std::memory_order_relaxed);
+}
+
+std::shared_ptr<const Section> LazySections::decode(const Slot& slot) const {
+    BlockStateRegistry& registry = BlockStateRegistry::instance();
+    uint16_t states[SECTION_VOLUME];
+
+    nbt::Reader reader(raw.data(), raw.size(), slot.palette);
+    uint8_t elementType = reader.u8();
+    int32_t paletteSize = reader.i32();
+    std::vector<uint16_t> paletteStates;
+    for (int32_t i = 0; i < paletteSize && elementType == nbt::TAG_Compound && reader.ok(); ++i) {
+        std::string_view blockName = "minecraft:air";
+        BlockProperty properties[MAX_PROPERTIES];
+        size_t numProperties = 0;
+
+        uint8_t type;
+        std::string_view name;
+        while (reader.nextTag(type, name)) {
+            if (name == "Name" && type == nbt::TAG_String) {
+                blockName = reader.string();
+            }
+            else if (name == "Properties" && type == nbt::TAG_Compound) {
+                uint8_t propertyType;
+                std::string_view propertyName;
+                while (reader.nextTag(propertyType, propertyName)) {
+                    if (propertyType == nbt::TAG_String && numProperties < MAX_PROPERTIES) {
+                        properties[numProperties++] = { propertyName, reader.string() };
+                    }
+                    else {
+                        reader.skip(propertyType);
+                    }
+                }
+            }
+            else {
+                reader.skip(type);
+            }
+        }
+        paletteStates.push_back(registry.id(blockName, properties, numProperties));
+    }
+    if (!reader.ok() || paletteStates.empty()) {
+        paletteStates.assign(1, BlockStateRegistry::AIR);
+    }
+
+    uint32_t bits = slot.numLongs ? bitsForData(static_cast<uint32_t>(paletteStates.size()), slot.numLongs) : 0;
+    if (bits == 0) {
+        // Single entry palettes come without data
+        std::fill(states, states + SECTION_VOLUME, paletteStates[0]);
+    }
+    else {
+        unpackBits(raw.data() + slot.data, bits, SECTION_VOLUME, states);
+        for (uint16_t& state : states) {
+            state = paletteStates[state < paletteStates.size() ? state : 0];
+        }
+    }
+    return Section::pack(slot.y, states);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "DataStructures.h"
+
+// Sections of a chunk that are only decoded when first accessed.
+// Indexing walks the NBT once and remembers where each section's palette and block data
+// are, without interning any block states. The raw section list is kept until the chunk
+// is dropped, so chunks that are only needed for LOD or sky visibility stay cheap.
+class LazySections {
+	public:
+		// Builds a lazy chunk from uncompressed chunk NBT. Returns nullptr when the layout
+		// can not be read lazily (before 1.16 block data spans longs), decode eagerly then.
+		static std::shared_ptr<Chunk> makeChunk(const uint8_t* nbt, size_t size);
+
+		size_t size() const { return count; }
+		int32_t sectionY(size_t i) const { return slots[i].y; }
+		// False for sections of a single block state, which are cheap to decode
+		bool hasBlockData(size_t i) const { return slots[i].numLongs != 0; }
+		// Position of the section at y, -1 if the chunk has none
+		int32_t find(int32_t y) const;
+		// Decodes on first call, thread safe
+		const std::shared_ptr<const Section>& section(size_t i) const;
+		size_t memoryUsage() const;
+	private:
+		struct Slot {
+			int32_t y = 0;
+			uint32_t palette = 0;  // offset of the palette list payload in raw
+			uint32_t data = 0;     // offset of the long array elements in raw
+			uint32_t numLongs = 0;
+			std::once_flag once;
+			std::shared_ptr<const Section> decoded;
+		};
+
+		std::shared_ptr<const Section> decode(const Slot& slot) const;
+
+		std::vector<uint8_t> raw; // payload of the sections list
+		std::unique_ptr<Slot[]> slots; // sorted by y
+		size_t count = 0;
+		mutable std::atomic<size_t> decodedBytes{ 0 };
+};
@@ -0,0 +1,542 @@
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "LightEngine.h"
+#include "ChunkMesher.h"
+
+namespace {
+    struct Emitter {
+        std::string_view name;
+        uint8_t level;
+        bool needsLit; // only emits with lit=true
+    };
+
+    constexpr Emitter EMITTERS[] = {
+        { "glowstone", 15, false }, { "sea_lantern", 15, false }, { "shroomlight", 15, false },
+        { "jack_o_lantern", 15, false }, { "lantern", 15, false }, { "beacon", 15, false },
+        { "conduit", 15, false }, { "lava", 15, false }, { "lava_cauldron", 15, false },
+        { "fire", 15, false }, { "end_gateway", 15, false }, { "end_portal", 15, false },
+        { "ochre_froglight", 15, false }, { "verdant_froglight", 15, false }, { "pearlescent_froglight", 15, false },
+        { "torch", 14, false }, { "wall_torch", 14, false }, { "end_rod", 14, false },
+        { "nether_portal", 11, false }, { "soul_lantern", 10, false }, { "soul_torch", 10, false },
+        { "soul_wall_torch", 10, false }, { "soul_fire", 10, false }, { "crying_obsidian", 10, false },
+        { "glow_lichen", 7, false }, { "enchanting_table", 7, false }, { "ender_chest", 7, false },
+        { "amethyst_cluster", 5, false }, { "large_amethyst_bud", 4, false }, { "magma_block", 3, false },
+        { "brewing_stand", 1, false },
+        { "redstone_lamp", 15, true }, { "campfire", 15, true }, { "furnace", 13, true },
+        { "blast_furnace", 13, true }, { "smoker", 13, true }, { "soul_campfire", 10, true },
+        { "redstone_ore", 9, true }, { "deepslate_redstone_ore", 9, true },
+        { "redstone_torch", 7, true }, { "redstone_wall_torch", 7, true },
+    };
+
+    constexpr int32_t OFFSETS[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+
+    // By state id, classified on first use. One cache per thread so chunks can be prepared on
+    // the decode threads.
+    thread_local std::vector<LightProperties> lightProperties;
+    thread_local std::vector<bool> classified;
+
+    std::string_view property(const BlockState& state, std::string_view key) {
+        for (const auto& [name, value] : state.properties) {
+            if (name == key) {
+                return value;
+            }
+        }
+        return {};
+    }
+}
+
+void NibbleArray::set(uint32_t index, uint8_t level) {
+    if (!data) {
+        if (level == uniform) {
+            return;
+        }
+        data = std::make_unique<uint8_t[]>(SECTION_VOLUME / 2);
+        std::memset(data.get(), uniform * 0x11, SECTION_VOLUME / 2);
+    }
+    uint8_t& pair = data[index >> 1];
+    uint32_t shift = (index & 1) << 2;
+    pair = static_cast<uint8_t>((pair & ~(0xF << shift)) | (level << shift));
+}
+
+LightProperties LightEngine::classify(const BlockState& state) {
+    std::string_view name = state.name;
+    if (size_t colon = name.find(':'); colon != std::string_view::npos) {
+        name = name.substr(colon + 1);
+    }
+
+    LightProperties light = { 0, 0 };
+    for (const Emitter& emitter : EMITTERS) {
+        if (name == emitter.name) {
+            light.emission = !emitter.needsLit || property(state, "lit") == "true" ? emitter.level : 0;
+            break;
+        }
+    }
+    if (name == "light") {
+        std::string_view level = property(state, "level");
+        light.emission = level.empty() ? MAX_LIGHT : static_cast<uint8_t>(std::clamp(std::atoi(std::string(level).c_str()), 0, 15));
+    }
+
+    switch (ChunkMesher::classify(state)) {
+        case BlockMaterial::Opaque:
+            light.opacity = MAX_LIGHT;
+            break;
+        case BlockMaterial::Water:
+            light.opacity = 1;
+            break;
+        case BlockMaterial::Cutout:
+            light.opacity = name.ends_with("_leaves") || name == "cobweb" ? 1 : 0;
+            break;
+        default:
+            break;
+    }
+    return light;
+}
+
+LightProperties LightEngine::properties(uint16_t state) {
+    if (state >= lightProperties.size()) {
+        size_t size = std::max(BlockStateRegistry::instance().size(), static_cast<size_t>(state) + 1);
+        lightProperties.resize(size);
+        classified.resize(size, false);
+    }
+    if (!classified[state]) {
+        lightProperties[state] = classify(BlockStateRegistry::instance().state(state));
+        classified[state] = true;
+    }
+    return lightProperties[state];
+}
+
+LightProperties LightEngine::properties(const Column& column, int32_t x, int32_t y, int32_t z) {
+    if (y < column.bottom() || y >= column.top()) {
+        return properties(BlockStateRegistry::AIR);
+    }
+    const Section* section = column.sections[(y >> 4) - column.minSectionY];
+    return properties(section ? section->blockAt(x & 15, y & 15, z & 15) : BlockStateRegistry::AIR);
+}
+
+LightEngine::Column* LightEngine::columnAt(int32_t x, int32_t z) {
+    ChunkPos pos = { x >> 4, z >> 4 };
+    if (cachedColumn && pos == cachedPos) {
+        return cachedColumn;
+    }
+    auto it = columns.find(pos);
+    if (it == columns.end()) {
+        return nullptr;
+    }
+    cachedPos = pos;
+    cachedColumn = &it->second;
+    return cachedColumn;
+}
+
+const LightEngine::Column* LightEngine::findColumn(const std::unordered_map<ChunkPos, Column, ChunkPosHash>& columns, int32_t x, int32_t z) {
+    auto it = columns.find({ x >> 4, z >> 4 });
+    return it != columns.end() ? &it->second : nullptr;
+}
+
+uint8_t LightEngine::get(const Column& column, Channel channel, int32_t x, int32_t y, int32_t z) {
+    if (y >= column.top()) {
+        return channel == Sky ? MAX_LIGHT : 0;
+    }
+    if (y < column.bottom()) {
+        return 0;
+    }
+    return column.light[channel][(y >> 4) - column.minSectionY].get(sectionIndex(x & 15, y & 15, z & 15));
+}
+
+void LightEngine::set(Column& column, Channel channel, int32_t x, int32_t y, int32_t z, uint8_t level) {
+    if (y < column.bottom() || y >= column.top()) {
+        return;
+    }
+    column.light[channel][(y >> 4) - column.minSectionY].set(sectionIndex(x & 15, y & 15, z & 15), level);
+}
+
+LightEngine::Prepared LightEngine::prepareChunk(std::shared_ptr<const Chunk> chunk) {
+    Prepared prepared;
+    Column& column = prepared.column;
+    initColumn(column, *chunk);
+    column.chunk = std::move(chunk);
+    const ChunkPos pos = column.chunk->pos;
+    const int32_t baseX = pos.x * SECTION_SIZE, baseZ = pos.z * SECTION_SIZE;
+    auto own = [&column, pos](int32_t x, int32_t z) -> Column* {
+        return ChunkPos{ x >> 4, z >> 4 } == pos ? &column : nullptr;
+    };
+
+    // Sky light straight down to the heightmap
+    const int32_t* heights = column.heights;
+    int32_t lowest = *std::min_element(heights, heights + SECTION_SIZE * SECTION_SIZE);
+    int32_t highest = *std::max_element(heights, heights + SECTION_SIZE * SECTION_SIZE);
+    for (size_t s = 0; s < column.sections.size(); ++s) {
+        int32_t base = (column.minSectionY + static_cast<int32_t>(s)) * SECTION_SIZE;
+        NibbleArray& sky = column.light[Sky][s];
+        if (base >= highest) {
+            sky.fill(MAX_LIGHT);
+            continue;
+        }
+        if (base + SECTION_SIZE <= lowest) {
+            continue;
+        }
+        for (int32_t z = 0; z < SECTION_SIZE; ++z) {
+            for (int32_t x = 0; x < SECTION_SIZE; ++x) {
+                for (int32_t y = std::max(heights[z * SECTION_SIZE + x] - base, 0); y < SECTION_SIZE; ++y) {
+                    sky.set(sectionIndex(x, y, z), MAX_LIGHT);
+                }
+            }
+        }
+    }
+
+    // From there it spreads down into the block at the heightmap and sideways into taller
+    // columns, taller neighbour chunks are left to seedBorders
+    std::vector<Node> queue;
+    for (int32_t z = 0; z < SECTION_SIZE; ++z) {
+        for (int32_t x = 0; x < SECTION_SIZE; ++x) {
+            int32_t height = heights[z * SECTION_SIZE + x];
+            int32_t tallest = height + 1;
+            for (int32_t d = 0; d < 4; ++d) {
+                int32_t nx = x + (d == 0 ? -1 : d == 1 ? 1 : 0);
+                int32_t nz = z + (d == 2 ? -1 : d == 3 ? 1 : 0);
+                if (nx >= 0 && nx < SECTION_SIZE && nz >= 0 && nz < SECTION_SIZE) {
+                    tallest = std::max(tallest, heights[nz * SECTION_SIZE + nx]);
+                }
+            }
+            for (int32_t y = height; y < std::min(tallest, column.top()); ++y) {
+                queue.push_back({ baseX + x, y, baseZ + z, MAX_LIGHT });
+            }
+        }
+    }
+    propagate(Sky, queue, own);
+
+    for (size_t s = 0; s < column.sections.size(); ++s) {
+        const Section* section = column.sections[s];
+        if (!section || std::none_of(section->palette.begin(), section->palette.end(),
+                [](uint16_t state) { return properties(state).emission > 0; })) {
+            continue;
+        }
+        int32_t base = (column.minSectionY + static_cast<int32_t>(s)) * SECTION_SIZE;
+        for (uint32_t i = 0; i < SECTION_VOLUME; ++i) {
+            uint8_t emission = properties(section->stateAt(i)).emission;
+            if (emission) {
+                column.light[Block][s].set(i, emission);
+                queue.push_back({ baseX + static_cast<int32_t>(i & 15), base + static_cast<int32_t>(i >> 8), baseZ + static_cast<int32_t>((i >> 4) & 15), emission });
+            }
+        }
+    }
+    propagate(Block, queue, own);
+    return prepared;
+}
+
+void LightEngine::addChunk(Prepared&& prepared) {
+    std::unique_lock lock(mutex);
+    ChunkPos pos = prepared.column.chunk->pos;
+    columns.erase(pos);
+    cachedColumn = nullptr;
+
+    Column& column = columns.emplace(pos, std::move(prepared.column)).first->second;
+    seedBorders(column);
+}
+
+void LightEngine::addChunk(std::shared_ptr<const Chunk> chunk) {
+    addChunk(prepareChunk(std::move(chunk)));
+}
+
+void LightEngine::updateChunk(std::shared_ptr<const Chunk> chunk, const std::vector<int32_t>& touchedSections) {
+    std::unique_lock lock(mutex);
+    auto it = columns.find(chunk->pos);
+    size_t count = chunk->sectionCount();
+    bool inRange = it != columns.end() && count > 0 &&
+        chunk->sectionAt(0)->y >= it->second.minSectionY &&
+        chunk->sectionAt(count - 1)->y * SECTION_SIZE < it->second.top();
+    if (!inRange) {
+        // New sections outside the lit range, light the whole chunk again
+        lock.unlock();
+        addChunk(std::move(chunk));
+        return;
+    }
+    Column& column = it->second;
+
+    std::vector<BlockPos> changed;
+    const int32_t baseX = chunk->pos.x * SECTION_SIZE, baseZ = chunk->pos.z * SECTION_SIZE;
+    for (int32_t y : touchedSections) {
+        const Section* before = column.sections[y - column.minSectionY];
+        const Section* after = chunk->section(y);
+        if (before == after) {
+            continue;
+        }
+        for (uint32_t i = 0; i < SECTION_VOLUME; ++i) {
+            uint16_t old = before ? before->stateAt(i) : BlockStateRegistry::AIR;
+            uint16_t now = after ? after->stateAt(i) : BlockStateRegistry::AIR;
+            if (old == now) {
+                continue;
+            }
+            LightProperties a = properties(old), b = properties(now);
+            if (a.emission != b.emission || a.opacity != b.opacity) {
+                changed.push_back({ baseX + static_cast<int32_t>(i & 15), y * SECTION_SIZE + static_cast<int32_t>(i >> 8), baseZ + static_cast<int32_t>((i >> 4) & 15) });
+            }
+        }
+    }
+
+    // Sections that were not touched are shared with the previous version
+    for (size_t i = 0; i < count; ++i) {
+        std::shared_ptr<const Section> section = chunk->sectionAt(i);
+        column.sections[section->y - column.minSectionY] = section.get();
+    }
+    column.chunk = std::move(chunk);
+
+    for (const BlockPos& pos : changed) {
+        relightBlock(pos.x, pos.y, pos.z);
+    }
+}
+
+void LightEngine::removeChunk(ChunkPos pos) {
+    std::unique_lock lock(mutex);
+    columns.erase(pos);
+    cachedColumn = nullptr;
+}
+
+void LightEngine::clear() {
+    std::unique_lock lock(mutex);
+    columns.clear();
+    cachedColumn = nullptr;
+}
+
+uint8_t LightEngine::blockLight(BlockPos pos) const {
+    std::shared_lock lock(mutex);
+    const Column* column = findColumn(columns, pos.x, pos.z);
+    return column ? get(*column, Block, pos.x, pos.y, pos.z) : 0;
+}
+
+uint8_t LightEngine::skyLight(BlockPos pos) const {
+    std::shared_lock lock(mutex);
+    const Column* column = findColumn(columns, pos.x, pos.z);
+    return column ? get(*column, Sky, pos.x, pos.y, pos.z) : 0;
+}
+
+// INT32_MIN outside resident chunks
+int32_t LightEngine::height(int32_t x, int32_t z) const {
+    std::shared_lock lock(mutex);
+    const Column* column = findColumn(columns, x, z);
+    return column ? column->heights[(z & 15) * SECTION_SIZE + (x & 15)] : INT32_MIN;
+}
+
+size_t LightEngine::memoryUsage() const {
+    std::shared_lock lock(mutex);
+    size_t bytes = (lightQueue.capacity() + removeQueue.capacity()) * sizeof(Node);
+    for (const auto& [pos, column] : columns) {
+        bytes += sizeof(Column) + column.sections.capacity() * sizeof(const Section*);
+        for (const std::vector<NibbleArray>& channel : column.light) {
+            bytes += channel.capacity() * sizeof(NibbleArray);
+            for (const NibbleArray& nibbles : channel) {
+                bytes += nibbles.memoryUsage();
+            }
+        }
+    }
+    return bytes;
+}
+
+void LightEngine::initColumn(Column& column, const Chunk& chunk) {
+    size_t count = chunk.sectionCount();
+    column.sections.clear();
+    if (count) {
+        column.minSectionY = chunk.sectionAt(0)->y;
+        column.sections.resize(chunk.sectionAt(count - 1)->y - column.minSectionY + 1, nullptr);
+        for (size_t i = 0; i < count; ++i) {
+            std::shared_ptr<const Section> section = chunk.sectionAt(i);
+            column.sections[section->y - column.minSectionY] = section.get();
+        }
+    }
+    for (std::vector<NibbleArray>& channel : column.light) {
+        channel.clear();
+        channel.resize(column.sections.size());
+    }
+    for (int32_t z = 0; z < SECTION_SIZE; ++z) {
+        for (int32_t x = 0; x < SECTION_SIZE; ++x) {
+            column.heights[z * SECTION_SIZE + x] = computeHeight(column, x, z);
+        }
+    }
+}
+
+// Local column coordinates
+int32_t LightEngine::computeHeight(const Column& column, int32_t x, int32_t z) {
+    for (int32_t s = static_cast<int32_t>(column.sections.size()) - 1; s >= 0; --s) {
+        const Section* section = column.sections[s];
+        if (!section) {
+            continue;
+        }
+        int32_t base = (column.minSectionY + s) * SECTION_SIZE;
+        if (section->isUniform()) {
+            if (properties(section->palette[0]).opacity == 0) {
+                continue;
+            }
+            return base + SECTION_SIZE;
+        }
+        for (int32_t y = SECTION_SIZE - 1; y >= 0; --y) {
+            if (properties(section->blockAt(x, y, z)).opacity) {
+                return base + y + 1;
+            }
+        }
+    }
+    return column.bottom();
+}
+
+// Light only crosses between a block on one side and the block facing it on the other, the
+// brighter of a pair is queued when it lights the other one more. The column is lit on its own
+// and its neighbours were consistent without it, so the fill only starts from those pairs.
+void LightEngine::seedBorders(Column& column) {
+    const int32_t baseX = column.chunk->pos.x * SECTION_SIZE, baseZ = column.chunk->pos.z * SECTION_SIZE;
+    std::vector<Node> blockSeeds;
+    lightQueue.clear();
+    for (int32_t d = 0; d < 4; ++d) {
+        int32_t outsideX = d == 0 ? baseX - 1 : d == 1 ? baseX + SECTION_SIZE : baseX;
+        int32_t outsideZ = d == 2 ? baseZ - 1 : d == 3 ? baseZ + SECTION_SIZE : baseZ;
+        const Column* neighbour = columnAt(outsideX, outsideZ);
+        if (!neighbour) {
+            continue;
+        }
+        // Above the top of a column nothing is stored, nothing spreads from there
+        int32_t bottom = std::max(column.bottom(), neighbour->bottom());
+        int32_t top = std::min(column.top(), neighbour->top());
+        for (int32_t i = 0; i < SECTION_SIZE; ++i) {
+            const int32_t outside[2] = { d < 2 ? outsideX : baseX + i, d < 2 ? baseZ + i : outsideZ };
+            const int32_t inside[2] = { d == 0 ? baseX : d == 1 ? baseX + SECTION_SIZE - 1 : outside[0],
+                                        d == 2 ? baseZ : d == 3 ? baseZ + SECTION_SIZE - 1 : outside[1] };
+            for (int32_t y = bottom; y < top; ++y) {
+                for (Channel channel : { Sky, Block }) {
+                    std::vector<Node>& seeds = channel == Sky ? lightQueue : blockSeeds;
+                    uint8_t in = get(column, channel, inside[0], y, inside[1]);
+                    uint8_t out = get(*neighbour, channel, outside[0], y, outside[1]);
+                    if (in - std::max<int32_t>(1, properties(*neighbour, outside[0], y, outside[1]).opacity) > out) {
+                        seeds.push_back({ inside[0], y, inside[1], in });
+                    }
+                    else if (out - std::max<int32_t>(1, properties(column, inside[0], y, inside[1]).opacity) > in) {
+                        seeds.push_back({ outside[0], y, outside[1], out });
+                    }
+                }
+            }
+        }
+    }
+    propagate(Sky);
+
+    lightQueue = std::move(blockSeeds);
+    propagate(Block);
+}
+
+// Global block coordinates, the column already holds the new block
+void LightEngine::relightBlock(int32_t x, int32_t y, int32_t z) {
+    Column* column = columnAt(x, z);
+    if (!column || y < column->bottom() || y >= column->top()) {
+        return;
+    }
+    auto pushNeighbours = [this, x, y, z]() {
+        for (const auto& offset : OFFSETS) {
+            lightQueue.push_back({ x + offset[0], y + offset[1], z + offset[2], 0 });
+        }
+    };
+
+    int32_t& height = column->heights[(z & 15) * SECTION_SIZE + (x & 15)];
+    int32_t oldHeight = height;
+    height = computeHeight(*column, x & 15, z & 15);
+
+    // Sky: a taller column takes the direct light off the blocks it now covers, a shorter one gives it back
+    removeQueue.clear();
+    lightQueue.clear();
+    for (int32_t h = oldHeight; h < height; ++h) {
+        set(*column, Sky, x, h, z, 0);
+        removeQueue.push_back({ x, h, z, MAX_LIGHT });
+    }
+    if (uint8_t level = get(*column, Sky, x, y, z); level && y < height) {
+        set(*column, Sky, x, y, z, 0);
+        removeQueue.push_back({ x, y, z, level });
+    }
+    remove(Sky);
+    for (int32_t h = height; h < oldHeight; ++h) {
+        set(*column, Sky, x, h, z, MAX_LIGHT);
+        lightQueue.push_back({ x, h, z, MAX_LIGHT });
+    }
+    if (y >= height) {
+        set(*column, Sky, x, y, z, MAX_LIGHT);
+        lightQueue.push_back({ x, y, z, MAX_LIGHT });
+    }
+    pushNeighbours();
+    propagate(Sky);
+
+    if (uint8_t level = get(*column, Block, x, y, z)) {
+        set(*column, Block, x, y, z, 0);
+        removeQueue.push_back({ x, y, z, level });
+    }
+    remove(Block);
+    if (uint8_t emission = properties(*column, x, y, z).emission) {
+        set(*column, Block, x, y, z, emission);
+        lightQueue.push_back({ x, y, z, emission });
+    }
+    pushNeighbours();
+    propagate(Block);
+}
+
+// Spreads the light of every queued block, levels are read from the storage
+template <typename ColumnAt>
+void LightEngine::propagate(Channel channel, std::vector<Node>& queue, ColumnAt&& columnAt) {
+    for (size_t head = 0; head < queue.size(); ++head) {
+        Node node = queue[head];
+        Column* column = columnAt(node.x, node.z);
+        if (!column) {
+            continue;
+        }
+        uint8_t level = get(*column, channel, node.x, node.y, node.z);
+        if (level <= 1) {
+            continue;
+        }
+        for (const auto& offset : OFFSETS) {
+            int32_t x = node.x + offset[0], y = node.y + offset[1], z = node.z + offset[2];
+            Column* next = columnAt(x, z);
+            if (!next || y < next->bottom() || y >= next->top()) {
+                continue;
+            }
+            int32_t lit = level - std::max<int32_t>(1, properties(*next, x, y, z).opacity);
+            if (lit > get(*next, channel, x, y, z)) {
+                set(*next, channel, x, y, z, static_cast<uint8_t>(lit));
+                queue.push_back({ x, y, z, static_cast<uint8_t>(lit) });
+            }
+        }
+    }
+    queue.clear();
+}
+
+void LightEngine::propagate(Channel channel) {
+    propagate(channel, lightQueue, [this](int32_t x, int32_t z) { return columnAt(x, z); });
+}
+
+// Darkens everything that was lit through the queued blocks, which are already dark and hold
+// their previous level. Brighter blocks met on the way go to lightQueue to fill the gap again.
+void LightEngine::remove(Channel channel) {
+    for (size_t head = 0; head < removeQueue.size(); ++head) {
+        Node node = removeQueue[head];
+        for (const auto& offset : OFFSETS) {
+            int32_t x = node.x + offset[0], y = node.y + offset[1], z = node.z + offset[2];
+            Column* next = columnAt(x, z);
+            if (!next || y < next->bottom() || y >= next->top()) {
+                continue;
+            }
+            uint8_t level = get(*next, channel, x, y, z);
+            if (level == 0) {
+                continue;
+            }
+            if (level < node.level) {
+                set(*next, channel, x, y, z, 0);
+                removeQueue.push_back({ x, y, z, level });
+                // Emitters in the dark area keep their own light
+                uint8_t emission = channel == Block ? properties(*next, x, y, z).emission : 0;
+                if (emission) {
+                    set(*next, channel, x, y, z, emission);
+                    lightQueue.push_back({ x, y, z, emission });
+                }
+            }
+            else {
+                lightQueue.push_back({ x, y, z, level });
+            }
+        }
+    }
+    removeQueue.clear();
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+#include "BlockStateRegistry.h"
+#include "DataStructures.h"
+
+// How a block state interacts with light
+struct LightProperties {
+    uint8_t emission; // block light level it gives off
+    uint8_t opacity;  // levels lost on top of the one per block when light enters it, 15 stops it
+};
+
+// 4 bit light levels of a section, two blocks per byte with the even index in the low nibble.
+// Sections of a single level, like open sky or solid rock, allocate nothing.
+class NibbleArray {
+	public:
+		uint8_t get(uint32_t index) const {
+			return data ? (data[index >> 1] >> ((index & 1) << 2)) & 0xF : uniform;
+		}
+		void set(uint32_t index, uint8_t level);
+		void fill(uint8_t level) { data.reset(); uniform = level; }
+		size_t memoryUsage() const { return data ? SECTION_VOLUME / 2 : 0; }
+	private:
+		std::unique_ptr<uint8_t[]> data;
+		uint8_t uniform = 0;
+};
+
+// Minecraft style block light and sky light of the resident chunks, computed by breadth first
+// flood fill. Sky light is 15 from the top down to the heightmap of each column (the lowest block
+// with only transparent blocks above it) and spreads sideways and down from there, block light
+// starts at emissive blocks. Every step costs one level plus the opacity of the block entered.
+// Loading or editing a chunk only relights what changes, edits use the usual removal pass
+// followed by a refill from the surrounding light. Dropped chunks leave the light they spread
+// into their neighbours.
+class LightEngine {
+	public:
+		static constexpr uint8_t MAX_LIGHT = 15;
+
+		// Light of a chunk on its own, see prepareChunk
+		struct Prepared;
+
+		// Lights a chunk without its neighbours, thread safe. Decode threads run it so addChunk
+		// only has to exchange light over the borders.
+		static Prepared prepareChunk(std::shared_ptr<const Chunk> chunk);
+		// Spreads light between a prepared chunk and its resident neighbours, replacing the chunk
+		// at the same position
+		void addChunk(Prepared&& prepared);
+		// Both steps on the calling thread
+		void addChunk(std::shared_ptr<const Chunk> chunk);
+		// A newer version of a resident chunk, only blocks of the touched sections whose light
+		// properties changed are relit
+		void updateChunk(std::shared_ptr<const Chunk> chunk, const std::vector<int32_t>& touchedSections);
+		void removeChunk(ChunkPos pos);
+		void clear();
+
+		// Block coordinates. Outside resident chunks both are 0, except for sky light above them.
+		uint8_t blockLight(BlockPos pos) const;
+		uint8_t skyLight(BlockPos pos) const;
+		// Lowest block y of a column with only transparent blocks above it
+		int32_t height(int32_t x, int32_t z) const;
+
+		static LightProperties classify(const BlockState& state);
+		size_t memoryUsage() const;
+	private:
+		enum Channel { Block, Sky };
+
+		struct Column {
+			std::shared_ptr<const Chunk> chunk;
+			int32_t minSectionY = 0;
+			std::vector<const Section*> sections; // by y - minSectionY, nullptr reads as air
+			std::vector<NibbleArray> light[2];    // by channel, then like sections
+			int32_t heights[SECTION_SIZE * SECTION_SIZE]; // index z * 16 + x
+
+			int32_t bottom() const { return minSectionY * SECTION_SIZE; }
+			int32_t top() const { return (minSectionY + static_cast<int32_t>(sections.size())) * SECTION_SIZE; }
+		};
+
+		struct Node {
+			int32_t x, y, z;
+			uint8_t level;
+		};
+
+		// These do not touch the engine, light properties are cached per thread
+		static LightProperties properties(uint16_t state);
+		static LightProperties properties(const Column& column, int32_t x, int32_t y, int32_t z);
+		static void initColumn(Column& column, const Chunk& chunk);
+		static int32_t computeHeight(const Column& column, int32_t x, int32_t z);
+		// Flood fill from the queued blocks through the columns columnAt(x, z) finds
+		template <typename ColumnAt>
+		static void propagate(Channel channel, std::vector<Node>& queue, ColumnAt&& columnAt);
+
+		// mutex must be held for everything below
+		Column* columnAt(int32_t x, int32_t z);
+		static const Column* findColumn(const std::unordered_map<ChunkPos, Column, ChunkPosHash>& columns, int32_t x, int32_t z);
+		static uint8_t get(const Column& column, Channel channel, int32_t x, int32_t y, int32_t z);
+		static void set(Column& column, Channel channel, int32_t x, int32_t y, int32_t z, uint8_t level);
+
+		void seedBorders(Column& column);
+		void relightBlock(int32_t x, int32_t y, int32_t z);
+		void propagate(Channel channel);
+		void remove(Channel channel);
+
+		mutable std::shared_mutex mutex;
+		std::unordered_map<ChunkPos, Column, ChunkPosHash> columns;
+		Column* cachedColumn = nullptr;
+		ChunkPos cachedPos = { 0, 0 };
+
+		std::vector<Node> lightQueue;
+		std::vector<Node> removeQueue;
+};
+
+struct LightEngine::Prepared {
+    Column column;
+};
@@ -0,0 +1,112 @@
+#include <iostream>
+#include "MappedFile.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open " << path << ". Error: " << GetLastError() << std::endl;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return false;
+    }
+
+    mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mappingHandle == NULL) {
+        std::cerr << "Failed to map " << path << ". Error: " << GetLastError() << std::endl;
+        close();
+        return false;
+    }
+    mapped = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (mapped == nullptr) {
+        std::cerr << "Failed to map " << path << ". Error: " << GetLastError() << std::endl;
+        close();
+        return false;
+    }
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file referenced
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        std::cerr << "Failed to map " << path << std::endl;
+        return false;
+    }
+    mapped = static_cast<const uint8_t*>(address);
+    mappedSize = static_cast<size_t>(info.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (mapped) {
+        UnmapViewOfFile(mapped);
+    }
+    if (mappingHandle != NULL) {
+        CloseHandle(mappingHandle);
+        mappingHandle = NULL;
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (mapped) {
+        munmap(const_cast<uint8_t*>(mapped), mappedSize);
+    }
+#endif
+    mapped = nullptr;
+    mappedSize = 0;
+}
+
+void MappedFile::adviseRandom() const {
+#ifndef _WIN32
+    if (mapped) {
+        madvise(const_cast<uint8_t*>(mapped), mappedSize, MADV_RANDOM);
+    }
+#endif
+}
+
+void MappedFile::willNeed(const uint8_t* begin, size_t size) const {
+#ifndef _WIN32
+    if (!mapped || size == 0) {
+        return;
+    }
+    // madvise wants page aligned ranges
+    uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t start = reinterpret_cast<uintptr_t>(begin) & ~(page - 1);
+    uintptr_t end = reinterpret_cast<uintptr_t>(begin) + size;
+    madvise(reinterpret_cast<void*>(start), end - start, MADV_WILLNEED);
+#else
+    (void)begin;
+    (void)size;
+#endif
+}
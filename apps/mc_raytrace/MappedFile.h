@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Read only memory mapping of a whole file
+class MappedFile {
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// Empty files fail to map
+		bool open(const std::string& path);
+		void close();
+		bool isOpen() const { return mapped != nullptr; }
+
+		const uint8_t* data() const { return mapped; }
+		size_t size() const { return mappedSize; }
+
+		// Access pattern hints, no-ops where unsupported
+		void adviseRandom() const;
+		void willNeed(const uint8_t* begin, size_t size) const;
+	private:
+		const uint8_t* mapped = nullptr;
+		size_t mappedSize = 0;
+#ifdef _WIN32
+		HANDLE fileHandle = INVALID_HANDLE_VALUE;
+		HANDLE mappingHandle = NULL;
+#endif
+};
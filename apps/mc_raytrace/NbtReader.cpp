@@ -0,0 +1,69 @@
+#include "NbtReader.h"
+
+namespace nbt {
+    namespace {
+        // Deeper nesting than this is treated as malformed data
+        constexpr int MAX_DEPTH = 512;
+
+        size_t fixedSize(uint8_t type) {
+            switch (type) {
+                case TAG_Byte: return 1;
+                case TAG_Short: return 2;
+                case TAG_Int: case TAG_Float: return 4;
+                case TAG_Long: case TAG_Double: return 8;
+                default: return 0;
+            }
+        }
+    }
+
+    void Reader::skip(uint8_t type, int depth) {
+        if (depth > MAX_DEPTH) {
+            valid = false;
+            return;
+        }
+        switch (type) {
+            case TAG_Byte: case TAG_Short: case TAG_Int: case TAG_Long: case TAG_Float: case TAG_Double:
+                take(fixedSize(type));
+                break;
+            case TAG_Byte_Array: case TAG_Int_Array: case TAG_Long_Array: {
+                int32_t count = i32();
+                size_t elementSize = type == TAG_Byte_Array ? 1 : type == TAG_Int_Array ? 4 : 8;
+                if (count < 0) {
+                    valid = false;
+                }
+                take(static_cast<size_t>(count) * elementSize);
+                break;
+            }
+            case TAG_String:
+                string();
+                break;
+            case TAG_List: {
+                uint8_t elementType = u8();
+                int32_t count = i32();
+                if (count < 0) {
+                    valid = false;
+                }
+                else if (fixedSize(elementType)) {
+                    take(static_cast<size_t>(count) * fixedSize(elementType));
+                }
+                else {
+                    for (int32_t i = 0; i < count && valid; ++i) {
+                        skip(elementType, depth + 1);
+                    }
+                }
+                break;
+            }
+            case TAG_Compound: {
+                uint8_t childType;
+                std::string_view name;
+                while (nextTag(childType, name)) {
+                    skip(childType, depth + 1);
+                }
+                break;
+            }
+            default:
+                valid = false;
+                break;
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Minimal forward only reader over uncompressed, big endian NBT.
+// Every read is bounds checked, after a failed read ok() is false and all further reads
+// return zero values. Nothing is copied or modified, strings point into the buffer.
+namespace nbt {
+    enum TagType : uint8_t {
+        TAG_End = 0,
+        TAG_Byte = 1,
+        TAG_Short = 2,
+        TAG_Int = 3,
+        TAG_Long = 4,
+        TAG_Float = 5,
+        TAG_Double = 6,
+        TAG_Byte_Array = 7,
+        TAG_String = 8,
+        TAG_List = 9,
+        TAG_Compound = 10,
+        TAG_Int_Array = 11,
+        TAG_Long_Array = 12,
+    };
+
+    class Reader {
+        public:
+            Reader(const uint8_t* data, size_t size, size_t position = 0)
+                : data(data), length(size), pos(position) {}
+
+            bool ok() const { return valid; }
+            size_t position() const { return pos; }
+            const uint8_t* buffer() const { return data; }
+
+            uint8_t u8() { return static_cast<uint8_t>(readBigEndian(1)); }
+            int16_t i16() { return static_cast<int16_t>(readBigEndian(2)); }
+            int32_t i32() { return static_cast<int32_t>(readBigEndian(4)); }
+            int64_t i64() { return static_cast<int64_t>(readBigEndian(8)); }
+
+            // Length prefixed string
+            std::string_view string() {
+                uint16_t size = static_cast<uint16_t>(readBigEndian(2));
+                const uint8_t* bytes = take(size);
+                return bytes ? std::string_view(reinterpret_cast<const char*>(bytes), size) : std::string_view();
+            }
+
+            // Advance over count bytes, returns their start or nullptr when out of bounds
+            const uint8_t* take(size_t count) {
+                if (!valid || count > length - pos) {
+                    valid = false;
+                    return nullptr;
+                }
+                const uint8_t* bytes = data + pos;
+                pos += count;
+                return bytes;
+            }
+
+            // Next named tag of a compound. False at TAG_End or on error.
+            bool nextTag(uint8_t& type, std::string_view& name) {
+                type = u8();
+                if (!valid || type == TAG_End) {
+                    return false;
+                }
+                name = string();
+                return valid;
+            }
+
+            // Skip the payload of a tag of the given type, nested tags included
+            void skip(uint8_t type, int depth = 0);
+        private:
+            uint64_t readBigEndian(size_t count) {
+                const uint8_t* bytes = take(count);
+                uint64_t value = 0;
+                for (size_t i = 0; bytes && i < count; ++i) {
+                    value = (value << 8) | bytes[i];
+                }
+                return value;
+            }
+
+            const uint8_t* data;
+            size_t length;
+            size_t pos;
+            bool valid = true;
+    };
+}
@@ -0,0 +1,398 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <mutex>
+#include "OccupancyMap.h"
+#include "BlockStateRegistry.h"
+#include "ChunkMesher.h"
+#include "LazySections.h"
+#include "VoxelTraversal.h"
+
+namespace {
+    constexpr uint8_t UNKNOWN = 0xFF;
+    constexpr int32_t MAX_SECTIONS = 64;
+
+    // Visibility by state id, classified on first use. One cache per thread so chunks can be
+    // built on the decode threads.
+    thread_local std::vector<uint8_t> visibility;
+
+    bool isVisible(uint16_t state) {
+        if (state >= visibility.size()) {
+            size_t size = std::max(BlockStateRegistry::instance().size(), static_cast<size_t>(state) + 1);
+            visibility.resize(size, UNKNOWN);
+        }
+        uint8_t& visible = visibility[state];
+        if (visible == UNKNOWN) {
+            visible = ChunkMesher::classify(BlockStateRegistry::instance().state(state)) != BlockMaterial::Invisible;
+        }
+        return visible != 0;
+    }
+
+    void fillSection(ChunkOccupancy::SectionBits& bits) {
+        bits.brickMask = ~uint64_t(0);
+        std::fill(std::begin(bits.bricks), std::end(bits.bricks), ~uint64_t(0));
+    }
+
+    // Bits of the blocks lo to hi within a brick, inclusive
+    uint64_t brickMask(const int32_t lo[3], const int32_t hi[3]) {
+        uint64_t row = ((uint64_t(1) << (hi[0] - lo[0] + 1)) - 1) << lo[0];
+        uint64_t mask = 0;
+        for (int32_t y = lo[1]; y <= hi[1]; ++y) {
+            for (int32_t z = lo[2]; z <= hi[2]; ++z) {
+                mask |= row << ((y * ChunkOccupancy::BRICK_SIZE + z) * ChunkOccupancy::BRICK_SIZE);
+            }
+        }
+        return mask;
+    }
+
+    // Blocks lo to hi of a section, inclusive
+    bool isSectionRegionEmpty(const ChunkOccupancy::SectionBits& bits, const int32_t lo[3], const int32_t hi[3]) {
+        const int32_t size = ChunkOccupancy::BRICK_SIZE;
+        for (int32_t by = lo[1] / size; by <= hi[1] / size; ++by) {
+            for (int32_t bz = lo[2] / size; bz <= hi[2] / size; ++bz) {
+                for (int32_t bx = lo[0] / size; bx <= hi[0] / size; ++bx) {
+                    uint32_t index = ChunkOccupancy::brickIndex(bx, by, bz);
+                    if (!((bits.brickMask >> index) & 1)) {
+                        continue;
+                    }
+                    const int32_t brick[3] = { bx * size, by * size, bz * size };
+                    int32_t brickLo[3], brickHi[3];
+                    bool covered = true;
+                    for (int32_t i = 0; i < 3; ++i) {
+                        brickLo[i] = std::max(lo[i] - brick[i], 0);
+                        brickHi[i] = std::min(hi[i] - brick[i], size - 1);
+                        covered &= brickLo[i] == 0 && brickHi[i] == size - 1;
+                    }
+                    // A set brick bit means at least one block is set
+                    if (covered || (bits.bricks[index] & brickMask(brickLo, brickHi))) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+}
+
+const ChunkOccupancy::SectionBits* ChunkOccupancy::section(int32_t y) const {
+    int32_t bit = y - minSectionY;
+    if (bit < 0 || bit >= MAX_SECTIONS || !((sectionMask >> bit) & 1)) {
+        return nullptr;
+    }
+    // Sections are stored for set bits only, in bit order
+    return &sections[std::popcount(sectionMask & ((uint64_t(1) << bit) - 1))];
+}
+
+size_t ChunkOccupancy::memoryUsage() const {
+    return sizeof(ChunkOccupancy) + sections.capacity() * sizeof(SectionBits);
+}
+
+bool OccupancyMap::buildSection(const Section& section, ChunkOccupancy::SectionBits& bits) {
+    bits.y = section.y;
+
+    uint8_t visible[SECTION_VOLUME];
+    size_t numVisible = 0;
+    for (size_t i = 0; i < section.palette.size(); ++i) {
+        visible[i] = isVisible(section.palette[i]);
+        numVisible += visible[i];
+    }
+    if (numVisible == 0) {
+        return false;
+    }
+    if (numVisible == section.palette.size()) {
+        fillSection(bits);
+        return true;
+    }
+
+    std::memset(bits.bricks, 0, sizeof(bits.bricks));
+    uint32_t mask = (1u << section.bitsPerBlock) - 1;
+    for (uint32_t index = 0; index < SECTION_VOLUME; ++index) {
+        uint32_t bit = index * section.bitsPerBlock;
+        uint32_t slot = static_cast<uint32_t>(section.data[bit >> 6] >> (bit & 63)) & mask;
+        if (!visible[slot]) {
+            continue;
+        }
+        int32_t x = index & 15, z = (index >> 4) & 15, y = index >> 8;
+        bits.bricks[ChunkOccupancy::brickIndex(x >> 2, y >> 2, z >> 2)] |= uint64_t(1) << ChunkOccupancy::brickIndex(x & 3, y & 3, z & 3);
+    }
+    bits.brickMask = 0;
+    for (uint32_t i = 0; i < 64; ++i) {
+        bits.brickMask |= uint64_t(bits.bricks[i] != 0) << i;
+    }
+    return true;
+}
+
+// Sections more than 64 above the lowest one are left out
+ChunkOccupancy OccupancyMap::build(const Chunk& chunk) {
+    ChunkOccupancy occupancy;
+    size_t count = chunk.sectionCount();
+    if (count == 0) {
+        return occupancy;
+    }
+
+    occupancy.minSectionY = chunk.lazy ? chunk.lazy->sectionY(0) : chunk.sections[0]->y;
+    for (size_t i = 0; i < count; ++i) {
+        int32_t y = chunk.lazy ? chunk.lazy->sectionY(i) : chunk.sections[i]->y;
+        int32_t bit = y - occupancy.minSectionY;
+        if (bit >= MAX_SECTIONS) {
+            break;
+        }
+
+        ChunkOccupancy::SectionBits bits;
+        if (chunk.lazy && chunk.lazy->hasBlockData(i)) {
+            // Keep lazy chunks lazy, only single state sections are decoded
+            bits.y = y;
+            fillSection(bits);
+        }
+        else if (!buildSection(*chunk.sectionAt(i), bits)) {
+            continue;
+        }
+        occupancy.sections.push_back(bits);
+        occupancy.sectionMask |= uint64_t(1) << bit;
+    }
+    return occupancy;
+}
+
+void OccupancyMap::insert(ChunkPos pos, ChunkOccupancy occupancy) {
+    std::unique_lock lock(mutex);
+
+    if (!occupancy.empty()) {
+        growBounds(pos, occupancy.sections.front().y, occupancy.sections.back().y);
+    }
+    setChunkBit(pos, !occupancy.empty());
+    chunks.insert_or_assign(pos, std::move(occupancy));
+}
+
+void OccupancyMap::updateSection(ChunkPos pos, const Section& section) {
+    ChunkOccupancy::SectionBits bits;
+    bool visible = buildSection(section, bits);
+
+    std::unique_lock lock(mutex);
+    auto it = chunks.find(pos);
+    if (it == chunks.end()) {
+        return;
+    }
+    ChunkOccupancy& occupancy = it->second;
+
+    auto at = std::lower_bound(occupancy.sections.begin(), occupancy.sections.end(), section.y,
+        [](const ChunkOccupancy::SectionBits& stored, int32_t y) { return stored.y < y; });
+    bool present = at != occupancy.sections.end() && at->y == section.y;
+    if (!visible && !present) {
+        return;
+    }
+
+    if (occupancy.empty()) {
+        occupancy.minSectionY = section.y;
+    }
+    else if (section.y < occupancy.minSectionY) {
+        // New section below the others, move the mask up unless sections would fall off the top
+        int32_t shift = occupancy.minSectionY - section.y;
+        if (shift >= MAX_SECTIONS || (occupancy.sectionMask >> (MAX_SECTIONS - shift)) != 0) {
+            return;
+        }
+        occupancy.sectionMask <<= shift;
+        occupancy.minSectionY = section.y;
+    }
+    int32_t bit = section.y - occupancy.minSectionY;
+    if (bit >= MAX_SECTIONS) {
+        return;
+    }
+
+    if (visible) {
+        if (present) {
+            *at = bits;
+        }
+        else {
+            occupancy.sections.insert(at, bits);
+        }
+        occupancy.sectionMask |= uint64_t(1) << bit;
+        growBounds(pos, section.y, section.y);
+    }
+    else if (present) {
+        occupancy.sections.erase(at);
+        occupancy.sectionMask &= ~(uint64_t(1) << bit);
+    }
+    setChunkBit(pos, !occupancy.empty());
+}
+
+void OccupancyMap::erase(ChunkPos pos) {
+    std::unique_lock lock(mutex);
+    if (chunks.erase(pos)) {
+        setChunkBit(pos, false);
+    }
+}
+
+void OccupancyMap::clear() {
+    std::unique_lock lock(mutex);
+    chunks.clear();
+    chunkMasks.clear();
+    std::fill(std::begin(minBound), std::end(minBound), 0);
+    std::fill(std::begin(maxBound), std::end(maxBound), -1);
+}
+
+bool OccupancyMap::isChunkEmpty(ChunkPos pos) const {
+    std::shared_lock lock(mutex);
+    return findChunk(pos) == nullptr;
+}
+
+bool OccupancyMap::isSectionEmpty(SectionPos pos) const {
+    std::shared_lock lock(mutex);
+    const ChunkOccupancy* chunk = findChunk({ pos.x, pos.z });
+    return !chunk || !chunk->section(pos.y);
+}
+
+bool OccupancyMap::isRegionEmpty(BlockPos min, BlockPos max) const {
+    if (min.x > max.x || min.y > max.y || min.z > max.z) {
+        return true;
+    }
+
+    std::shared_lock lock(mutex);
+    const int32_t bits = voxel::SECTION_BITS;
+    for (int32_t cz = min.z >> bits; cz <= max.z >> bits; ++cz) {
+        for (int32_t cx = min.x >> bits; cx <= max.x >> bits; ++cx) {
+            const ChunkOccupancy* chunk = findChunk({ cx, cz });
+            if (!chunk) {
+                continue;
+            }
+            int32_t firstBit = std::max((min.y >> bits) - chunk->minSectionY, 0);
+            int32_t lastBit = std::min((max.y >> bits) - chunk->minSectionY, MAX_SECTIONS - 1);
+            for (int32_t bit = firstBit; bit <= lastBit; ++bit) {
+                if (!((chunk->sectionMask >> bit) & 1)) {
+                    continue;
+                }
+                int32_t sy = chunk->minSectionY + bit;
+                const int32_t origin[3] = { cx * SECTION_SIZE, sy * SECTION_SIZE, cz * SECTION_SIZE };
+                const int32_t lo[3] = {
+                    std::max(min.x - origin[0], 0), std::max(min.y - origin[1], 0), std::max(min.z - origin[2], 0)
+                };
+                const int32_t hi[3] = {
+                    std::min(max.x - origin[0], SECTION_SIZE - 1), std::min(max.y - origin[1], SECTION_SIZE - 1), std::min(max.z - origin[2], SECTION_SIZE - 1)
+                };
+                if (!isSectionRegionEmpty(*chunk->section(sy), lo, hi)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Section level DDA over the bounds of the map, bricks are only walked in non-empty sections
+bool OccupancyMap::nextOccupied(const float origin[3], const float direction[3], float tMin, float tMax, Hit& hit) const {
+    using namespace voxel;
+    const int32_t BRICK_BITS = 2;
+
+    std::shared_lock lock(mutex);
+    if (maxBound[0] < minBound[0]) {
+        return false;
+    }
+
+    float invDirection[3];
+    for (int32_t i = 0; i < 3; ++i) {
+        invDirection[i] = direction[i] != 0.0f ? 1.0f / direction[i] : NO_HIT;
+    }
+    float tEnter = tMin;
+    float tExit = tMax;
+    int32_t enterAxis;
+    if (!clipToCells(origin, direction, invDirection, SECTION_BITS, minBound, maxBound, tEnter, tExit, enterAxis)) {
+        return false;
+    }
+
+    Dda sections;
+    sections.init(origin, direction, invDirection, tEnter, SECTION_BITS, minBound, maxBound);
+    float tCell = tEnter;
+    ChunkPos cachedPos = { sections.cell[0], sections.cell[2] };
+    const ChunkOccupancy* chunk = findChunk(cachedPos);
+
+    while (tCell <= tExit) {
+        ChunkPos pos = { sections.cell[0], sections.cell[2] };
+        if (pos != cachedPos) {
+            cachedPos = pos;
+            chunk = findChunk(pos);
+        }
+        const ChunkOccupancy::SectionBits* bits = chunk ? chunk->section(sections.cell[1]) : nullptr;
+        float tCellExit = sections.tMax[sections.nextAxis()];
+        if (bits) {
+            int32_t brickLo[3], brickHi[3];
+            for (int32_t i = 0; i < 3; ++i) {
+                brickLo[i] = sections.cell[i] * ChunkOccupancy::BRICKS_PER_SIDE;
+                brickHi[i] = brickLo[i] + ChunkOccupancy::BRICKS_PER_SIDE - 1;
+            }
+            Dda bricks;
+            bricks.init(origin, direction, invDirection, tCell, BRICK_BITS, brickLo, brickHi);
+            float tBrick = tCell;
+            float tEnd = tCellExit < tExit ? tCellExit : tExit;
+            while (tBrick <= tEnd) {
+                uint32_t index = ChunkOccupancy::brickIndex(bricks.cell[0] & 3, bricks.cell[1] & 3, bricks.cell[2] & 3);
+                if ((bits->brickMask >> index) & 1) {
+                    hit = { tBrick, bricks.cell[0], bricks.cell[1], bricks.cell[2] };
+                    return true;
+                }
+                int32_t axis = bricks.nextAxis();
+                tBrick = bricks.tMax[axis];
+                bricks.cell[axis] += bricks.step[axis];
+                if (bricks.cell[axis] < brickLo[axis] || bricks.cell[axis] > brickHi[axis]) {
+                    break;
+                }
+                bricks.tMax[axis] += bricks.tDelta[axis];
+            }
+        }
+
+        int32_t axis = sections.nextAxis();
+        tCell = sections.tMax[axis];
+        sections.cell[axis] += sections.step[axis];
+        if (sections.cell[axis] < minBound[axis] || sections.cell[axis] > maxBound[axis]) {
+            break;
+        }
+        sections.tMax[axis] += sections.tDelta[axis];
+    }
+    return false;
+}
+
+size_t OccupancyMap::size() const {
+    std::shared_lock lock(mutex);
+    return chunks.size();
+}
+
+size_t OccupancyMap::memoryUsage() const {
+    std::shared_lock lock(mutex);
+    size_t bytes = chunkMasks.size() * (sizeof(ChunkPos) + sizeof(uint64_t));
+    for (const auto& [pos, chunk] : chunks) {
+        bytes += sizeof(ChunkPos) + chunk.memoryUsage();
+    }
+    return bytes;
+}
+
+// Tests the chunk bit first so missing and empty chunks cost one lookup in the smaller region map
+const ChunkOccupancy* OccupancyMap::findChunk(ChunkPos pos) const {
+    auto region = chunkMasks.find(regionOf(pos));
+    if (region == chunkMasks.end() || !(region->second & chunkBit(pos))) {
+        return nullptr;
+    }
+    auto it = chunks.find(pos);
+    return it != chunks.end() ? &it->second : nullptr;
+}
+
+void OccupancyMap::growBounds(ChunkPos pos, int32_t lowestY, int32_t highestY) {
+    const int32_t lo[3] = { pos.x, lowestY, pos.z };
+    const int32_t hi[3] = { pos.x, highestY, pos.z };
+    bool empty = maxBound[0] < minBound[0];
+    for (int32_t i = 0; i < 3; ++i) {
+        minBound[i] = empty ? lo[i] : std::min(minBound[i], lo[i]);
+        maxBound[i] = empty ? hi[i] : std::max(maxBound[i], hi[i]);
+    }
+}
+
+void OccupancyMap::setChunkBit(ChunkPos pos, bool set) {
+    if (set) {
+        chunkMasks[regionOf(pos)] |= chunkBit(pos);
+        return;
+    }
+    auto region = chunkMasks.find(regionOf(pos));
+    if (region != chunkMasks.end()) {
+        region->second &= ~chunkBit(pos);
+        if (region->second == 0) {
+            chunkMasks.erase(region);
+        }
+    }
+}
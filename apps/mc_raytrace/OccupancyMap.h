@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+#include "DataStructures.h"
+
+// Which blocks of a chunk column are visible, as three levels of bits: a bit per block grouped
+// into 4x4x4 bricks of one word each, a bit per non-empty brick of a section and a bit per
+// non-empty section of the column.
+struct ChunkOccupancy {
+    static constexpr int32_t BRICK_SIZE = 4;
+    static constexpr int32_t BRICKS_PER_SIDE = SECTION_SIZE / BRICK_SIZE;
+
+    struct SectionBits {
+        int32_t y;
+        uint64_t brickMask;  // bit per non-empty brick, index (y * 4 + z) * 4 + x
+        uint64_t bricks[64]; // bit per visible block, same order within the brick
+    };
+
+    int32_t minSectionY = 0;
+    uint64_t sectionMask = 0;          // bit per non-empty section, relative to minSectionY
+    std::vector<SectionBits> sections; // non-empty ones only, sorted by y
+
+    static uint32_t brickIndex(int32_t x, int32_t y, int32_t z) { return static_cast<uint32_t>((y * BRICKS_PER_SIDE + z) * BRICKS_PER_SIDE + x); }
+
+    bool empty() const { return sectionMask == 0; }
+    // Bits of the section at y, nullptr when it is empty
+    const SectionBits* section(int32_t y) const;
+    size_t memoryUsage() const;
+};
+
+// Occupancy of every resident chunk, kept up to date by DataManager as chunks are loaded,
+// edited and dropped. A fourth level holds a bit per non-empty chunk for every 8x8 chunks.
+// Lets traversal and culling skip air without touching block data. Lazily decoded chunks are
+// not decoded for it, their sections count as full.
+class OccupancyMap {
+	public:
+		// Brick found by nextOccupied
+		struct Hit {
+			float t;         // where the ray enters the brick
+			int32_t x, y, z; // brick coordinates, block coordinates >> 2
+		};
+
+		// Computes the bits of a chunk without touching the map, thread safe
+		static ChunkOccupancy build(const Chunk& chunk);
+		static bool buildSection(const Section& section, ChunkOccupancy::SectionBits& bits);
+
+		// Replaces the chunk at the same position
+		void insert(ChunkPos pos, ChunkOccupancy occupancy);
+		// Recompute one section after an edit
+		void updateSection(ChunkPos pos, const Section& section);
+		void erase(ChunkPos pos);
+		void clear();
+
+		bool isChunkEmpty(ChunkPos pos) const;
+		bool isSectionEmpty(SectionPos pos) const;
+		// Inclusive block bounds. Chunks that are not resident count as empty.
+		bool isRegionEmpty(BlockPos min, BlockPos max) const;
+		// First non-empty brick along the ray within [tMin, tMax], coordinates in blocks
+		bool nextOccupied(const float origin[3], const float direction[3], float tMin, float tMax, Hit& hit) const;
+
+		size_t size() const;
+		size_t memoryUsage() const;
+	private:
+		static constexpr int32_t REGION_BITS = 3; // chunk bits of 8x8 chunks per word
+
+		static ChunkPos regionOf(ChunkPos pos) { return { pos.x >> REGION_BITS, pos.z >> REGION_BITS }; }
+		static uint64_t chunkBit(ChunkPos pos) {
+			return uint64_t(1) << (((pos.z & ((1 << REGION_BITS) - 1)) << REGION_BITS) | (pos.x & ((1 << REGION_BITS) - 1)));
+		}
+
+		// mutex must be held
+		const ChunkOccupancy* findChunk(ChunkPos pos) const;
+		void setChunkBit(ChunkPos pos, bool set);
+		void growBounds(ChunkPos pos, int32_t lowestY, int32_t highestY);
+
+		mutable std::shared_mutex mutex;
+		std::unordered_map<ChunkPos, ChunkOccupancy, ChunkPosHash> chunks;
+		std::unordered_map<ChunkPos, uint64_t, ChunkPosHash> chunkMasks; // by region
+
+		// Section bounds of every chunk inserted since the last clear, they only grow
+		int32_t minBound[3] = { 0, 0, 0 };
+		int32_t maxBound[3] = { -1, -1, -1 };
+};
@@ -1,17 +1,57 @@
 #include <thread>
+#include <algorithm>
 #include <atomic>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <mutex>
+#include <vector>
 #include "app.h"
 #include "com_example_OptixRenderer.h"
-#include "dataManager.h"
+#include "DataManager.h"
 
 // Global variables to manage the rendering thread
 std::thread renderThread;
 std::atomic<bool> isRunning(false);
 DataManager dataManager;
+// Size of the render window
+const int renderWidth = 1024;
+const int renderHeight = 768;
+
+// Tickets of direct buffers the decode pool is done with, handed back to Java by pollReleasedBuffers
+std::mutex releasedMutex;
+std::vector<jlong> releasedBuffers;
+
+// A negative size would turn into a length of about 2^64 bytes once it is cast to size_t
+static bool checkArraySize(JNIEnv* env, jbyteArray array, jint size, const char* function) {
+    if (array == nullptr || size < 0 || env->GetArrayLength(array) < size) {
+        std::cerr << function << " expects a byte array of at least " << size << " bytes" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Capacity is -1 when the object is not a direct buffer
+static bool checkDirectBuffer(JNIEnv* env, jobject buffer, jint size, const char* function) {
+    jlong capacity = buffer ? env->GetDirectBufferCapacity(buffer) : -1;
+    if (size < 0 || capacity < 0 || capacity < size || env->GetDirectBufferAddress(buffer) == nullptr) {
+        std::cerr << function << " expects a direct ByteBuffer of at least " << size << " bytes" << std::endl;
+        return false;
+    }
+    return true;
+}
 
 extern "C" {
 
+    JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved) {
+        dataManager.setup();
+        return JNI_VERSION_1_8;
+    }
+
+    JNIEXPORT void JNICALL JNI_OnUnload(JavaVM* vm, void* reserved) {
+        dataManager.close();
+    }
+
     JNIEXPORT void JNICALL Java_com_example_OptixRenderer_startRendering(JNIEnv* env, jobject obj) {
         // rendering code
 
@@ -26,8 +66,8 @@ extern "C" {
 
             pgSetAppDir(APP_DIR);
 
-            auto window = std::make_shared<Window>("MC Raytrace", 1024, 768);
-            auto app = std::make_shared<App>();
+            auto window = std::make_shared<Window>("MC Raytrace", renderWidth, renderHeight);
+            auto app = std::make_shared<App>(&dataManager);
 
             pgRunApp(app, window);
 
@@ -66,17 +106,145 @@ extern "C" {
     }
 
     JNIEXPORT void JNICALL Java_com_example_OptixRenderer_loadChunk(JNIEnv* env, jobject obj, jbyteArray chunkData, jint size) {
-        jbyte* nativeJData = env->GetByteArrayElements(chunkData, NULL);
-        uint8_t* nativeData = reinterpret_cast<uint8_t*>(nativeJData);
-        
-        dataManager.readChunk(nativeData, size);
+        if (!checkArraySize(env, chunkData, size, "loadChunk")) {
+            return;
+        }
+        // Decoding happens on the decode pool, keep our own copy of the bytes
+        std::vector<uint8_t> nativeData(static_cast<size_t>(size));
+        env->GetByteArrayRegion(chunkData, 0, size, reinterpret_cast<jbyte*>(nativeData.data()));
+
+        dataManager.submitChunk(std::move(nativeData));
     }
 
     JNIEXPORT void JNICALL Java_com_example_OptixRenderer_updateData(JNIEnv* env, jobject obj, jbyteArray updateData, jint size) {
+        if (!checkArraySize(env, updateData, size, "updateData")) {
+            return;
+        }
         jbyte* nativeJData = env->GetByteArrayElements(updateData, NULL);
         uint8_t* nativeData = reinterpret_cast<uint8_t*>(nativeJData);
 
-        dataManager.readData(nativeData, size);
+        dataManager.applyBlockDelta(nativeData, static_cast<size_t>(size));
+
+        // We never write to the array, nothing to copy back
+        env->ReleaseByteArrayElements(updateData, nativeJData, JNI_ABORT);
+    }
+
+    // Same as loadChunk for a chunk whose position Java already knows, it is decoded nearest to the camera first
+    JNIEXPORT void JNICALL Java_com_example_OptixRenderer_loadChunkAt(JNIEnv* env, jobject obj, jint x, jint z, jbyteArray chunkData, jint size) {
+        if (!checkArraySize(env, chunkData, size, "loadChunkAt")) {
+            return;
+        }
+        std::vector<uint8_t> nativeData(static_cast<size_t>(size));
+        env->GetByteArrayRegion(chunkData, 0, size, reinterpret_cast<jbyte*>(nativeData.data()));
+
+        dataManager.submitChunk(ChunkPos{ x, z }, std::move(nativeData));
+    }
+
+    // Pre-baked chunks, see tools/prebake. Returns false when the file is missing or not a chunk cache.
+    JNIEXPORT jboolean JNICALL Java_com_example_OptixRenderer_openChunkCache(JNIEnv* env, jobject obj, jstring path) {
+        const char* nativePath = env->GetStringUTFChars(path, NULL);
+        if (nativePath == nullptr) {
+            return JNI_FALSE;
+        }
+        bool opened = dataManager.openCache(nativePath);
+        env->ReleaseStringUTFChars(path, nativePath);
+        return opened ? JNI_TRUE : JNI_FALSE;
+    }
+
+    // Loads a chunk from the open cache instead of its NBT. Returns false when the cache does not
+    // have it, send it with loadChunkAt then.
+    JNIEXPORT jboolean JNICALL Java_com_example_OptixRenderer_loadCachedChunk(JNIEnv* env, jobject obj, jint x, jint z) {
+        return dataManager.read(x, z) ? JNI_TRUE : JNI_FALSE;
+    }
+
+    // Zero copy variants, the buffers must be direct ByteBuffers.
+    // A buffer passed to loadChunkDirect must not be modified or freed by Java until its ticket
+    // has been returned by pollReleasedBuffers.
+    JNIEXPORT void JNICALL Java_com_example_OptixRenderer_loadChunkDirect(JNIEnv* env, jobject obj, jobject chunkBuffer, jint size, jlong ticket) {
+        auto release = [ticket]() {
+            std::lock_guard lock(releasedMutex);
+            releasedBuffers.push_back(ticket);
+        };
+
+        if (!checkDirectBuffer(env, chunkBuffer, size, "loadChunkDirect")) {
+            release();
+            return;
+        }
+
+        dataManager.submitChunk(static_cast<const uint8_t*>(env->GetDirectBufferAddress(chunkBuffer)), static_cast<size_t>(size), release);
+    }
+
+    JNIEXPORT void JNICALL Java_com_example_OptixRenderer_updateDataDirect(JNIEnv* env, jobject obj, jobject updateBuffer, jint size) {
+        if (!checkDirectBuffer(env, updateBuffer, size, "updateDataDirect")) {
+            return;
+        }
+
+        dataManager.applyBlockDelta(static_cast<const uint8_t*>(env->GetDirectBufferAddress(updateBuffer)), static_cast<size_t>(size));
+    }
+
+    JNIEXPORT void JNICALL Java_com_example_OptixRenderer_unloadChunk(JNIEnv* env, jobject obj, jint x, jint z) {
+        dataManager.unloadChunk(x, z);
+    }
+
+    // A full resend of a resident chunk, it replaces the old copy
+    JNIEXPORT void JNICALL Java_com_example_OptixRenderer_updateChunk(JNIEnv* env, jobject obj, jbyteArray chunkData, jint size) {
+        if (!checkArraySize(env, chunkData, size, "updateChunk")) {
+            return;
+        }
+        std::vector<uint8_t> nativeData(static_cast<size_t>(size));
+        env->GetByteArrayRegion(chunkData, 0, size, reinterpret_cast<jbyte*>(nativeData.data()));
+
+        dataManager.submitChunk(std::move(nativeData));
+    }
+
+    JNIEXPORT void JNICALL Java_com_example_OptixRenderer_setMemoryBudget(JNIEnv* env, jobject obj, jlong bytes) {
+        dataManager.setMemoryBudget(bytes > 0 ? static_cast<size_t>(bytes) : SIZE_MAX);
+    }
+
+    JNIEXPORT void JNICALL Java_com_example_OptixRenderer_setCameraPosition(JNIEnv* env, jobject obj, jdouble x, jdouble y, jdouble z) {
+        dataManager.setViewer(x, z);
+    }
+
+    // Minecraft angles in degrees: yaw 0 looks towards +z and grows clockwise seen from above, pitch 90 looks down.
+    // aspect is width / height of the game window, the render window's is used when it is not positive.
+    JNIEXPORT void JNICALL Java_com_example_OptixRenderer_setCameraRotation(JNIEnv* env, jobject obj, jfloat yaw, jfloat pitch, jfloat fovY, jfloat aspect) {
+        const float toRadians = 3.14159265f / 180.0f;
+        float cosPitch = std::cos(pitch * toRadians);
+        float direction[3] = { -std::sin(yaw * toRadians) * cosPitch, -std::sin(pitch * toRadians), std::cos(yaw * toRadians) * cosPitch };
+        if (!(aspect > 0.0f)) {
+            aspect = static_cast<float>(renderWidth) / static_cast<float>(renderHeight);
+        }
+        dataManager.setViewDirection(direction, fovY, aspect);
+    }
+
+    // { resident chunks, resident bytes, max chunks, memory budget, evicted chunks, evicted bytes }
+    JNIEXPORT jlongArray JNICALL Java_com_example_OptixRenderer_getMemoryStats(JNIEnv* env, jobject obj) {
+        WorldStore::Stats stats = dataManager.worldStore().stats();
+        auto clamp = [](uint64_t value) { return static_cast<jlong>(std::min<uint64_t>(value, INT64_MAX)); };
+        jlong values[] = {
+            clamp(stats.residentChunks), clamp(stats.residentBytes), clamp(stats.maxChunks),
+            clamp(stats.memoryBudget), clamp(stats.evictedChunks), clamp(stats.evictedBytes)
+        };
+
+        jlongArray result = env->NewLongArray(6);
+        if (result != nullptr) {
+            env->SetLongArrayRegion(result, 0, 6, values);
+        }
+        return result;
+    }
+
+    JNIEXPORT jlongArray JNICALL Java_com_example_OptixRenderer_pollReleasedBuffers(JNIEnv* env, jobject obj) {
+        std::vector<jlong> tickets;
+        {
+            std::lock_guard lock(releasedMutex);
+            tickets.swap(releasedBuffers);
+        }
+
+        jlongArray result = env->NewLongArray(static_cast<jsize>(tickets.size()));
+        if (result != nullptr && !tickets.empty()) {
+            env->SetLongArrayRegion(result, 0, static_cast<jsize>(tickets.size()), tickets.data());
+        }
+        return result;
     }
 }
 
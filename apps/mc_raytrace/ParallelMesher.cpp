@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <tuple>
+#include "ParallelMesher.h"
+
+ParallelMesher::ParallelMesher(TaskPool& pool) : pool(pool) {
+    for (uint32_t i = 0; i < pool.numThreads(); ++i) {
+        outputs.push_back(std::make_unique<WorkerOutput>());
+    }
+    reserve(16384);
+}
+
+ParallelMesher::~ParallelMesher() {
+    std::unique_lock lock(doneMutex);
+    done.wait(lock, [this]() { return pending.load() == 0; });
+}
+
+void ParallelMesher::reserve(size_t quadsPerThread) {
+    for (std::unique_ptr<WorkerOutput>& output : outputs) {
+        ChunkMesh& mesh = output->mesh;
+        mesh.positions.reserve(quadsPerThread * 4);
+        mesh.texcoords.reserve(quadsPerThread * 4);
+        mesh.triangles.reserve(quadsPerThread * 2);
+        mesh.directions.reserve(quadsPerThread * 2);
+        mesh.states.reserve(quadsPerThread * 2);
+    }
+}
+
+size_t ParallelMesher::add(std::shared_ptr<const Chunk> chunk,
+                           std::shared_ptr<const Chunk> negX, std::shared_ptr<const Chunk> posX,
+                           std::shared_ptr<const Chunk> negZ, std::shared_ptr<const Chunk> posZ) {
+    auto job = std::make_shared<Job>();
+    job->index = static_cast<uint32_t>(positions.size());
+    job->neighbours = { negX.get(), posX.get(), negZ.get(), posZ.get() };
+    job->pinned[0] = std::move(negX);
+    job->pinned[1] = std::move(posX);
+    job->pinned[2] = std::move(negZ);
+    job->pinned[3] = std::move(posZ);
+    job->chunk = std::move(chunk);
+    positions.push_back(job->chunk->pos);
+
+    // Lazy sections are decoded by the task that meshes them
+    size_t count = job->chunk->sectionCount();
+    pending.fetch_add(static_cast<int64_t>(count));
+    for (size_t i = 0; i < count; ++i) {
+        pool.submit([this, job, i]() {
+            meshSection(*job, i);
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard lock(doneMutex);
+                done.notify_all();
+            }
+        });
+    }
+    return job->index;
+}
+
+void ParallelMesher::meshSection(const Job& job, size_t index) {
+    WorkerOutput& output = *outputs[pool.currentThreadIndex()];
+    std::shared_ptr<const Section> section = job.chunk->sectionAt(index);
+    if (!output.mesher.isEmpty(*section)) {
+        ChunkMesher::captureBorders(*job.chunk, section->y, job.neighbours, output.borders);
+    }
+    output.mesher.meshSection(*section, output.borders, output.mesh);
+    output.jobOfSection.push_back(job.index);
+}
+
+void ParallelMesher::finish(std::vector<ChunkMesh>& meshes) {
+    {
+        std::unique_lock lock(doneMutex);
+        done.wait(lock, [this]() { return pending.load() == 0; });
+    }
+
+    // Every meshed section as (job, y, worker, section in worker output)
+    std::vector<std::tuple<uint32_t, int32_t, uint32_t, uint32_t>> order;
+    for (uint32_t w = 0; w < outputs.size(); ++w) {
+        const WorkerOutput& output = *outputs[w];
+        for (uint32_t s = 0; s < output.mesh.sections.size(); ++s) {
+            order.emplace_back(output.jobOfSection[s], output.mesh.sections[s].y, w, s);
+        }
+    }
+    std::sort(order.begin(), order.end());
+
+    // Size every mesh up front so the copies below never reallocate
+    std::vector<size_t> vertexCount(positions.size(), 0), triangleCount(positions.size(), 0), sectionCount(positions.size(), 0);
+    for (const auto& [job, y, w, s] : order) {
+        const ChunkMesh::SectionRange& range = outputs[w]->mesh.sections[s];
+        vertexCount[job] += range.vertexCount;
+        triangleCount[job] += range.triangleCount;
+        ++sectionCount[job];
+    }
+    meshes.resize(positions.size());
+    for (size_t job = 0; job < positions.size(); ++job) {
+        ChunkMesh& mesh = meshes[job];
+        mesh.clear();
+        mesh.pos = positions[job];
+        mesh.positions.reserve(vertexCount[job]);
+        mesh.texcoords.reserve(vertexCount[job]);
+        mesh.triangles.reserve(triangleCount[job]);
+        mesh.directions.reserve(triangleCount[job]);
+        mesh.states.reserve(triangleCount[job]);
+        mesh.sections.reserve(sectionCount[job]);
+    }
+
+    for (const auto& [job, y, w, s] : order) {
+        const ChunkMesh& src = outputs[w]->mesh;
+        const ChunkMesh::SectionRange& range = src.sections[s];
+        ChunkMesh& dst = meshes[job];
+
+        ChunkMesh::SectionRange copied = range;
+        copied.firstVertex = static_cast<uint32_t>(dst.positions.size());
+        copied.vertexCapacity = range.vertexCount;
+        copied.firstTriangle = static_cast<uint32_t>(dst.triangles.size());
+        copied.triangleCapacity = range.triangleCount;
+
+        auto vertices = src.positions.begin() + range.firstVertex;
+        dst.positions.insert(dst.positions.end(), vertices, vertices + range.vertexCount);
+        auto texcoords = src.texcoords.begin() + range.firstVertex;
+        dst.texcoords.insert(dst.texcoords.end(), texcoords, texcoords + range.vertexCount);
+
+        uint32_t offset = copied.firstVertex - range.firstVertex;
+        for (uint32_t t = range.firstTriangle; t < range.firstTriangle + range.triangleCount; ++t) {
+            const auto& triangle = src.triangles[t];
+            dst.triangles.push_back({ triangle[0] + offset, triangle[1] + offset, triangle[2] + offset });
+        }
+        auto directions = src.directions.begin() + range.firstTriangle;
+        dst.directions.insert(dst.directions.end(), directions, directions + range.triangleCount);
+        auto states = src.states.begin() + range.firstTriangle;
+        dst.states.insert(dst.states.end(), states, states + range.triangleCount);
+
+        dst.sections.push_back(copied);
+    }
+
+    // Keep the worker capacity for the next batch
+    for (std::unique_ptr<WorkerOutput>& output : outputs) {
+        output->mesh.clear();
+        output->jobOfSection.clear();
+    }
+    positions.clear();
+}
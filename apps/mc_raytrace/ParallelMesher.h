@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "ChunkMesher.h"
+#include "DataStructures.h"
+#include "TaskPool.h"
+
+// Meshes a batch of chunks with one task per section.
+// Tasks only read immutable chunk versions pinned by add() and take their own snapshot of the
+// section borders. Every worker appends to its own pre-reserved output and finish() concatenates
+// the outputs into one ChunkMesh per chunk.
+class ParallelMesher {
+	public:
+		explicit ParallelMesher(TaskPool& pool);
+		~ParallelMesher();
+
+		ParallelMesher(const ParallelMesher&) = delete;
+		ParallelMesher& operator=(const ParallelMesher&) = delete;
+
+		// Quads reserved per worker, grow it when batches regularly exceed it
+		void reserve(size_t quadsPerThread);
+
+		// Queue every section of a chunk. Neighbours may be null and count as air then.
+		// Returns the index of the chunk's mesh in the output of finish().
+		size_t add(std::shared_ptr<const Chunk> chunk,
+		           std::shared_ptr<const Chunk> negX = nullptr, std::shared_ptr<const Chunk> posX = nullptr,
+		           std::shared_ptr<const Chunk> negZ = nullptr, std::shared_ptr<const Chunk> posZ = nullptr);
+		// Wait for the queued sections and write one mesh per added chunk, sections sorted by y.
+		// The mesher can be reused for the next batch afterwards.
+		void finish(std::vector<ChunkMesh>& meshes);
+	private:
+		struct Job {
+			uint32_t index;
+			std::shared_ptr<const Chunk> chunk;
+			ChunkMesher::Neighbours neighbours;
+			std::shared_ptr<const Chunk> pinned[4]; // keeps the neighbours alive
+		};
+
+		// Output of one worker thread, sections in the order they were meshed
+		struct WorkerOutput {
+			ChunkMesher mesher;
+			ChunkMesh mesh;
+			std::vector<uint32_t> jobOfSection; // parallel to mesh.sections
+			SectionBorders borders;
+		};
+
+		void meshSection(const Job& job, size_t section);
+
+		TaskPool& pool;
+		std::vector<ChunkPos> positions; // by job index
+		std::vector<std::unique_ptr<WorkerOutput>> outputs; // by pool worker index
+
+		std::atomic<int64_t> pending{ 0 };
+		std::mutex doneMutex;
+		std::condition_variable done;
+};
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <cmath>
+#include "BlockStateRegistry.h"
+#include "ChunkMesher.h"
+#include "ReferenceRenderer.h"
+
+namespace {
+    struct Vec {
+        float x, y, z;
+    };
+
+    Vec operator-(const Vec& a, const Vec& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    Vec operator+(const Vec& a, const Vec& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+    Vec operator*(const Vec& a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+    float dot(const Vec& a, const Vec& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    Vec cross(const Vec& a, const Vec& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+    Vec normalize(const Vec& a) { return a * (1.0f / std::sqrt(dot(a, a))); }
+
+    const Vec SKY{ 0.55f, 0.7f, 0.9f };
+    const Vec SUN = normalize({ 0.4f, 1.0f, 0.25f });
+    constexpr float AMBIENT = 0.35f;
+
+    Vec materialColor(BlockMaterial material) {
+        switch (material) {
+            case BlockMaterial::Cutout: return { 0.3f, 0.55f, 0.25f };
+            case BlockMaterial::Glass:  return { 0.8f, 0.9f, 0.95f };
+            case BlockMaterial::Water:  return { 0.2f, 0.35f, 0.8f };
+            default:                    return { 0.6f, 0.6f, 0.6f };
+        }
+    }
+
+    // Slight per state tint so neighbouring block types stay apart
+    float stateTint(uint16_t state) {
+        uint32_t h = state * 2654435761u;
+        return 0.85f + 0.15f * static_cast<float>(h >> 24) / 255.0f;
+    }
+
+    uint32_t pack(const Vec& c) {
+        auto channel = [](float v) { return static_cast<uint32_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); };
+        return channel(c.x) | (channel(c.y) << 8) | (channel(c.z) << 16) | (255u << 24);
+    }
+}
+
+void renderReference(const VoxelWorldView& world, const ReferenceCamera& camera, uint32_t width, uint32_t height,
+                     std::vector<uint32_t>& pixels, TaskPool* pool, const LightEngine* light) {
+    pixels.assign(static_cast<size_t>(width) * height, 0);
+
+    // Colors of every registered state, looked up by the render threads without locking
+    ChunkMesher classifier;
+    std::vector<Vec> colors(BlockStateRegistry::instance().size());
+    for (size_t state = 0; state < colors.size(); ++state) {
+        uint16_t id = static_cast<uint16_t>(state);
+        colors[state] = materialColor(classifier.material(id)) * stateTint(id);
+    }
+
+    const Vec origin{ camera.origin[0], camera.origin[1], camera.origin[2] };
+    const Vec w = normalize(Vec{ camera.lookat[0], camera.lookat[1], camera.lookat[2] } - origin);
+    const Vec u = normalize(cross(w, { camera.up[0], camera.up[1], camera.up[2] }));
+    const Vec v = cross(u, w);
+    const float halfHeight = std::tan(camera.fovY * 0.5f * 3.14159265f / 180.0f);
+    const float halfWidth = halfHeight * width / height;
+
+    auto renderRow = [&](uint32_t row) {
+        for (uint32_t column = 0; column < width; ++column) {
+            float sx = (2.0f * (column + 0.5f) / width - 1.0f) * halfWidth;
+            float sy = (1.0f - 2.0f * (row + 0.5f) / height) * halfHeight;
+            Vec d = normalize(w + u * sx + v * sy);
+
+            const float o[3] = { origin.x, origin.y, origin.z };
+            const float dir[3] = { d.x, d.y, d.z };
+            VoxelHit hit;
+            Vec color = SKY;
+            if (traceVoxels(world, o, dir, 0.0f, voxel::NO_HIT, hit)) {
+                std::array<float, 3> n = ChunkMesh::normal(static_cast<FaceDirection>(hit.face));
+                Vec normal{ n[0], n[1], n[2] };
+                Vec albedo = hit.state < colors.size() ? colors[hit.state] : materialColor(BlockMaterial::Opaque);
+
+                // Start the shadow ray just off the face that was hit
+                Vec p = origin + d * hit.t + normal * 1e-3f;
+                const float po[3] = { p.x, p.y, p.z };
+                const float sun[3] = { SUN.x, SUN.y, SUN.z };
+                VoxelHit blocker;
+                float direct = std::max(0.0f, dot(normal, SUN));
+                if (direct > 0.0f && traceVoxels(world, po, sun, 0.0f, voxel::NO_HIT, blocker)) {
+                    direct = 0.0f;
+                }
+                float ambient = AMBIENT;
+                if (light) {
+                    BlockPos front = { hit.x + static_cast<int32_t>(n[0]), hit.y + static_cast<int32_t>(n[1]), hit.z + static_cast<int32_t>(n[2]) };
+                    uint8_t level = std::max(light->skyLight(front), light->blockLight(front));
+                    ambient *= static_cast<float>(level) / LightEngine::MAX_LIGHT;
+                }
+                color = albedo * (ambient + (1.0f - AMBIENT) * direct);
+            }
+            pixels[static_cast<size_t>(row) * width + column] = pack(color);
+        }
+    };
+
+    if (!pool) {
+        for (uint32_t row = 0; row < height; ++row) {
+            renderRow(row);
+        }
+        return;
+    }
+    for (uint32_t row = 0; row < height; ++row) {
+        pool->submit([&renderRow, row]() { renderRow(row); });
+    }
+    pool->wait();
+}
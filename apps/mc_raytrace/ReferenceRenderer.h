@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "LightEngine.h"
+#include "TaskPool.h"
+#include "VoxelTraversal.h"
+
+// Pinhole camera in block coordinates
+struct ReferenceCamera {
+    float origin[3];
+    float lookat[3];
+    float up[3];
+    float fovY; // degrees
+};
+
+// Ray casts a voxel world on the CPU: one primary ray per pixel, a sun with hard shadows and a
+// flat color per block material. Ground truth for the GPU paths, and a way to look at a world
+// without a GPU. Pixels are RGBA8 with red in the lowest byte, rows from the top.
+// Rows are spread over the pool when one is given. With a light engine the ambient term is
+// scaled by the sky and block light in front of the face that was hit instead of being constant.
+void renderReference(const VoxelWorldView& world, const ReferenceCamera& camera, uint32_t width, uint32_t height,
+                     std::vector<uint32_t>& pixels, TaskPool* pool = nullptr, const LightEngine* light = nullptr);
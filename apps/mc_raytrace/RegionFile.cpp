@@ -0,0 +1,80 @@
+#include <iostream>
+#include "RegionFile.h"
+
+namespace {
+    constexpr size_t HEADER_SIZE = 2 * RegionFile::SECTOR_SIZE;
+    constexpr uint8_t EXTERNAL_FLAG = 128;
+
+    uint32_t readBigEndian32(const uint8_t* bytes) {
+        return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+    }
+}
+
+bool RegionFile::open(const std::string& path) {
+    if (!file.open(path)) {
+        return false;
+    }
+    // Regions that were created but never written to have no header
+    if (file.size() < HEADER_SIZE) {
+        file.close();
+        return false;
+    }
+    // Chunks are read in whatever order the caller needs, do not read ahead by default
+    file.adviseRandom();
+    return true;
+}
+
+uint32_t RegionFile::headerEntry(size_t table, int32_t localX, int32_t localZ) const {
+    if (!file.isOpen() || localX < 0 || localX >= CHUNKS_PER_SIDE || localZ < 0 || localZ >= CHUNKS_PER_SIDE) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(localZ * CHUNKS_PER_SIDE + localX);
+    return readBigEndian32(file.data() + table + index * 4);
+}
+
+RegionFile::ChunkSpan RegionFile::chunk(int32_t localX, int32_t localZ) const {
+    ChunkSpan span;
+    uint32_t location = headerEntry(0, localX, localZ);
+    size_t sector = location >> 8;
+    size_t sectorCount = location & 0xFF;
+    if (sector < 2 || sectorCount == 0) {
+        return span;
+    }
+
+    // Length includes the compression byte
+    const uint8_t* mapped = file.data();
+    size_t start = sector * SECTOR_SIZE;
+    if (start + 5 > file.size()) {
+        return span;
+    }
+    size_t length = readBigEndian32(mapped + start);
+    uint8_t compression = mapped[start + 4];
+    if (length < 1 || start + 4 + length > file.size()) {
+        return span;
+    }
+    if (compression & EXTERNAL_FLAG) {
+        std::cerr << "Chunk " << localX << ", " << localZ << " is stored in an external .mcc file, skipping" << std::endl;
+        return span;
+    }
+    if (compression != GZip && compression != Zlib && compression != Uncompressed) {
+        return span;
+    }
+
+    span.data = mapped + start + 5;
+    span.size = length - 1;
+    span.compression = compression;
+    return span;
+}
+
+bool RegionFile::hasChunk(int32_t localX, int32_t localZ) const {
+    return !chunk(localX, localZ).empty();
+}
+
+uint32_t RegionFile::timestamp(int32_t localX, int32_t localZ) const {
+    return headerEntry(SECTOR_SIZE, localX, localZ);
+}
+
+void RegionFile::prefetch(int32_t localX, int32_t localZ) const {
+    ChunkSpan span = chunk(localX, localZ);
+    file.willNeed(span.data, span.size);
+}
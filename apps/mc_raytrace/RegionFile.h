@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "MappedFile.h"
+
+// Read only, memory mapped anvil region file (r.x.z.mca).
+// The 8 KiB location and timestamp header is read in place and chunks are handed out as spans
+// into the mapping, so only the pages of chunks that are actually decoded are ever read.
+// Spans stay valid until the region is closed.
+class RegionFile {
+	public:
+		static constexpr int32_t CHUNKS_PER_SIDE = 32;
+		static constexpr size_t SECTOR_SIZE = 4096;
+
+		enum Compression : uint8_t {
+			GZip = 1,
+			Zlib = 2,
+			Uncompressed = 3,
+			LZ4 = 4,
+		};
+
+		// Compressed chunk NBT as stored in the region, ChunkInflater sniffs the format itself
+		struct ChunkSpan {
+			const uint8_t* data = nullptr;
+			size_t size = 0;
+			uint8_t compression = 0;
+
+			bool empty() const { return size == 0; }
+		};
+
+		bool open(const std::string& path);
+		void close() { file.close(); }
+		bool isOpen() const { return file.isOpen(); }
+
+		// Local chunk coordinates in [0, 32). Empty when the chunk was never generated, is stored in
+		// an external .mcc file, uses a compression we can not inflate or points outside the file.
+		ChunkSpan chunk(int32_t localX, int32_t localZ) const;
+		bool hasChunk(int32_t localX, int32_t localZ) const;
+		// Seconds since the epoch of the last save, 0 if absent
+		uint32_t timestamp(int32_t localX, int32_t localZ) const;
+		// Hint that the chunk is about to be read so the kernel can start paging it in
+		void prefetch(int32_t localX, int32_t localZ) const;
+
+		size_t size() const { return file.size(); }
+	private:
+		uint32_t headerEntry(size_t table, int32_t localX, int32_t localZ) const;
+
+		MappedFile file;
+};
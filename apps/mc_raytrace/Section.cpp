@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <atomic>
+#include "DataStructures.h"
+#include "LazySections.h"
+
+namespace {
+    // Smallest power of two bit width able to index paletteSize entries
+    uint8_t bitsForPalette(size_t paletteSize) {
+        if (paletteSize <= 1) return 0;
+        if (paletteSize <= 2) return 1;
+        if (paletteSize <= 4) return 2;
+        if (paletteSize <= 16) return 4;
+        if (paletteSize <= 256) return 8;
+        return 16;
+    }
+}
+
+std::shared_ptr<Section> Section::pack(int32_t y, const uint16_t* states) {
+    // Palette slot of every global id, only the entries we touch are reset afterwards
+    thread_local std::vector<int32_t> slotOfState(UINT16_MAX + 1, -1);
+
+    auto section = std::make_shared<Section>();
+    section->y = y;
+    section->generation = nextGeneration();
+
+    uint16_t indices[SECTION_VOLUME];
+    for (uint32_t i = 0; i < SECTION_VOLUME; ++i) {
+        int32_t& slot = slotOfState[states[i]];
+        if (slot < 0) {
+            slot = static_cast<int32_t>(section->palette.size());
+            section->palette.push_back(states[i]);
+        }
+        indices[i] = static_cast<uint16_t>(slot);
+    }
+    for (uint16_t state : section->palette) {
+        slotOfState[state] = -1;
+    }
+
+    section->bitsPerBlock = bitsForPalette(section->palette.size());
+    if (section->bitsPerBlock) {
+        uint32_t bits = section->bitsPerBlock;
+        section->data.assign(SECTION_VOLUME * bits / 64, 0);
+        for (uint32_t i = 0; i < SECTION_VOLUME; ++i) {
+            uint32_t bit = i * bits;
+            section->data[bit >> 6] |= static_cast<uint64_t>(indices[i]) << (bit & 63);
+        }
+    }
+    return section;
+}
+
+void Section::unpack(uint16_t* states) const {
+    if (bitsPerBlock == 0) {
+        std::fill(states, states + SECTION_VOLUME, palette[0]);
+        return;
+    }
+    uint32_t perWord = 64 / bitsPerBlock;
+    uint64_t mask = (uint64_t(1) << bitsPerBlock) - 1;
+    for (uint32_t word = 0; word < data.size(); ++word) {
+        uint64_t value = data[word];
+        for (uint32_t i = 0; i < perWord; ++i) {
+            states[word * perWord + i] = palette[static_cast<uint32_t>(value & mask)];
+            value >>= bitsPerBlock;
+        }
+    }
+}
+
+uint64_t Section::nextGeneration() {
+    static std::atomic<uint64_t> generation{ 0 };
+    return ++generation;
+}
+
+void Section::set(uint32_t index, uint16_t state) {
+    auto it = std::find(palette.begin(), palette.end(), state);
+    if (it == palette.end()) {
+        if (palette.size() >= (size_t(1) << bitsPerBlock)) {
+            uint16_t states[SECTION_VOLUME];
+            unpack(states);
+            states[index] = state;
+            *this = std::move(*pack(y, states));
+            return;
+        }
+        it = palette.insert(palette.end(), state);
+    }
+    if (bitsPerBlock == 0) {
+        return;
+    }
+    generation = nextGeneration();
+
+    uint64_t slot = static_cast<uint64_t>(it - palette.begin());
+    uint32_t bit = index * bitsPerBlock;
+    uint64_t mask = ((uint64_t(1) << bitsPerBlock) - 1) << (bit & 63);
+    data[bit >> 6] = (data[bit >> 6] & ~mask) | (slot << (bit & 63));
+}
+
+size_t Section::memoryUsage() const {
+    return sizeof(Section) + palette.capacity() * sizeof(uint16_t) + data.capacity() * sizeof(uint64_t);
+}
+
+const Section* Chunk::section(int32_t y) const {
+    if (lazy) {
+        int32_t i = lazy->find(y);
+        return i >= 0 ? lazy->section(i).get() : nullptr;
+    }
+    auto it = std::lower_bound(sections.begin(), sections.end(), y,
+        [](const std::shared_ptr<const Section>& section, int32_t sectionY) { return section->y < sectionY; });
+    if (it == sections.end() || (*it)->y != y) {
+        return nullptr;
+    }
+    return it->get();
+}
+
+size_t Chunk::sectionCount() const {
+    return lazy ? lazy->size() : sections.size();
+}
+
+std::shared_ptr<const Section> Chunk::sectionAt(size_t i) const {
+    return lazy ? lazy->section(i) : sections[i];
+}
+
+size_t Chunk::memoryUsage() const {
+    size_t bytes = sizeof(Chunk) + sections.capacity() * sizeof(std::shared_ptr<const Section>);
+    for (const auto& section : sections) {
+        bytes += section->memoryUsage();
+    }
+    if (lazy) {
+        bytes += lazy->memoryUsage();
+    }
+    for (const Heightmap& heightmap : heightmaps) {
+        bytes += heightmap.memoryUsage();
+    }
+    return bytes;
+}
@@ -1,14 +1,24 @@
-#include <windows.h>
 #include <iostream>
 #include "SharedBuffer.h"
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-SharedBuffer::SharedBuffer(const char* name, const size_t size) {
+SharedBuffer::SharedBuffer(const char* name, const size_t size, bool hugePages) {
     fileName = name;
     memorySize = size;
+    this->hugePages = hugePages;
 }
 
-void SharedBuffer::setup() {
+bool SharedBuffer::setup() {
+    close();
 
+#ifdef _WIN32
     // Open the shared memory file created by Java
     fileHandle = CreateFileA(
         fileName,
@@ -21,6 +31,7 @@ void SharedBuffer::setup() {
 
     if (fileHandle == INVALID_HANDLE_VALUE) {
         std::cerr << "Failed to open shared memory file. Error: " << fileName << GetLastError() << std::endl;
+        return false;
     }
 
     // Create a file mapping object
@@ -35,6 +46,9 @@ void SharedBuffer::setup() {
     if (mappingHandle == NULL) {
         std::cerr << "Failed to create file mapping. Error: " << fileName << GetLastError() << std::endl;
         CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+        mappingHandle = NULL;
+        return false;
     }
 
     // Map the shared memory into the process's address space
@@ -47,12 +61,44 @@ void SharedBuffer::setup() {
 
     if (sharedMemory == NULL) {
         std::cerr << "Failed to map shared memory. Error: " << fileName << GetLastError() << std::endl;
-        CloseHandle(mappingHandle);
-        CloseHandle(fileHandle);
+        close();
+        return false;
+    }
+    // Large pages need SeLockMemoryPrivilege and an anonymous mapping, not a file view
+    (void)hugePages;
+#else
+    int fd = ::open(fileName, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Failed to open shared memory file. Error: " << fileName << " " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    // Grow the file like CreateFileMapping does, mapping past its end would fault on access
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (static_cast<size_t>(info.st_size) < memorySize && ftruncate(fd, static_cast<off_t>(memorySize)) != 0)) {
+        std::cerr << "Failed to size shared memory file. Error: " << fileName << " " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    void* address = mmap(nullptr, memorySize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // The mapping keeps the file referenced
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        std::cerr << "Failed to map shared memory. Error: " << fileName << " " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    sharedMemory = address;
+#ifdef MADV_HUGEPAGE
+    // Honoured for tmpfs when shmem_enabled allows it, hugetlbfs files are huge anyway
+    if (hugePages) {
+        madvise(sharedMemory, memorySize, MADV_HUGEPAGE);
     }
+#endif
+#endif
 
     std::cout << "C++ : Setup shared memory : " << fileName << std::endl;
     writeInt(0, 80);
+    return true;
 }
 
 int SharedBuffer::readInt(int index) {
@@ -82,7 +128,22 @@ void SharedBuffer::writeFloat(int index, float value) {
 
 void SharedBuffer::close() {
     // Cleanup
-    UnmapViewOfFile(sharedMemory);
-    CloseHandle(mappingHandle);
-    CloseHandle(fileHandle);
+#ifdef _WIN32
+    if (sharedMemory) {
+        UnmapViewOfFile(sharedMemory);
+    }
+    if (mappingHandle != NULL) {
+        CloseHandle(mappingHandle);
+        mappingHandle = NULL;
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (sharedMemory) {
+        munmap(sharedMemory, memorySize);
+    }
+#endif
+    sharedMemory = nullptr;
 }
\ No newline at end of file
@@ -1,11 +1,19 @@
 #pragma once
 
+#include <cstddef>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
+// Shared memory channel with the Java side, which creates the backing file.
+// On Windows the file is mapped with MapViewOfFile, elsewhere with mmap(MAP_SHARED), so both
+// sides see each other's writes without copies. On Linux, keep the file under /dev/shm to back it
+// by memory instead of the disk, or on a hugetlbfs mount for huge pages.
 class SharedBuffer {
 	public:
-		SharedBuffer(const char* name, const size_t size);
-		void setup();
+		// hugePages asks for transparent huge pages where the file system supports them
+		SharedBuffer(const char* name, const size_t size, bool hugePages = false);
+		bool setup();
 		int readInt(int index);
 		void writeInt(int index, int value);
 		float readFloat(int index);
@@ -14,7 +22,10 @@ class SharedBuffer {
 	private:
 		const char* fileName;
 		size_t memorySize;
-		void* sharedMemory;
-		HANDLE mappingHandle;
-		HANDLE fileHandle;
-};
\ No newline at end of file
+		bool hugePages;
+		void* sharedMemory = nullptr;
+#ifdef _WIN32
+		HANDLE mappingHandle = NULL;
+		HANDLE fileHandle = INVALID_HANDLE_VALUE;
+#endif
+};
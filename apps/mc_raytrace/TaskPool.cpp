@@ -0,0 +1,111 @@
+#include <algorithm>
+#include "TaskPool.h"
+
+namespace {
+    thread_local const TaskPool* currentPool = nullptr;
+    thread_local int32_t currentIndex = -1;
+}
+
+TaskPool::TaskPool(uint32_t numThreads) {
+    if (numThreads == 0) {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        numThreads = std::max<uint32_t>(hardwareThreads > 1 ? hardwareThreads - 1 : 1, 1);
+    }
+
+    workers.reserve(numThreads);
+    for (uint32_t i = 0; i < numThreads; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    threads.reserve(numThreads);
+    for (uint32_t i = 0; i < numThreads; ++i) {
+        threads.emplace_back([this, i]() { run(i); });
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void TaskPool::submit(Task task) {
+    int32_t self = currentThreadIndex();
+    uint32_t index = self >= 0 ? static_cast<uint32_t>(self) : nextQueue.fetch_add(1, std::memory_order_relaxed) % workers.size();
+
+    unfinished.fetch_add(1);
+    {
+        std::lock_guard lock(workers[index]->mutex);
+        workers[index]->tasks.push_back(std::move(task));
+    }
+    queued.fetch_add(1);
+
+    {
+        std::lock_guard lock(sleepMutex);
+    }
+    wakeUp.notify_one();
+}
+
+void TaskPool::wait() {
+    std::unique_lock lock(sleepMutex);
+    idle.wait(lock, [this]() { return unfinished.load() == 0; });
+}
+
+int32_t TaskPool::currentThreadIndex() const {
+    return currentPool == this ? currentIndex : -1;
+}
+
+void TaskPool::run(uint32_t index) {
+    currentPool = this;
+    currentIndex = static_cast<int32_t>(index);
+
+    for (;;) {
+        Task task;
+        if (popLocal(index, task) || steal(index, task)) {
+            queued.fetch_sub(1);
+            task();
+            if (unfinished.fetch_sub(1) == 1) {
+                std::lock_guard lock(sleepMutex);
+                idle.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock lock(sleepMutex);
+        wakeUp.wait(lock, [this]() { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+// Newest task first from our own queue, keeps the data it touches warm in cache
+bool TaskPool::popLocal(uint32_t index, Task& task) {
+    Worker& worker = *workers[index];
+    std::lock_guard lock(worker.mutex);
+    if (worker.tasks.empty()) {
+        return false;
+    }
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+// Oldest task from the first other worker that has one
+bool TaskPool::steal(uint32_t index, Task& task) {
+    for (size_t i = 1; i < workers.size(); ++i) {
+        Worker& victim = *workers[(index + i) % workers.size()];
+        std::unique_lock lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.tasks.empty()) {
+            continue;
+        }
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
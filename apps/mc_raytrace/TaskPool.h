@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small work-stealing thread pool.
+// Every worker owns a queue, tasks submitted from a worker go to its own queue and
+// idle workers steal from the front of the other queues.
+class TaskPool {
+	public:
+		using Task = std::function<void()>;
+
+		// numThreads == 0 uses one thread per hardware thread minus the caller
+		explicit TaskPool(uint32_t numThreads = 0);
+		~TaskPool();
+
+		TaskPool(const TaskPool&) = delete;
+		TaskPool& operator=(const TaskPool&) = delete;
+
+		void submit(Task task);
+		// Block until every submitted task has finished
+		void wait();
+
+		uint32_t numThreads() const { return static_cast<uint32_t>(threads.size()); }
+		// Index of the calling worker thread in this pool, -1 for other threads
+		int32_t currentThreadIndex() const;
+	private:
+		struct Worker {
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		void run(uint32_t index);
+		bool popLocal(uint32_t index, Task& task);
+		bool steal(uint32_t index, Task& task);
+
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::vector<std::thread> threads;
+
+		std::mutex sleepMutex;
+		std::condition_variable wakeUp;
+		std::condition_variable idle;
+		std::atomic<uint32_t> nextQueue{ 0 };
+		std::atomic<int64_t> queued{ 0 };
+		std::atomic<int64_t> unfinished{ 0 };
+		bool stopping = false;
+};
@@ -0,0 +1,207 @@
+#include <cstring>
+#include "UnpackBits.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define UNPACK_BITS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define UNPACK_TARGET(isa)
+#else
+#define UNPACK_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace {
+    // Largest input: 4096 entries at 4 bits per entry
+    constexpr size_t MAX_LONGS = 1024;
+
+    inline uint64_t loadBigEndian(const uint8_t* bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value = (value << 8) | bytes[i];
+        }
+        return value;
+    }
+
+    void unpackScalar(const uint8_t* longs, uint32_t bits, uint32_t count, uint16_t* out) {
+        uint32_t perLong = 64 / bits;
+        uint64_t mask = (uint64_t(1) << bits) - 1;
+        for (uint32_t i = 0; i < count; longs += 8) {
+            uint64_t word = loadBigEndian(longs);
+            uint32_t end = i + perLong < count ? i + perLong : count;
+            for (; i < end; ++i, word >>= bits) {
+                out[i] = static_cast<uint16_t>(word & mask);
+            }
+        }
+    }
+
+#ifdef UNPACK_BITS_X86
+    UNPACK_TARGET("sse4.1")
+    inline __m128i byteSwap64(__m128i v) {
+        const __m128i order = _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+        return _mm_shuffle_epi8(v, order);
+    }
+
+    // Widths that divide 64 have no padding bits, the byte swapped longs are then a plain
+    // little endian stream of entries and can be widened directly
+    UNPACK_TARGET("sse4.1")
+    void unpackSSE41(const uint8_t* longs, uint32_t bits, uint32_t count, uint16_t* out) {
+        uint32_t i = 0;
+        if (bits == 4) {
+            const __m128i low = _mm_set1_epi8(0x0F);
+            for (; i + 32 <= count; i += 32, longs += 16) {
+                __m128i v = byteSwap64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(longs)));
+                __m128i even = _mm_and_si128(v, low);
+                __m128i odd = _mm_and_si128(_mm_srli_epi16(v, 4), low);
+                __m128i first = _mm_unpacklo_epi8(even, odd);
+                __m128i second = _mm_unpackhi_epi8(even, odd);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_cvtepu8_epi16(first));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_cvtepu8_epi16(_mm_srli_si128(first, 8)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 16), _mm_cvtepu8_epi16(second));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 24), _mm_cvtepu8_epi16(_mm_srli_si128(second, 8)));
+            }
+        }
+        else if (bits == 8) {
+            for (; i + 16 <= count; i += 16, longs += 16) {
+                __m128i v = byteSwap64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(longs)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_cvtepu8_epi16(v));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_cvtepu8_epi16(_mm_srli_si128(v, 8)));
+            }
+        }
+        else if (bits == 16) {
+            for (; i + 8 <= count; i += 8, longs += 16) {
+                __m128i v = byteSwap64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(longs)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), v);
+            }
+        }
+        if (i < count) {
+            unpackScalar(longs, bits, count - i, out + i);
+        }
+    }
+
+    // Any width: every 64-bit lane tracks the word and bit offset of one entry, words are
+    // gathered from a byte swapped copy and shifted per lane
+    UNPACK_TARGET("avx2")
+    void unpackAVX2(const uint8_t* longs, uint32_t bits, uint32_t count, uint16_t* out) {
+        if (bits == 4 || bits == 8 || bits == 16) {
+            unpackSSE41(longs, bits, count, out);
+            return;
+        }
+
+        alignas(32) uint64_t words[MAX_LONGS];
+        size_t numLongs = packedLongCount(bits, count);
+        if (numLongs > MAX_LONGS) {
+            unpackScalar(longs, bits, count, out);
+            return;
+        }
+        const __m256i order = _mm256_set_epi8(
+            8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7,
+            8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+        size_t w = 0;
+        for (; w + 4 <= numLongs; w += 4) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(longs + w * 8));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(words + w), _mm256_shuffle_epi8(v, order));
+        }
+        for (; w < numLongs; ++w) {
+            words[w] = loadBigEndian(longs + w * 8);
+        }
+
+        // Entries per long is at least 4, so advancing by 4 entries wraps a lane at most once
+        uint32_t perLong = 64 / bits;
+        int64_t laneWord[4], laneShift[4];
+        for (uint32_t lane = 0; lane < 4; ++lane) {
+            laneWord[lane] = lane / perLong;
+            laneShift[lane] = (lane % perLong) * bits;
+        }
+        __m256i word = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(laneWord));
+        __m256i shift = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(laneShift));
+        const __m256i step = _mm256_set1_epi64x(4 * bits);
+        const __m256i wrapAt = _mm256_set1_epi64x(perLong * bits - 1);
+        const __m256i wrapBy = _mm256_set1_epi64x(perLong * bits);
+        const __m256i mask = _mm256_set1_epi64x((int64_t(1) << bits) - 1);
+        const __m256i lowDwords = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+        uint32_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256i values[2];
+            for (int half = 0; half < 2; ++half) {
+                __m256i gathered = _mm256_i64gather_epi64(reinterpret_cast<const long long*>(words), word, 8);
+                values[half] = _mm256_and_si256(_mm256_srlv_epi64(gathered, shift), mask);
+
+                shift = _mm256_add_epi64(shift, step);
+                __m256i wrapped = _mm256_cmpgt_epi64(shift, wrapAt);
+                shift = _mm256_sub_epi64(shift, _mm256_and_si256(wrapped, wrapBy));
+                word = _mm256_sub_epi64(word, wrapped); // wrapped lanes are -1
+            }
+            __m128i first = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(values[0], lowDwords));
+            __m128i second = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(values[1], lowDwords));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi32(first, second));
+        }
+        for (; i < count; ++i) {
+            out[i] = static_cast<uint16_t>((words[i / perLong] >> ((i % perLong) * bits)) & ((uint64_t(1) << bits) - 1));
+        }
+    }
+
+    UnpackPath detectPath() {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+        __cpuid(info, 1);
+        bool sse41 = (info[2] & (1 << 19)) != 0;
+        bool osSavesAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+        bool avx2 = false;
+        if (maxLeaf >= 7 && osSavesAvx) {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+#else
+        __builtin_cpu_init();
+        bool sse41 = __builtin_cpu_supports("sse4.1");
+        bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+        return avx2 ? UnpackPath::AVX2 : sse41 ? UnpackPath::SSE41 : UnpackPath::Scalar;
+    }
+#else
+    UnpackPath detectPath() {
+        return UnpackPath::Scalar;
+    }
+#endif
+}
+
+UnpackPath bestUnpackPath() {
+    static const UnpackPath path = detectPath();
+    return path;
+}
+
+const char* unpackPathName(UnpackPath path) {
+    switch (path) {
+        case UnpackPath::AVX2: return "avx2";
+        case UnpackPath::SSE41: return "sse4.1";
+        default: return "scalar";
+    }
+}
+
+void unpackBits(const uint8_t* longs, uint32_t bits, uint32_t count, uint16_t* out) {
+    unpackBits(bestUnpackPath(), longs, bits, count, out);
+}
+
+void unpackBits(UnpackPath path, const uint8_t* longs, uint32_t bits, uint32_t count, uint16_t* out) {
+#ifdef UNPACK_BITS_X86
+    // Narrow widths leave too few entries per gather, they only occur in biome arrays
+    if (bits >= 4 && bits <= 16) {
+        if (path == UnpackPath::AVX2) {
+            unpackAVX2(longs, bits, count, out);
+            return;
+        }
+        if (path == UnpackPath::SSE41) {
+            unpackSSE41(longs, bits, count, out);
+            return;
+        }
+    }
+#else
+    (void)path;
+#endif
+    unpackScalar(longs, bits, count, out);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Expansion of the packed long arrays used by block_states and biomes.
+// Input is the raw NBT long array: big endian 64-bit words, each holding floor(64 / bits)
+// entries starting at the least significant bit, entries never straddle two words
+// (DataVersion >= 2556). Output is one uint16_t per entry.
+
+enum class UnpackPath { Scalar, SSE41, AVX2 };
+
+// Number of longs needed to hold count entries of the given width
+inline size_t packedLongCount(uint32_t bits, uint32_t count) {
+    uint32_t perLong = 64 / bits;
+    return (count + perLong - 1) / perLong;
+}
+
+// bits must be in [1, 16], longs must hold at least packedLongCount(bits, count) words
+void unpackBits(const uint8_t* longs, uint32_t bits, uint32_t count, uint16_t* out);
+void unpackBits(UnpackPath path, const uint8_t* longs, uint32_t bits, uint32_t count, uint16_t* out);
+
+// Widest path supported by this CPU, picked once at startup
+UnpackPath bestUnpackPath();
+const char* unpackPathName(UnpackPath path);
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cmath>
+#include "VoxelLod.h"
+#include "BlockStateRegistry.h"
+
+namespace {
+    // Most common of eight states, ties go to a visible state so thin floors and walls stay closed
+    uint16_t majority(const uint16_t* states) {
+        uint16_t best = BlockStateRegistry::AIR;
+        int32_t bestCount = 0;
+        for (int32_t i = 0; i < 8; ++i) {
+            int32_t count = 0;
+            for (int32_t j = 0; j < 8; ++j) {
+                count += states[j] == states[i];
+            }
+            if (count > bestCount || (count == bestCount && best == BlockStateRegistry::AIR)) {
+                best = states[i];
+                bestCount = count;
+            }
+        }
+        return best;
+    }
+
+    uint32_t cellIndex(int32_t x, int32_t y, int32_t z) {
+        return static_cast<uint32_t>(((y << VoxelLod::BRICK_BITS) + z) << VoxelLod::BRICK_BITS | x);
+    }
+}
+
+uint32_t VoxelLod::Level::slot(int32_t bx, int32_t by, int32_t bz) const {
+    int32_t x = bx - minBrick[0], y = by - minBrick[1], z = bz - minBrick[2];
+    if (x < 0 || y < 0 || z < 0 || x >= sizeInBricks[0] || y >= sizeInBricks[1] || z >= sizeInBricks[2]) {
+        return UNIFORM | BlockStateRegistry::AIR;
+    }
+    return slots[(static_cast<size_t>(z) * sizeInBricks[1] + y) * sizeInBricks[0] + x];
+}
+
+void VoxelLod::build(const VoxelWorldView& world, int32_t maxLevel) {
+    levels.clear();
+    maxLevel = std::clamp(maxLevel, 0, MAX_LEVEL);
+    if (maxLevel == 0 || world.sizeX == 0 || world.numSectionsY == 0) {
+        return;
+    }
+    levels.reserve(maxLevel);
+    levels.emplace_back();
+    buildFirstLevel(world);
+    for (int32_t n = 2; n <= maxLevel; ++n) {
+        levels.emplace_back();
+        buildLevel(levels[n - 2], levels[n - 1]);
+    }
+}
+
+uint32_t VoxelLod::addBrick(Level& level, const uint16_t* cells) {
+    if (std::all_of(cells + 1, cells + BRICK_VOLUME, [cells](uint16_t state) { return state == cells[0]; })) {
+        return UNIFORM | cells[0];
+    }
+    uint32_t index = static_cast<uint32_t>(level.cells.size() / BRICK_VOLUME);
+    level.cells.insert(level.cells.end(), cells, cells + BRICK_VOLUME);
+    return index;
+}
+
+// One brick per section, only sections set in the view's masks are read
+void VoxelLod::buildFirstLevel(const VoxelWorldView& world) {
+    Level& level = levels[0];
+    level.cellBits = 1;
+    level.minBrick[0] = world.minChunkX;
+    level.minBrick[1] = world.minSectionY;
+    level.minBrick[2] = world.minChunkZ;
+    level.sizeInBricks[0] = world.sizeX;
+    level.sizeInBricks[1] = world.numSectionsY;
+    level.sizeInBricks[2] = world.sizeZ;
+    level.slots.assign(static_cast<size_t>(world.sizeX) * world.numSectionsY * world.sizeZ, UNIFORM | BlockStateRegistry::AIR);
+
+    uint16_t cells[BRICK_VOLUME];
+    uint16_t votes[8];
+    for (int32_t cz = 0; cz < world.sizeZ; ++cz) {
+        for (int32_t cx = 0; cx < world.sizeX; ++cx) {
+            uint32_t column = static_cast<uint32_t>(cz * world.sizeX + cx);
+            if (!((world.columnMask[column >> 6] >> (column & 63)) & 1)) {
+                continue;
+            }
+            for (int32_t cy = 0; cy < world.numSectionsY; ++cy) {
+                if (!((world.sectionMasks[column] >> cy) & 1)) {
+                    continue;
+                }
+                const VoxelSection& section = world.sections[world.sectionSlots[column * world.numSectionsY + cy]];
+                uint32_t& slot = level.slots[(static_cast<size_t>(cz) * world.numSectionsY + cy) * world.sizeX + cx];
+                if (section.bitsPerBlock == 0) {
+                    slot = UNIFORM | world.palettes[section.paletteOffset];
+                    continue;
+                }
+                for (int32_t y = 0; y < BRICK_SIZE; ++y) {
+                    for (int32_t z = 0; z < BRICK_SIZE; ++z) {
+                        for (int32_t x = 0; x < BRICK_SIZE; ++x) {
+                            for (int32_t i = 0; i < 8; ++i) {
+                                int32_t bx = x * 2 + (i & 1), by = y * 2 + (i >> 2), bz = z * 2 + ((i >> 1) & 1);
+                                votes[i] = voxel::sectionState(world, section, static_cast<uint32_t>((by * voxel::SECTION_EDGE + bz) * voxel::SECTION_EDGE + bx));
+                            }
+                            cells[cellIndex(x, y, z)] = majority(votes);
+                        }
+                    }
+                }
+                slot = addBrick(level, cells);
+            }
+        }
+    }
+}
+
+// Every brick of a level covers 2x2x2 bricks of the level below
+void VoxelLod::buildLevel(const Level& children, Level& level) {
+    level.cellBits = children.cellBits + 1;
+    for (int32_t i = 0; i < 3; ++i) {
+        level.minBrick[i] = children.minBrick[i] >> 1;
+        level.sizeInBricks[i] = ((children.minBrick[i] + children.sizeInBricks[i] - 1) >> 1) - level.minBrick[i] + 1;
+    }
+    level.slots.assign(static_cast<size_t>(level.sizeInBricks[0]) * level.sizeInBricks[1] * level.sizeInBricks[2], UNIFORM | BlockStateRegistry::AIR);
+
+    uint16_t cells[BRICK_VOLUME];
+    uint16_t votes[8];
+    uint32_t childSlots[8];
+    for (int32_t z = 0; z < level.sizeInBricks[2]; ++z) {
+        for (int32_t y = 0; y < level.sizeInBricks[1]; ++y) {
+            for (int32_t x = 0; x < level.sizeInBricks[0]; ++x) {
+                int32_t bx = level.minBrick[0] + x, by = level.minBrick[1] + y, bz = level.minBrick[2] + z;
+                bool uniform = true;
+                for (int32_t i = 0; i < 8; ++i) {
+                    childSlots[i] = children.slot(bx * 2 + (i & 1), by * 2 + (i >> 2), bz * 2 + ((i >> 1) & 1));
+                    uniform &= childSlots[i] == childSlots[0] && (childSlots[i] & UNIFORM);
+                }
+                uint32_t& slot = level.slots[(static_cast<size_t>(z) * level.sizeInBricks[1] + y) * level.sizeInBricks[0] + x];
+                if (uniform) {
+                    slot = childSlots[0];
+                    continue;
+                }
+
+                // Cell (cx, cy, cz) votes over child cells 2c to 2c + 1, which lie in child brick 2c >> 3
+                for (int32_t cy = 0; cy < BRICK_SIZE; ++cy) {
+                    for (int32_t cz = 0; cz < BRICK_SIZE; ++cz) {
+                        for (int32_t cx = 0; cx < BRICK_SIZE; ++cx) {
+                            for (int32_t i = 0; i < 8; ++i) {
+                                int32_t px = cx * 2 + (i & 1), py = cy * 2 + (i >> 2), pz = cz * 2 + ((i >> 1) & 1);
+                                int32_t child = ((py >> BRICK_BITS) << 2) | ((pz >> BRICK_BITS) << 1) | (px >> BRICK_BITS);
+                                uint32_t childSlot = childSlots[child];
+                                votes[i] = (childSlot & UNIFORM) ? static_cast<uint16_t>(childSlot & 0xFFFF) :
+                                    children.cells[static_cast<size_t>(childSlot) * BRICK_VOLUME + cellIndex(px & (BRICK_SIZE - 1), py & (BRICK_SIZE - 1), pz & (BRICK_SIZE - 1))];
+                            }
+                            cells[cellIndex(cx, cy, cz)] = majority(votes);
+                        }
+                    }
+                }
+                slot = addBrick(level, cells);
+            }
+        }
+    }
+}
+
+uint16_t VoxelLod::cell(int32_t n, int32_t x, int32_t y, int32_t z) const {
+    const Level& lod = level(n);
+    uint32_t slot = lod.slot(x >> BRICK_BITS, y >> BRICK_BITS, z >> BRICK_BITS);
+    if (slot & UNIFORM) {
+        return static_cast<uint16_t>(slot & 0xFFFF);
+    }
+    const int32_t mask = BRICK_SIZE - 1;
+    return lod.cells[static_cast<size_t>(slot) * BRICK_VOLUME + cellIndex(x & mask, y & mask, z & mask)];
+}
+
+// A cell of 2^n blocks at distance d covers 2^n * screenHeight / (2 d tan(fovY / 2)) pixels
+int32_t VoxelLod::levelFor(float distance, float fovY, uint32_t screenHeight, float maxPixelError) const {
+    if (distance <= 0.0f || screenHeight == 0) {
+        return 0;
+    }
+    float blocksPerPixel = 2.0f * distance * std::tan(fovY * 0.5f * 3.14159265f / 180.0f) / static_cast<float>(screenHeight);
+    float maxCellSize = maxPixelError * blocksPerPixel;
+    if (maxCellSize < 2.0f) {
+        return 0;
+    }
+    return std::min(static_cast<int32_t>(std::floor(std::log2(maxCellSize))), maxLevel());
+}
+
+int32_t VoxelLod::levelFor(const float eye[3], const float boxMin[3], const float boxMax[3],
+                           float fovY, uint32_t screenHeight, float maxPixelError) const {
+    float squared = 0.0f;
+    for (int32_t i = 0; i < 3; ++i) {
+        float d = std::max({ boxMin[i] - eye[i], 0.0f, eye[i] - boxMax[i] });
+        squared += d * d;
+    }
+    return levelFor(std::sqrt(squared), fovY, screenHeight, maxPixelError);
+}
+
+size_t VoxelLod::memoryUsage() const {
+    size_t bytes = levels.capacity() * sizeof(Level);
+    for (const Level& level : levels) {
+        bytes += level.slots.capacity() * sizeof(uint32_t) + level.cells.capacity() * sizeof(uint16_t);
+    }
+    return bytes;
+}
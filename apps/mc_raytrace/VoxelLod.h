@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "VoxelTraversal.h"
+
+// Coarser versions of a VoxelWorldView for far terrain. Cells of level n are 2^n blocks wide and
+// hold the majority vote of their eight children at level n - 1, level 0 is the view itself.
+// Every level is a brickmap: a dense grid of bricks of 8x8x8 cells over the bounds of the world,
+// where bricks of a single state (air included) take no space in the cell pool.
+// A level 1 brick covers exactly one section.
+class VoxelLod {
+	public:
+		static constexpr int32_t BRICK_BITS = 3;
+		static constexpr int32_t BRICK_SIZE = 1 << BRICK_BITS;
+		static constexpr int32_t BRICK_VOLUME = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+		// Brick slot flag, the low bits are the state of the whole brick. Without it the slot is a pool index.
+		static constexpr uint32_t UNIFORM = 0x80000000u;
+		static constexpr int32_t MAX_LEVEL = 8;
+
+		struct Level {
+			int32_t cellBits;            // cells are 1 << cellBits blocks wide
+			int32_t minBrick[3];         // brick coordinates of the first slot
+			int32_t sizeInBricks[3];
+			std::vector<uint32_t> slots; // index (z * sizeY + y) * sizeX + x
+			std::vector<uint16_t> cells; // BRICK_VOLUME per pooled brick, index (y * 8 + z) * 8 + x
+
+			uint32_t slot(int32_t bx, int32_t by, int32_t bz) const;
+		};
+
+		// Builds levels 1 to maxLevel, the view is only read during the build
+		void build(const VoxelWorldView& world, int32_t maxLevel = 4);
+
+		int32_t maxLevel() const { return static_cast<int32_t>(levels.size()); }
+		// Level 1 to maxLevel()
+		const Level& level(int32_t n) const { return levels[n - 1]; }
+		// State of a cell at level n >= 1, cell coordinates are block coordinates >> n
+		uint16_t cell(int32_t n, int32_t x, int32_t y, int32_t z) const;
+
+		// Coarsest level whose cells cover at most maxPixelError pixels at that distance, for a
+		// pinhole camera with a vertical field of view of fovY degrees over screenHeight pixels
+		int32_t levelFor(float distance, float fovY, uint32_t screenHeight, float maxPixelError) const;
+		// Same, for the point of a block box nearest to the eye
+		int32_t levelFor(const float eye[3], const float boxMin[3], const float boxMax[3],
+		                 float fovY, uint32_t screenHeight, float maxPixelError) const;
+
+		size_t memoryUsage() const;
+	private:
+		// Stores a brick of cells, as a single state when they are all the same
+		static uint32_t addBrick(Level& level, const uint16_t* cells);
+
+		void buildFirstLevel(const VoxelWorldView& world);
+		void buildLevel(const Level& children, Level& level);
+
+		std::vector<Level> levels;
+};
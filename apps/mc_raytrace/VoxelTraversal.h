@@ -0,0 +1,246 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+
+// Shared by host code and OptiX programs, keep this header free of std containers
+#ifndef HOSTDEVICE
+#ifdef __CUDACC__
+#define HOSTDEVICE __host__ __device__
+#else
+#define HOSTDEVICE
+#endif
+#endif
+
+// A section in palette packed form, same layout as Section
+struct VoxelSection {
+    uint32_t paletteOffset; // into VoxelWorldView::palettes
+    uint32_t dataOffset;    // into VoxelWorldView::words
+    uint32_t bitsPerBlock;  // 0 for uniform sections
+    uint32_t reserved;
+};
+
+// Flat view of a rectangle of chunk columns, built by VoxelWorld.
+// Three levels: a bit per column, a bit per non-empty section of a column, then the blocks.
+// Palettes only hold visible states, invisible ones are replaced by air.
+struct VoxelWorldView {
+    int32_t minChunkX, minChunkZ; // chunk coordinates of column 0
+    int32_t sizeX, sizeZ;         // columns
+    int32_t minSectionY;          // section y of bit 0 of a column's section mask
+    int32_t numSectionsY;         // at most 64
+
+    const uint64_t* columnMask;   // bit per column, index z * sizeX + x
+    const uint64_t* sectionMasks; // per column, bit per non-empty section
+    const uint32_t* sectionSlots; // per column * numSectionsY, index into sections where the mask bit is set
+    const VoxelSection* sections;
+    const uint16_t* palettes;
+    const uint64_t* words;
+};
+
+struct VoxelHit {
+    float t;
+    int32_t x, y, z;  // block coordinates
+    uint16_t state;   // global block state id
+    uint8_t face;     // FaceDirection of the face the ray entered through, 0 when it started inside the block
+};
+
+namespace voxel {
+    constexpr int32_t SECTION_BITS = 4;
+    constexpr int32_t SECTION_EDGE = 1 << SECTION_BITS;
+    constexpr float NO_HIT = 1e30f;
+
+    HOSTDEVICE inline int32_t floorDiv(int32_t a, int32_t shift) {
+        return a >> shift; // arithmetic shift floors negative values
+    }
+
+    HOSTDEVICE inline int32_t clampInt(int32_t v, int32_t lo, int32_t hi) {
+        return v < lo ? lo : (v > hi ? hi : v);
+    }
+
+    // Section of a column at section coordinates, nullptr when empty or out of range
+    HOSTDEVICE inline const VoxelSection* findSection(const VoxelWorldView& world, int32_t sx, int32_t sy, int32_t sz) {
+        int32_t cx = sx - world.minChunkX;
+        int32_t cz = sz - world.minChunkZ;
+        int32_t cy = sy - world.minSectionY;
+        if (cx < 0 || cz < 0 || cy < 0 || cx >= world.sizeX || cz >= world.sizeZ || cy >= world.numSectionsY) {
+            return nullptr;
+        }
+        uint32_t column = static_cast<uint32_t>(cz * world.sizeX + cx);
+        if (!((world.columnMask[column >> 6] >> (column & 63)) & 1)) {
+            return nullptr;
+        }
+        if (!((world.sectionMasks[column] >> cy) & 1)) {
+            return nullptr;
+        }
+        return &world.sections[world.sectionSlots[column * world.numSectionsY + cy]];
+    }
+
+    // Block inside a section, index = y * 256 + z * 16 + x
+    HOSTDEVICE inline uint16_t sectionState(const VoxelWorldView& world, const VoxelSection& section, uint32_t index) {
+        if (section.bitsPerBlock == 0) {
+            return world.palettes[section.paletteOffset];
+        }
+        uint32_t bit = index * section.bitsPerBlock;
+        uint32_t mask = (1u << section.bitsPerBlock) - 1;
+        uint32_t slot = static_cast<uint32_t>(world.words[section.dataOffset + (bit >> 6)] >> (bit & 63)) & mask;
+        return world.palettes[section.paletteOffset + slot];
+    }
+
+    HOSTDEVICE inline uint16_t blockState(const VoxelWorldView& world, int32_t x, int32_t y, int32_t z) {
+        const VoxelSection* section = findSection(world, floorDiv(x, SECTION_BITS), floorDiv(y, SECTION_BITS), floorDiv(z, SECTION_BITS));
+        if (!section) {
+            return 0;
+        }
+        uint32_t index = static_cast<uint32_t>((((y & 15) << 4) | (z & 15)) << 4 | (x & 15));
+        return sectionState(world, *section, index);
+    }
+
+    // Amanatides and Woo stepping state for one grid resolution
+    struct Dda {
+        int32_t cell[3];
+        int32_t step[3];
+        float tMax[3];
+        float tDelta[3];
+
+        // Cell of size 1 << shift containing the point at t, clamped to [lo, hi]
+        HOSTDEVICE void init(const float* origin, const float* direction, const float* invDirection, float t,
+                             int32_t shift, const int32_t* lo, const int32_t* hi) {
+            float size = static_cast<float>(1 << shift);
+            for (int32_t i = 0; i < 3; ++i) {
+                float p = origin[i] + direction[i] * t;
+                cell[i] = clampInt(static_cast<int32_t>(floorf(p / size)), lo[i], hi[i]);
+                if (direction[i] > 0.0f) {
+                    step[i] = 1;
+                    tMax[i] = ((cell[i] + 1) * size - origin[i]) * invDirection[i];
+                    tDelta[i] = size * invDirection[i];
+                }
+                else if (direction[i] < 0.0f) {
+                    step[i] = -1;
+                    tMax[i] = (cell[i] * size - origin[i]) * invDirection[i];
+                    tDelta[i] = -size * invDirection[i];
+                }
+                else {
+                    step[i] = 0;
+                    tMax[i] = NO_HIT;
+                    tDelta[i] = NO_HIT;
+                }
+            }
+        }
+
+        HOSTDEVICE int32_t nextAxis() const {
+            if (tMax[0] < tMax[1]) {
+                return tMax[0] < tMax[2] ? 0 : 2;
+            }
+            return tMax[1] < tMax[2] ? 1 : 2;
+        }
+    };
+
+    // Clips [tEnter, tExit] to the box covered by the cells lo to hi of size 1 << shift.
+    // enterAxis is the axis of the face the ray enters through, -1 when it starts inside.
+    HOSTDEVICE inline bool clipToCells(const float* origin, const float* direction, const float* invDirection,
+                                       int32_t shift, const int32_t* lo, const int32_t* hi,
+                                       float& tEnter, float& tExit, int32_t& enterAxis) {
+        enterAxis = -1;
+        for (int32_t i = 0; i < 3; ++i) {
+            float boxLo = static_cast<float>(lo[i] * (1 << shift));
+            float boxHi = static_cast<float>((hi[i] + 1) * (1 << shift));
+            if (direction[i] == 0.0f) {
+                if (origin[i] < boxLo || origin[i] >= boxHi) {
+                    return false;
+                }
+                continue;
+            }
+            float t0 = (boxLo - origin[i]) * invDirection[i];
+            float t1 = (boxHi - origin[i]) * invDirection[i];
+            if (t0 > t1) {
+                float swap = t0; t0 = t1; t1 = swap;
+            }
+            if (t0 > tEnter) {
+                tEnter = t0;
+                enterAxis = i;
+            }
+            tExit = t1 < tExit ? t1 : tExit;
+        }
+        return tEnter <= tExit;
+    }
+
+    HOSTDEVICE inline uint8_t entryFace(int32_t axis, int32_t step) {
+        // Moving towards +axis enters through the negative face
+        return static_cast<uint8_t>(axis * 2 + (step > 0 ? 0 : 1));
+    }
+}
+
+// First visible block along the ray within [tMin, tMax].
+// Walks sections first and skips empty columns and sections, only occupied sections are walked block by block.
+HOSTDEVICE inline bool traceVoxels(const VoxelWorldView& world, const float origin[3], const float direction[3],
+                                   float tMin, float tMax, VoxelHit& hit) {
+    using namespace voxel;
+
+    const int32_t lo[3] = { world.minChunkX, world.minSectionY, world.minChunkZ };
+    const int32_t hi[3] = { world.minChunkX + world.sizeX - 1, world.minSectionY + world.numSectionsY - 1, world.minChunkZ + world.sizeZ - 1 };
+
+    float invDirection[3];
+    for (int32_t i = 0; i < 3; ++i) {
+        invDirection[i] = direction[i] != 0.0f ? 1.0f / direction[i] : NO_HIT;
+    }
+
+    // Clip to the bounds of the grid
+    float tEnter = tMin;
+    float tExit = tMax;
+    int32_t enterAxis;
+    if (!clipToCells(origin, direction, invDirection, SECTION_BITS, lo, hi, tEnter, tExit, enterAxis)) {
+        return false;
+    }
+
+    Dda sections;
+    sections.init(origin, direction, invDirection, tEnter, SECTION_BITS, lo, hi);
+    int32_t axis = enterAxis;
+    float tCell = tEnter;
+
+    while (tCell <= tExit) {
+        float tCellExit = sections.tMax[sections.nextAxis()];
+        const VoxelSection* section = findSection(world, sections.cell[0], sections.cell[1], sections.cell[2]);
+        if (section) {
+            // Walk the blocks of this section between tCell and tCellExit
+            int32_t blockLo[3], blockHi[3];
+            for (int32_t i = 0; i < 3; ++i) {
+                blockLo[i] = sections.cell[i] * SECTION_EDGE;
+                blockHi[i] = blockLo[i] + SECTION_EDGE - 1;
+            }
+            Dda blocks;
+            blocks.init(origin, direction, invDirection, tCell, 0, blockLo, blockHi);
+            int32_t blockAxis = axis;
+            float tBlock = tCell;
+            float tEnd = tCellExit < tExit ? tCellExit : tExit;
+            while (tBlock <= tEnd) {
+                uint32_t index = static_cast<uint32_t>((((blocks.cell[1] & 15) << 4) | (blocks.cell[2] & 15)) << 4 | (blocks.cell[0] & 15));
+                uint16_t state = sectionState(world, *section, index);
+                if (state != 0) {
+                    hit.t = tBlock;
+                    hit.x = blocks.cell[0];
+                    hit.y = blocks.cell[1];
+                    hit.z = blocks.cell[2];
+                    hit.state = state;
+                    hit.face = blockAxis >= 0 ? entryFace(blockAxis, blocks.step[blockAxis]) : 0;
+                    return true;
+                }
+                blockAxis = blocks.nextAxis();
+                tBlock = blocks.tMax[blockAxis];
+                blocks.cell[blockAxis] += blocks.step[blockAxis];
+                if (blocks.cell[blockAxis] < blockLo[blockAxis] || blocks.cell[blockAxis] > blockHi[blockAxis]) {
+                    break;
+                }
+                blocks.tMax[blockAxis] += blocks.tDelta[blockAxis];
+            }
+        }
+
+        axis = sections.nextAxis();
+        tCell = sections.tMax[axis];
+        sections.cell[axis] += sections.step[axis];
+        if (sections.cell[axis] < lo[axis] || sections.cell[axis] > hi[axis]) {
+            break;
+        }
+        sections.tMax[axis] += sections.tDelta[axis];
+    }
+    return false;
+}
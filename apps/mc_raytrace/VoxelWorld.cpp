@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include "VoxelWorld.h"
+
+void VoxelWorld::build(const std::vector<std::shared_ptr<const Chunk>>& chunks) {
+    columnMask.clear();
+    sectionMasks.clear();
+    sectionSlots.clear();
+    sections.clear();
+    palettes.clear();
+    words.clear();
+    worldView = {};
+
+    int32_t minX = INT32_MAX, minZ = INT32_MAX, maxX = INT32_MIN, maxZ = INT32_MIN;
+    int32_t minY = INT32_MAX, maxY = INT32_MIN;
+    for (const std::shared_ptr<const Chunk>& chunk : chunks) {
+        minX = std::min(minX, chunk->pos.x);
+        maxX = std::max(maxX, chunk->pos.x);
+        minZ = std::min(minZ, chunk->pos.z);
+        maxZ = std::max(maxZ, chunk->pos.z);
+        size_t count = chunk->sectionCount();
+        if (count) {
+            minY = std::min(minY, chunk->sectionAt(0)->y);
+            maxY = std::max(maxY, chunk->sectionAt(count - 1)->y);
+        }
+    }
+    if (chunks.empty() || minY > maxY) {
+        return;
+    }
+    if (maxY - minY >= 64) {
+        std::cerr << "Voxel world is " << (maxY - minY + 1) << " sections tall, keeping the lowest 64" << std::endl;
+        maxY = minY + 63;
+    }
+
+    worldView.minChunkX = minX;
+    worldView.minChunkZ = minZ;
+    worldView.sizeX = maxX - minX + 1;
+    worldView.sizeZ = maxZ - minZ + 1;
+    worldView.minSectionY = minY;
+    worldView.numSectionsY = maxY - minY + 1;
+
+    size_t columns = static_cast<size_t>(worldView.sizeX) * worldView.sizeZ;
+    columnMask.assign((columns + 63) / 64, 0);
+    sectionMasks.assign(columns, 0);
+    sectionSlots.assign(columns * worldView.numSectionsY, 0);
+
+    for (const std::shared_ptr<const Chunk>& chunk : chunks) {
+        uint32_t column = static_cast<uint32_t>((chunk->pos.z - minZ) * worldView.sizeX + (chunk->pos.x - minX));
+        size_t count = chunk->sectionCount();
+        for (size_t i = 0; i < count; ++i) {
+            std::shared_ptr<const Section> section = chunk->sectionAt(i);
+            if (section->y <= maxY) {
+                addSection(column, section->y - minY, *section);
+            }
+        }
+        if (sectionMasks[column]) {
+            columnMask[column >> 6] |= uint64_t(1) << (column & 63);
+        }
+    }
+
+    worldView.columnMask = columnMask.data();
+    worldView.sectionMasks = sectionMasks.data();
+    worldView.sectionSlots = sectionSlots.data();
+    worldView.sections = sections.data();
+    worldView.palettes = palettes.data();
+    worldView.words = words.data();
+}
+
+void VoxelWorld::addSection(uint32_t column, int32_t slot, const Section& section) {
+    // Invisible states become air so traversal only has to test for id 0
+    bool visible = false;
+    size_t paletteOffset = palettes.size();
+    for (uint16_t state : section.palette) {
+        bool drawn = classifier.material(state) != BlockMaterial::Invisible;
+        palettes.push_back(drawn ? state : BlockStateRegistry::AIR);
+        visible |= drawn;
+    }
+    if (!visible) {
+        palettes.resize(paletteOffset);
+        return;
+    }
+
+    VoxelSection packed{};
+    packed.paletteOffset = static_cast<uint32_t>(paletteOffset);
+    packed.dataOffset = static_cast<uint32_t>(words.size());
+    packed.bitsPerBlock = section.bitsPerBlock;
+    words.insert(words.end(), section.data.begin(), section.data.end());
+
+    sectionSlots[column * worldView.numSectionsY + slot] = static_cast<uint32_t>(sections.size());
+    sections.push_back(packed);
+    sectionMasks[column] |= uint64_t(1) << slot;
+}
+
+size_t VoxelWorld::memoryUsage() const {
+    return columnMask.capacity() * sizeof(uint64_t) +
+        sectionMasks.capacity() * sizeof(uint64_t) +
+        sectionSlots.capacity() * sizeof(uint32_t) +
+        sections.capacity() * sizeof(VoxelSection) +
+        palettes.capacity() * sizeof(uint16_t) +
+        words.capacity() * sizeof(uint64_t);
+}
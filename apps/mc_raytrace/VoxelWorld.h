@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "ChunkMesher.h"
+#include "DataStructures.h"
+#include "VoxelTraversal.h"
+
+// Packs a set of chunks into the flat arrays behind a VoxelWorldView.
+// The view points into this object and is invalidated by the next build().
+class VoxelWorld {
+	public:
+		// Columns missing from chunks inside their bounding rectangle stay empty.
+		// Sections beyond 64 above the lowest one are dropped.
+		void build(const std::vector<std::shared_ptr<const Chunk>>& chunks);
+
+		const VoxelWorldView& view() const { return worldView; }
+		size_t memoryUsage() const;
+	private:
+		void addSection(uint32_t column, int32_t slot, const Section& section);
+
+		ChunkMesher classifier;
+		VoxelWorldView worldView{};
+
+		std::vector<uint64_t> columnMask;
+		std::vector<uint64_t> sectionMasks;
+		std::vector<uint32_t> sectionSlots;
+		std::vector<VoxelSection> sections;
+		std::vector<uint16_t> palettes;
+		std::vector<uint64_t> words;
+};
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include "WorldStore.h"
+
+WorldStore::WorldStore(size_t maxChunks, size_t memoryBudget)
+    : chunkLimit(std::max<size_t>(maxChunks, 1)), byteBudget(memoryBudget) {
+    chunks.reserve(chunkLimit);
+}
+
+void WorldStore::setMaxChunks(size_t maxChunks, std::vector<ChunkPos>* evicted) {
+    std::unique_lock lock(mutex);
+    chunkLimit = std::max<size_t>(maxChunks, 1);
+    chunks.reserve(chunkLimit);
+    evict(evicted);
+}
+
+size_t WorldStore::maxChunks() const {
+    std::shared_lock lock(mutex);
+    return chunkLimit;
+}
+
+void WorldStore::setMemoryBudget(size_t bytes, std::vector<ChunkPos>* evicted) {
+    std::unique_lock lock(mutex);
+    byteBudget = bytes;
+    evict(evicted);
+}
+
+size_t WorldStore::memoryBudget() const {
+    std::shared_lock lock(mutex);
+    return byteBudget;
+}
+
+void WorldStore::setEvictionPolicy(const EvictionPolicy& evictionPolicy) {
+    std::unique_lock lock(mutex);
+    policy = evictionPolicy;
+}
+
+void WorldStore::setViewer(double chunkX, double chunkZ) {
+    std::unique_lock lock(mutex);
+    viewerX = chunkX;
+    viewerZ = chunkZ;
+}
+
+// Replaces any resident chunk at the same position
+void WorldStore::insert(std::shared_ptr<const Chunk> chunk, std::vector<ChunkPos>* evicted) {
+    std::unique_lock lock(mutex);
+
+    ChunkPos pos = chunk->pos;
+    size_t bytes = chunk->memoryUsage();
+    auto it = chunks.find(pos);
+    if (it != chunks.end()) {
+        residentBytes -= it->second.bytes;
+        it->second.chunk = std::move(chunk);
+        it->second.bytes = bytes;
+        it->second.lastTouch.store(now(), std::memory_order_relaxed);
+    }
+    else {
+        chunks.try_emplace(pos, std::move(chunk), bytes, now());
+    }
+    residentBytes += bytes;
+
+    evict(evicted, &pos);
+}
+
+std::shared_ptr<const Chunk> WorldStore::find(ChunkPos pos) const {
+    std::shared_lock lock(mutex);
+    auto it = chunks.find(pos);
+    return it != chunks.end() ? it->second.chunk : nullptr;
+}
+
+void WorldStore::touch(ChunkPos pos) const {
+    std::shared_lock lock(mutex);
+    auto it = chunks.find(pos);
+    if (it != chunks.end()) {
+        it->second.lastTouch.store(now(), std::memory_order_relaxed);
+    }
+}
+
+void WorldStore::touch(const std::vector<ChunkPos>& positions) const {
+    uint64_t time = now();
+    std::shared_lock lock(mutex);
+    for (ChunkPos pos : positions) {
+        auto it = chunks.find(pos);
+        if (it != chunks.end()) {
+            it->second.lastTouch.store(time, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool WorldStore::erase(ChunkPos pos) {
+    std::unique_lock lock(mutex);
+    auto it = chunks.find(pos);
+    if (it == chunks.end()) {
+        return false;
+    }
+    residentBytes -= it->second.bytes;
+    chunks.erase(it);
+    return true;
+}
+
+void WorldStore::clear() {
+    std::unique_lock lock(mutex);
+    chunks.clear();
+    residentBytes = 0;
+}
+
+std::vector<ChunkPos> WorldStore::positions() const {
+    std::shared_lock lock(mutex);
+    std::vector<ChunkPos> result;
+    result.reserve(chunks.size());
+    for (const auto& [pos, entry] : chunks) {
+        result.push_back(pos);
+    }
+    return result;
+}
+
+size_t WorldStore::size() const {
+    std::shared_lock lock(mutex);
+    return chunks.size();
+}
+
+size_t WorldStore::memoryUsage() const {
+    std::shared_lock lock(mutex);
+    return residentBytes;
+}
+
+WorldStore::Stats WorldStore::stats() const {
+    std::shared_lock lock(mutex);
+    return { chunks.size(), residentBytes, chunkLimit, byteBudget, evictedChunks, evictedBytes };
+}
+
+uint64_t WorldStore::now() const {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+}
+
+// Drop the lowest ranked chunks until we are back under the limits, mutex must be held.
+// Goes a bit below the limits so a full store does not rank every chunk on every insert.
+void WorldStore::evict(std::vector<ChunkPos>* evicted, const ChunkPos* keep) {
+    if (chunks.size() <= chunkLimit && residentBytes <= byteBudget) {
+        return;
+    }
+
+    // Lazy chunks may have grown since they were inserted
+    residentBytes = 0;
+    for (auto& [pos, entry] : chunks) {
+        entry.bytes = entry.chunk->memoryUsage();
+        residentBytes += entry.bytes;
+    }
+
+    size_t targetChunks = chunks.size() > chunkLimit ? chunkLimit - chunkLimit / 16 : chunkLimit;
+    size_t targetBytes = residentBytes > byteBudget ? byteBudget - byteBudget / 8 : byteBudget;
+    if (chunks.size() <= targetChunks && residentBytes <= targetBytes) {
+        return;
+    }
+
+    uint64_t time = now();
+    std::vector<std::pair<double, ChunkPos>> ranked;
+    ranked.reserve(chunks.size());
+    for (const auto& [pos, entry] : chunks) {
+        if (keep && pos == *keep) {
+            continue;
+        }
+        uint64_t lastTouch = entry.lastTouch.load(std::memory_order_relaxed);
+        double seconds = time > lastTouch ? (time - lastTouch) / 1000.0 : 0.0;
+        double distance = std::hypot(pos.x - viewerX, pos.z - viewerZ);
+        ranked.emplace_back(policy.secondsWeight * seconds + policy.distanceWeight * distance, pos);
+    }
+    std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    for (const auto& [score, pos] : ranked) {
+        if (chunks.size() <= targetChunks && residentBytes <= targetBytes) {
+            break;
+        }
+        auto it = chunks.find(pos);
+        if (evicted) {
+            evicted->push_back(pos);
+        }
+        residentBytes -= it->second.bytes;
+        ++evictedChunks;
+        evictedBytes += it->second.bytes;
+        chunks.erase(it);
+    }
+}
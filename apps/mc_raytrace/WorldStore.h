@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+#include "DataStructures.h"
+
+// Resident chunk storage shared between the JNI threads and the renderer.
+// Lookups are O(1). Both the number of resident chunks and their memory are bounded, once
+// a limit is exceeded the chunks that were touched least recently and lie furthest from the
+// viewer are dropped first.
+class WorldStore {
+    public:
+        // How eviction ranks chunks, the highest score goes first.
+        // score = secondsWeight * seconds since last touch + distanceWeight * distance to the viewer in chunks
+        struct EvictionPolicy {
+            double secondsWeight = 1.0;
+            double distanceWeight = 1.0;
+        };
+
+        struct Stats {
+            size_t residentChunks;
+            size_t residentBytes;
+            size_t maxChunks;
+            size_t memoryBudget;
+            uint64_t evictedChunks; // since creation
+            uint64_t evictedBytes;
+        };
+
+        explicit WorldStore(size_t maxChunks = 4096, size_t memoryBudget = std::numeric_limits<size_t>::max());
+
+        // Chunks dropped to stay under the limits are appended to evicted when given
+        void setMaxChunks(size_t maxChunks, std::vector<ChunkPos>* evicted = nullptr);
+        size_t maxChunks() const;
+        void setMemoryBudget(size_t bytes, std::vector<ChunkPos>* evicted = nullptr);
+        size_t memoryBudget() const;
+        void setEvictionPolicy(const EvictionPolicy& policy);
+        // Viewer position in chunk coordinates
+        void setViewer(double chunkX, double chunkZ);
+
+        void insert(std::shared_ptr<const Chunk> chunk, std::vector<ChunkPos>* evicted = nullptr);
+        std::shared_ptr<const Chunk> find(ChunkPos pos) const;
+        // Mark a chunk as used, e.g. rendered this frame
+        void touch(ChunkPos pos) const;
+        // Same for a batch under one lock, e.g. every chunk drawn this frame
+        void touch(const std::vector<ChunkPos>& positions) const;
+        bool erase(ChunkPos pos);
+        void clear();
+
+        // Every resident chunk, for consumers that lost track of the change journal
+        std::vector<ChunkPos> positions() const;
+        size_t size() const;
+        size_t memoryUsage() const;
+        Stats stats() const;
+    private:
+        struct Entry {
+            Entry(std::shared_ptr<const Chunk> chunk, size_t bytes, uint64_t now)
+                : chunk(std::move(chunk)), bytes(bytes), lastTouch(now) {}
+
+            std::shared_ptr<const Chunk> chunk;
+            size_t bytes; // refreshed when evicting, lazy chunks grow as sections get decoded
+            mutable std::atomic<uint64_t> lastTouch; // milliseconds since creation of the store
+        };
+
+        uint64_t now() const;
+        void evict(std::vector<ChunkPos>* evicted, const ChunkPos* keep = nullptr);
+
+        mutable std::shared_mutex mutex;
+        std::unordered_map<ChunkPos, Entry, ChunkPosHash> chunks;
+        size_t chunkLimit;
+        size_t byteBudget;
+        size_t residentBytes = 0;
+        EvictionPolicy policy;
+        double viewerX = 0.0;
+        double viewerZ = 0.0;
+        uint64_t evictedChunks = 0;
+        uint64_t evictedBytes = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+};
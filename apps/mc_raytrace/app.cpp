@@ -1,5 +1,7 @@
 #include "app.h"
+#include <algorithm>
 #include <fstream>
+#include <limits>
 
 void App::initResultBufferOnDevice()
 {
@@ -29,6 +31,24 @@ void App::handleCameraUpdate()
     initResultBufferOnDevice();
 }
 
+void App::cullChunks()
+{
+    Vec3f U, V, W;
+    camera.UVWFrame(U, V, W);
+    const float eye[3] = { camera.origin().x(), camera.origin().y(), camera.origin().z() };
+    const float u[3] = { U.x(), U.y(), U.z() };
+    const float v[3] = { V.x(), V.y(), V.z() };
+    const float w[3] = { W.x(), W.y(), W.z() };
+    const vector<ChunkPos>& visible = _culler.cull(ViewFrustum::fromUVW(eye, u, v, w), eye);
+    // Eviction keeps what is on screen
+    if (_world)
+        _world->touch(visible);
+
+    // Mask 0 takes an instance out of every trace, the IAS update uploads the masks
+    for (auto& [pos, chunk_instance] : _chunks)
+        chunk_instance.instance->setVisibilityMask(_culler.isVisible(pos) ? 255u : 0u);
+}
+
 void App::initData(std::vector<Object> objects)
 {
     
@@ -36,7 +56,426 @@ void App::initData(std::vector<Object> objects)
 
 void App::updateData()
 {
+    if (!_world)
+        return;
+
+    // Every frame, so the journal never fills up during normal play
+    _changes.clear();
+    if (_world->drainChanges(_changes))
+    {
+        // Events were lost, compare everything we have with everything that is resident
+        for (ChunkPos pos : _world->worldStore().positions())
+            _dirty_chunks.insert(pos);
+        for (const auto& [pos, chunk_instance] : _chunks)
+            _dirty_chunks.insert(pos);
+    }
+    _changed_sections.clear();
+    for (const ChangeEvent& change : _changes)
+    {
+        ChunkPos pos = { change.pos.x, change.pos.z };
+        if (change.type == ChangeEvent::Type::SectionChanged)
+            _changed_sections[pos].insert(change.pos.y);
+        else
+            // Faces on the border of a chunk depend on its neighbours, they go along
+            markDirty(pos, true);
+    }
+
+    buildDirtyChunks();
+    remeshChangedSections();
+
+    if (!_dirty_sbt_offsets.empty())
+    {
+        updateHitgroupRecords();
+        _dirty_sbt_offsets.clear();
+    }
+    if (_ias_dirty)
+    {
+        rebuildInstanceAccel();
+        _ias_dirty = false;
+    }
+}
+
+// Offset to the neighbouring section, by FaceDirection
+static constexpr int32_t FACE_OFFSETS[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+
+// Ranges stay in place when sections are re-meshed, empty ones still get a box
+static vector<int32_t> sectionYs(const ChunkMesh& chunk_mesh)
+{
+    vector<int32_t> section_ys;
+    for (const ChunkMesh::SectionRange& range : chunk_mesh.sections)
+        section_ys.push_back(range.y);
+    return section_ys;
+}
+
+// Vertices [first, first + count) of a chunk mesh
+static void convertChunkVertices(const ChunkMesh& chunk_mesh, uint32_t first, uint32_t count, vector<Vec3f>& vertices, vector<Vec2f>& texcoords)
+{
+    vertices.reserve(vertices.size() + count);
+    texcoords.reserve(texcoords.size() + count);
+    for (uint32_t v = first; v < first + count; ++v)
+    {
+        const auto& p = chunk_mesh.positions[v];
+        const auto& uv = chunk_mesh.texcoords[v];
+        vertices.emplace_back(p[0], p[1], p[2]);
+        texcoords.emplace_back(uv[0], uv[1]);
+    }
+}
+
+// Faces and per face SBT indices of triangles [first, first + count) of a chunk mesh, normals are
+// the six axis normals. The local SBT index of a face is its material's record, see CHUNK_MATERIALS.
+static void convertChunkFaces(const ChunkMesh& chunk_mesh, uint32_t first, uint32_t count, ChunkMesher& classifier,
+    vector<Face>& faces, vector<uint32_t>& sbt_indices)
+{
+    faces.reserve(faces.size() + count);
+    sbt_indices.reserve(sbt_indices.size() + count);
+    for (uint32_t t = first; t < first + count; ++t)
+    {
+        const auto& tri = chunk_mesh.triangles[t];
+        Vec3i vertex_id(static_cast<int32_t>(tri[0]), static_cast<int32_t>(tri[1]), static_cast<int32_t>(tri[2]));
+        faces.push_back(Face{ vertex_id, Vec3i(static_cast<int32_t>(chunk_mesh.directions[t])), vertex_id });
+
+        // Padding triangles are never hit, any record does
+        BlockMaterial material = classifier.material(chunk_mesh.states[t]);
+        sbt_indices.push_back(material == BlockMaterial::Invisible ? 0 : static_cast<uint32_t>(material) - 1);
+    }
+}
+
+// Chunk mesh to a single TriangleMesh. One inactive triangle per material follows the section
+// ranges so every record of the chunk is referenced whatever the sections are re-meshed to.
+static shared_ptr<TriangleMesh> createChunkMesh(const ChunkMesh& chunk_mesh, ChunkMesher& classifier, uint32_t num_materials, vector<uint32_t>& sbt_indices)
+{
+    vector<Vec3f> vertices;
+    vector<Vec2f> texcoords;
+    vector<Vec3f> normals;
+    vector<Face> faces;
+
+    convertChunkVertices(chunk_mesh, 0, static_cast<uint32_t>(chunk_mesh.positions.size()), vertices, texcoords);
+    convertChunkFaces(chunk_mesh, 0, static_cast<uint32_t>(chunk_mesh.triangles.size()), classifier, faces, sbt_indices);
+    for (int32_t d = 0; d < 6; ++d)
+    {
+        auto n = ChunkMesh::normal(static_cast<FaceDirection>(d));
+        normals.emplace_back(n[0], n[1], n[2]);
+    }
+
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    int32_t anchor = static_cast<int32_t>(vertices.size());
+    vertices.emplace_back(nan, nan, nan);
+    texcoords.emplace_back(0.0f, 0.0f);
+    for (uint32_t m = 0; m < num_materials; ++m)
+    {
+        faces.push_back(Face{ Vec3i(anchor), Vec3i(0), Vec3i(anchor) });
+        sbt_indices.push_back(m);
+    }
+
+    return make_shared<TriangleMesh>(vertices, faces, normals, texcoords, sbt_indices);
+}
+
+bool App::remeshSection(const Chunk& chunk, const ChunkMesher::Neighbours& neighbours, int32_t section_y)
+{
+    auto it = _chunks.find(chunk.pos);
+    const Section* section = chunk.section(section_y);
+    if (it == _chunks.end() || !section)
+        return false;
+    ChunkInstance& chunk_instance = it->second;
+
+    ChunkMesher::captureBorders(chunk, section_y, neighbours, _section_borders);
+    int32_t index = _mesher.remeshSection(*section, _section_borders, chunk_instance.mesh);
+    if (index < 0)
+        return false;
+    const ChunkMesh::SectionRange& range = chunk_instance.mesh.sections[index];
+
+    vector<Vec3f> vertices;
+    vector<Vec2f> texcoords;
+    vector<Face> faces;
+    vector<uint32_t> sbt_indices;
+    convertChunkFaces(chunk_instance.mesh, range.firstTriangle, range.triangleCapacity, _mesher, faces, sbt_indices);
+    convertChunkVertices(chunk_instance.mesh, range.firstVertex, range.vertexCapacity, vertices, texcoords);
+
+    // Upload the range of the section only, counts never change so the device buffers stay in place
+    TriangleMesh& mesh = *chunk_instance.triangles;
+    CUDA_CHECK(cudaMemcpy(
+        reinterpret_cast<Vec3f*>(mesh.deviceVertices()) + range.firstVertex,
+        vertices.data(), vertices.size() * sizeof(Vec3f),
+        cudaMemcpyHostToDevice
+    ));
+    CUDA_CHECK(cudaMemcpy(
+        reinterpret_cast<Vec2f*>(mesh.deivceTexcoords()) + range.firstVertex,
+        texcoords.data(), texcoords.size() * sizeof(Vec2f),
+        cudaMemcpyHostToDevice
+    ));
+    CUDA_CHECK(cudaMemcpy(
+        reinterpret_cast<Face*>(mesh.deviceFaces()) + range.firstTriangle,
+        faces.data(), faces.size() * sizeof(Face),
+        cudaMemcpyHostToDevice
+    ));
+
+    // The build input re-uploads SBT indices from the host copy, a refit keeps the old ones
+    // so a different material layout needs a rebuild of the GAS
+    auto sbt_range = chunk_instance.sbt_indices.begin() + range.firstTriangle;
+    bool same_materials = std::equal(sbt_indices.begin(), sbt_indices.end(), sbt_range);
+    std::copy(sbt_indices.begin(), sbt_indices.end(), sbt_range);
+    mesh.setSbtIndices(chunk_instance.sbt_indices);
+    if (same_materials)
+        chunk_instance.instance->updateAccel(context, stream);
+    else
+        chunk_instance.instance->buildAccel(context, stream);
+    return true;
+}
+
+void App::setChunkInstance(ChunkMesh mesh, std::shared_ptr<const Chunk> chunk)
+{
+    const ChunkPos pos = mesh.pos;
+    if (mesh.empty())
+    {
+        removeChunkInstance(pos);
+        return;
+    }
+
+    ChunkInstance chunk_instance;
+    auto it = _chunks.find(pos);
+    if (it != _chunks.end())
+    {
+        // Replaced, the GPU is idle between frames so the old buffers can go right away
+        chunk_instance.sbt_offset = it->second.sbt_offset;
+        it->second.instance->free();
+        it->second.triangles->free();
+    }
+    else if (!_free_sbt_offsets.empty())
+    {
+        chunk_instance.sbt_offset = _free_sbt_offsets.back();
+        _free_sbt_offsets.pop_back();
+    }
+    else
+    {
+        // Placeholders, filled in below
+        chunk_instance.sbt_offset = sbt.numHitgroupRecords();
+        for (uint32_t m = 0; m < CHUNK_MATERIALS; ++m)
+            sbt.addHitgroupRecord({ HitgroupRecord{}, HitgroupRecord{} });
+    }
+
+    // Room to re-mesh sections in place, see remeshSection
+    chunk_instance.chunk = std::move(chunk);
+    chunk_instance.mesh = std::move(mesh);
+    chunk_instance.mesh.addSlack(0.25f, 16);
+    shared_ptr<TriangleMesh> chunk_mesh = createChunkMesh(chunk_instance.mesh, _mesher, CHUNK_MATERIALS, chunk_instance.sbt_indices);
+    chunk_mesh->copyToDevice();
+
+    for (uint32_t m = 0; m < CHUNK_MATERIALS; ++m)
+    {
+        const shared_ptr<Material>& material = _block_materials[m + 1];
+
+        HitgroupRecord record;
+        _chunk_prg.recordPackHeader(&record);
+        HitgroupData record_data =
+        {
+            .shape_data = chunk_mesh->devicePtr(),
+            .surface_info =
+              {
+                  .data = material->devicePtr(),
+                  .callable_id = material->surfaceCallableID(),
+                  .type = material->surfaceType()
+              },
+        };
+        record.data = record_data;
+
+        HitgroupRecord shadow_record;
+        _chunk_shadow_prg.recordPackHeader(&shadow_record);
+        shadow_record.data = record_data;
+
+        sbt.replaceHitgroupRecord(record, static_cast<int>(chunk_instance.sbt_offset + m * SBT::NRay));
+        sbt.replaceHitgroupRecord(shadow_record, static_cast<int>(chunk_instance.sbt_offset + m * SBT::NRay + 1));
+    }
+
+    auto instance = std::make_shared<ShapeInstance>(
+        ShapeType::Mesh,
+        chunk_mesh,
+        Matrix4f::translate(Vec3f(static_cast<float>(pos.x * SECTION_SIZE), 0.0f, static_cast<float>(pos.z * SECTION_SIZE)))
+        );
+    instance->allowCompaction();
+    instance->allowUpdate();
+    instance->allowRandomVertexAccess();
+    instance->setSBTOffset(chunk_instance.sbt_offset);
+    instance->setId(_next_instance_id++);
+    instance->buildAccel(context, stream);
+
+    _culler.setChunk(pos, sectionYs(chunk_instance.mesh), chunk_instance.chunk.get());
+
+    chunk_instance.triangles = chunk_mesh;
+    chunk_instance.instance = instance;
+    _dirty_sbt_offsets.push_back(chunk_instance.sbt_offset);
+    _chunks[pos] = std::move(chunk_instance);
+    _ias_dirty = true;
+}
+
+void App::updateHitgroupRecords()
+{
+    OptixShaderBindingTable& table = sbt.sbt();
+    const uint32_t count = sbt.numHitgroupRecords();
+    if (count > _hitgroup_capacity)
+    {
+        // Doubles so streaming chunks in reallocates rarely. The last launch has finished, nothing
+        // refers to the previous buffer any more.
+        uint32_t capacity = std::max(count, _hitgroup_capacity * 2);
+        CUDABuffer<HitgroupRecord> records;
+        records.allocate(capacity * sizeof(HitgroupRecord));
+        CUDA_CHECK(cudaMemcpy(
+            reinterpret_cast<void*>(records.devicePtr()),
+            &sbt.hitgroupRecord(0), count * sizeof(HitgroupRecord),
+            cudaMemcpyHostToDevice
+        ));
+        // The buffer of createOnDevice belongs to the SBT, only ours are freed
+        _d_hitgroup_records.free();
+        _d_hitgroup_records = records;
+        _hitgroup_capacity = capacity;
+        table.hitgroupRecordBase = _d_hitgroup_records.devicePtr();
+    }
+    else
+    {
+        // Only the record blocks of chunks replaced this frame
+        for (uint32_t offset : _dirty_sbt_offsets)
+        {
+            CUDA_CHECK(cudaMemcpy(
+                reinterpret_cast<void*>(table.hitgroupRecordBase + offset * sizeof(HitgroupRecord)),
+                &sbt.hitgroupRecord(static_cast<int>(offset)), CHUNK_MATERIALS * SBT::NRay * sizeof(HitgroupRecord),
+                cudaMemcpyHostToDevice
+            ));
+        }
+    }
+    table.hitgroupRecordCount = count;
+}
+
+void App::removeChunkInstance(ChunkPos pos)
+{
+    auto it = _chunks.find(pos);
+    if (it == _chunks.end())
+        return;
+    it->second.instance->free();
+    it->second.triangles->free();
+    _free_sbt_offsets.push_back(it->second.sbt_offset);
+    _chunks.erase(it);
+    _culler.removeChunk(pos);
+    _ias_dirty = true;
+}
+
+void App::markDirty(ChunkPos pos, bool with_neighbours)
+{
+    _dirty_chunks.insert(pos);
+    if (with_neighbours)
+    {
+        _dirty_chunks.insert({ pos.x - 1, pos.z });
+        _dirty_chunks.insert({ pos.x + 1, pos.z });
+        _dirty_chunks.insert({ pos.x, pos.z - 1 });
+        _dirty_chunks.insert({ pos.x, pos.z + 1 });
+    }
+}
+
+void App::buildDirtyChunks()
+{
+    WorldStore& store = _world->worldStore();
+    vector<shared_ptr<const Chunk>> built;
+    for (auto it = _dirty_chunks.begin(); it != _dirty_chunks.end() && built.size() < MAX_CHUNK_BUILDS_PER_FRAME;)
+    {
+        ChunkPos pos = *it;
+        it = _dirty_chunks.erase(it);
+        shared_ptr<const Chunk> chunk = store.find(pos);
+        if (!chunk)
+        {
+            removeChunkInstance(pos);
+            continue;
+        }
+        _parallel_mesher->add(chunk,
+            store.find({ pos.x - 1, pos.z }), store.find({ pos.x + 1, pos.z }),
+            store.find({ pos.x, pos.z - 1 }), store.find({ pos.x, pos.z + 1 }));
+        built.push_back(std::move(chunk));
+    }
+    if (built.empty())
+        return;
 
+    _parallel_mesher->finish(_built_meshes);
+    for (size_t i = 0; i < built.size(); ++i)
+    {
+        setChunkInstance(std::move(_built_meshes[i]), built[i]);
+    }
+}
+
+// Re-mesh a section of a chunk on the GPU from its resident version, a full mesh of the chunk
+// is queued when that fails
+void App::remeshResidentSection(ChunkPos pos, int32_t section_y)
+{
+    if (_dirty_chunks.count(pos))
+        return;
+    WorldStore& store = _world->worldStore();
+    shared_ptr<const Chunk> chunk = store.find(pos);
+    if (!chunk)
+        return; // the unload event takes care of it
+    shared_ptr<const Chunk> neg_x = store.find({ pos.x - 1, pos.z }), pos_x = store.find({ pos.x + 1, pos.z });
+    shared_ptr<const Chunk> neg_z = store.find({ pos.x, pos.z - 1 }), pos_z = store.find({ pos.x, pos.z + 1 });
+    ChunkMesher::Neighbours neighbours = { neg_x.get(), pos_x.get(), neg_z.get(), pos_z.get() };
+    if (!remeshSection(*chunk, neighbours, section_y))
+        markDirty(pos, false);
+}
+
+void App::remeshChangedSections()
+{
+    WorldStore& store = _world->worldStore();
+    for (const auto& [pos, section_ys] : _changed_sections)
+    {
+        // Chunks that are rebuilt or not on the GPU yet get a full mesh
+        shared_ptr<const Chunk> chunk = store.find(pos);
+        if (!chunk || _dirty_chunks.count(pos))
+            continue;
+        auto it = _chunks.find(pos);
+        if (it == _chunks.end())
+        {
+            markDirty(pos, false);
+            continue;
+        }
+
+        // Compared with the version the GPU copy was last brought up to
+        shared_ptr<const Chunk> before = it->second.chunk;
+        for (int32_t y : section_ys)
+        {
+            const Section* old_section = before ? before->section(y) : nullptr;
+            const Section* new_section = chunk->section(y);
+            if (old_section == new_section)
+                continue;
+            uint8_t borders = old_section && new_section ? ChunkMesher::changedBorders(*old_section, *new_section) : 0x3F;
+
+            remeshResidentSection(pos, y);
+            for (int32_t d = 0; d < 6; ++d)
+            {
+                if (!(borders & (1 << d)))
+                    continue;
+                const int32_t* offset = FACE_OFFSETS[d];
+                ChunkPos next = { pos.x + offset[0], pos.z + offset[2] };
+                // Neighbours that are not on the GPU or missing sections (air) have no faces to fix
+                shared_ptr<const Chunk> next_chunk = store.find(next);
+                if (_chunks.count(next) && next_chunk && next_chunk->section(y + offset[1]))
+                    remeshResidentSection(next, y + offset[1]);
+            }
+        }
+
+        // Full meshes queued above replace the instance anyway
+        it = _chunks.find(pos);
+        if (it != _chunks.end() && !_dirty_chunks.count(pos))
+        {
+            it->second.chunk = chunk;
+            _culler.setChunk(pos, sectionYs(it->second.mesh), chunk.get());
+        }
+    }
+}
+
+void App::rebuildInstanceAccel()
+{
+    ias.free();
+    ias = InstanceAccel{ InstanceAccel::Type::Instances };
+    ias.allowUpdate();
+    for (const auto& instance : _mesh)
+        ias.addInstance(*instance);
+    for (const auto& [pos, chunk_instance] : _chunks)
+        ias.addInstance(*chunk_instance.instance);
+    ias.build(context, stream);
+    params.handle = ias.handle();
 }
 
 // ------------------------------------------------------------------
@@ -133,7 +572,6 @@ void App::setup()
 
     uint32_t sbt_offset = 0;
     uint32_t sbt_idx = 0;
-    uint32_t instance_id = 0;
 
     // ShapeInstance Shape ShapeInstance Lambda
     auto setupPrimitive = [&](ProgramGroup hitgroup_prg, ProgramGroup& shadow_prg, const Primitive& primitive)
@@ -168,19 +606,16 @@ void App::setup()
         primitive.instance->allowUpdate();
         primitive.instance->allowRandomVertexAccess();
         primitive.instance->setSBTOffset(sbt_offset);
-        primitive.instance->setId(instance_id);
+        primitive.instance->setId(_next_instance_id++);
         primitive.instance->buildAccel(context, stream);
 
         ias.addInstance(*primitive.instance);
 
-        instance_id++;
         sbt_offset += SBT::NRay;
     };
 
     auto mesh_prg = pipeline.createHitgroupProgram(context, module, "__closesthit__mesh");
     auto mesh_shadow_prg = pipeline.createHitgroupProgram(context, module, "__closesthit__shadow_mesh");
-    auto block_prg = pipeline.createHitgroupProgram(context, module, "__closesthit__block", "__intersection__block");
-    auto block_shadow_prg = pipeline.createHitgroupProgram(context, module, "__closesthit__block", "__intersection__block");
 
     cudaTextureDesc tex_desc = {};
     tex_desc.addressMode[0] = cudaAddressModeWrap;
@@ -192,6 +627,21 @@ void App::setup()
     auto white = make_shared<ConstantTexture>(Vec3f(1.0f), constant_prg_id);
     Vec3f black(0.f, 0.f, 0.f);
 
+    // Chunk materials, shared by every chunk and indexed by BlockMaterial
+    _chunk_prg = mesh_prg;
+    _chunk_shadow_prg = mesh_shadow_prg;
+    vector<shared_ptr<Material>>& block_materials = _block_materials;
+    block_materials.assign(static_cast<size_t>(BlockMaterial::Count), nullptr);
+    block_materials[static_cast<size_t>(BlockMaterial::Opaque)] = make_shared<Diffuse>(diffuse_id, make_shared<ConstantTexture>(Vec3f(0.6f), constant_prg_id));
+    block_materials[static_cast<size_t>(BlockMaterial::Cutout)] = make_shared<Diffuse>(diffuse_id, make_shared<ConstantTexture>(Vec3f(0.3f, 0.55f, 0.25f), constant_prg_id));
+    block_materials[static_cast<size_t>(BlockMaterial::Glass)] = make_shared<Dielectric>(refraction_id, white, 1.5f);
+    block_materials[static_cast<size_t>(BlockMaterial::Water)] = make_shared<Dielectric>(refraction_id, make_shared<ConstantTexture>(Vec3f(0.6f, 0.8f, 1.0f), constant_prg_id), 1.33f);
+    for (auto& material : block_materials)
+    {
+        if (material)
+            material->copyToDevice();
+    }
+
     for (size_t i = 0; i < objects.size(); ++i)
     {
         if (objects[i].objectType == ObjectType::eMesh)
@@ -277,33 +727,30 @@ void App::setup()
             setupPrimitive(mesh_prg, mesh_shadow_prg, primitive);
         }
 
-        // eBlock type, temporary ?
-        else if (objects[i].objectType == ObjectType::eBlock)
+        // Chunk column, one GAS per chunk, every face picks its material through a per face SBT index
+        else if (objects[i].objectType == ObjectType::eChunk)
         {
-            Primitive primitive;
-
-            // Geometry
-            shared_ptr<Box> block(new Box());
-            vector<Attributes> material_attributes;
-
-            _mesh_pos.push_back(objects[i].position);
-            _mesh_scale.push_back(objects[i].scale);
-            primitive.instance = std::make_shared<ShapeInstance>(
-                ShapeType::Mesh,
-                block,
-                Matrix4f::translate(objects[i].position) * Matrix4f::scale(objects[i].scale) //TODO add rotations as well
-                );
-            _mesh.push_back(primitive.instance);
-    
-            // dafault material
-            primitive.material = make_shared<Diffuse>(diffuse_id, white);
-
-            setupPrimitive(block_prg, block_shadow_prg, primitive);
+            setChunkInstance(*objects[i].chunkMesh, objects[i].chunk);
+            sbt_idx = sbt_offset = sbt.numHitgroupRecords();
         }
     }
+    for (const auto& [pos, chunk_instance] : _chunks)
+        ias.addInstance(*chunk_instance.instance);
+    _ias_dirty = false;
+    _dirty_sbt_offsets.clear();
+
+    // Resident chunks arrive through the change journal, the first frame picks up what is already there
+    if (_world)
+    {
+        _mesh_pool = std::make_unique<TaskPool>();
+        _parallel_mesher = std::make_unique<ParallelMesher>(*_mesh_pool);
+        for (ChunkPos pos : _world->worldStore().positions())
+            _dirty_chunks.insert(pos);
+    }
 
     // Shader Binding Table 
     sbt.createOnDevice();
+    _hitgroup_capacity = sbt.numHitgroupRecords();
     // TraversableHandle
     ias.build(context, stream);
     params.handle = ias.handle();
@@ -329,6 +776,7 @@ void App::update()
     updateData();
 
     handleCameraUpdate();
+    cullChunks();
 
     float time = pgGetElapsedTimef();
 
@@ -374,6 +822,10 @@ void App::draw()
 
     ImGui::Text("Frame rate: %.3f ms/frame (%.2f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 
+    const ChunkCuller::Stats& cull_stats = _culler.stats();
+    ImGui::Text("Chunks visible: %zu / %zu", cull_stats.visibleChunks, cull_stats.chunks);
+    ImGui::Text("Sections culled: %zu frustum, %zu horizon of %zu", cull_stats.frustumCulled, cull_stats.horizonCulled, cull_stats.sections);
+
     ImGui::End();
     ImGui::Render();
 
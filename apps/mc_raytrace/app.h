@@ -2,7 +2,16 @@
 
 #include <prayground/prayground.h>
 
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include "params.h"
+#include "ChunkCulling.h"
+#include "ChunkMesher.h"
+#include "DataManager.h"
+#include "ParallelMesher.h"
+#include "TaskPool.h"
 // ImGui
 #include <prayground/ext/imgui/imgui.h>
 #include <prayground/ext/imgui/imgui_impl_glfw.h>
@@ -20,13 +29,19 @@ using SBT = ShaderBindingTable<RaygenRecord, MissRecord, HitgroupRecord, EmptyRe
 class App : public BaseApp
 {
 public:
-    App() {}
+    // Resident chunks of world are kept on the GPU, its change journal is drained every frame.
+    // Without a world only the objects given to initData are drawn.
+    explicit App(DataManager* world = nullptr) : _world(world) {}
     void setup();
     void update();
     void draw();
     void close();
     Vec3f rotateByQuaternion(Vec3f& v, Vec4f& r);
 
+    // Re-mesh one section of a chunk that is already on the GPU, upload only its range and refit the GAS.
+    // Returns false when the section outgrew its range, the chunk has to be rebuilt then.
+    bool remeshSection(const Chunk& chunk, const ChunkMesher::Neighbours& neighbours, int32_t section_y);
+
     //void mousePressed(float x, float y, int button);
     //void mouseDragged(float x, float y, int button);
     //void mouseReleased(float x, float y, int button);
@@ -39,19 +54,54 @@ private:
 
     enum class ObjectType : int {
         eMesh = 0,
-        eBlock = 1,
+        eChunk = 1,
     };
     struct Object {
         ObjectType objectType;
         Vec3f position, scale;
         Vec4f rotation;
         std::string objectFileName;
+        std::shared_ptr<const ChunkMesh> chunkMesh; // eChunk only
+        std::shared_ptr<const Chunk> chunk;         // eChunk only, blocks for horizon culling
+    };
+
+    // Every chunk has one hitgroup record per visible BlockMaterial, in enum order starting at
+    // Opaque, so re-meshing never changes the SBT layout
+    static constexpr uint32_t CHUNK_MATERIALS = static_cast<uint32_t>(BlockMaterial::Count) - 1;
+    // Full chunk meshes per frame, the rest waits for the next frames
+    static constexpr size_t MAX_CHUNK_BUILDS_PER_FRAME = 64;
+
+    // A chunk on the GPU, sections are patched in place by remeshSection
+    struct ChunkInstance {
+        std::shared_ptr<const Chunk> chunk; // version the mesh was built from, null for initData chunks
+        ChunkMesh mesh; // with slack, see ChunkMesh::addSlack
+        std::shared_ptr<TriangleMesh> triangles;
+        std::shared_ptr<ShapeInstance> instance;
+        uint32_t sbt_offset;               // first of CHUNK_MATERIALS * SBT::NRay hitgroup records
+        std::vector<uint32_t> sbt_indices; // per face, host copy of what the GAS was built with
     };
 
     void initResultBufferOnDevice();
     void handleCameraUpdate();
+    // Switches chunk instances that can not be seen off for the next launch
+    void cullChunks();
     void initData(std::vector<Object> objects);
+    // Drains the world's change journal and brings the chunk instances up to date
     void updateData();
+    // Meshes up to MAX_CHUNK_BUILDS_PER_FRAME dirty chunks from the world and replaces their instances
+    void buildDirtyChunks();
+    // Creates or replaces the instance of a chunk, mesh comes without slack. Empty meshes drop the instance.
+    void setChunkInstance(ChunkMesh mesh, std::shared_ptr<const Chunk> chunk);
+    void removeChunkInstance(ChunkPos pos);
+    // Uploads the record blocks in _dirty_sbt_offsets, everything when the records outgrew the buffer
+    void updateHitgroupRecords();
+    void markDirty(ChunkPos pos, bool with_neighbours);
+    // Sections edited since the last frame are re-meshed in place together with the neighbouring
+    // sections whose border faces changed, see ChunkMesher::changedBorders
+    void remeshChangedSections();
+    void remeshResidentSection(ChunkPos pos, int32_t section_y);
+    // Instances are added and replaced at runtime, the IAS is rebuilt from scratch then
+    void rebuildInstanceAccel();
 
     LaunchParams params;
     CUDABuffer<LaunchParams> d_params;
@@ -69,4 +119,28 @@ private:
     std::vector<std::shared_ptr<ShapeInstance>> _mesh;
     std::vector<float3> _mesh_pos;
     std::vector<float3> _mesh_scale;
+
+    // Chunk hitgroups, set up once in setup() and reused for every chunk instance
+    ProgramGroup _chunk_prg;
+    ProgramGroup _chunk_shadow_prg;
+    std::vector<std::shared_ptr<Material>> _block_materials; // by BlockMaterial
+    std::vector<uint32_t> _free_sbt_offsets; // record blocks of removed chunks
+    uint32_t _next_instance_id = 0;
+    bool _ias_dirty = false;
+    std::vector<uint32_t> _dirty_sbt_offsets; // record blocks replaced since the last upload
+    CUDABuffer<HitgroupRecord> _d_hitgroup_records; // once the records outgrow the buffer of createOnDevice
+    uint32_t _hitgroup_capacity = 0; // records the current device buffer holds
+
+    DataManager* _world;
+    std::vector<ChangeEvent> _changes;
+    std::unordered_set<ChunkPos, ChunkPosHash> _dirty_chunks;
+    std::unordered_map<ChunkPos, std::set<int32_t>, ChunkPosHash> _changed_sections;
+    std::unique_ptr<TaskPool> _mesh_pool;
+    std::unique_ptr<ParallelMesher> _parallel_mesher;
+    std::vector<ChunkMesh> _built_meshes;
+
+    std::unordered_map<ChunkPos, ChunkInstance, ChunkPosHash> _chunks;
+    ChunkMesher _mesher;
+    SectionBorders _section_borders;
+    ChunkCuller _culler;
 };
\ No newline at end of file
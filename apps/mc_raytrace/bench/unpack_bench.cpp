@@ -0,0 +1,97 @@
+// Compares whole section unpacking against per voxel enkiGetChunkSectionVoxelData lookups
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "../UnpackBits.h"
+#include "../enkimi.h"
+
+static std::vector<uint8_t> makeLongs(uint32_t bits, uint32_t count, std::vector<uint16_t>& expected) {
+    std::mt19937 rng(bits * 7919 + count);
+    uint32_t perLong = 64 / bits;
+    std::vector<uint8_t> bytes(packedLongCount(bits, count) * 8);
+    expected.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        expected[i] = static_cast<uint16_t>(rng() & ((1u << bits) - 1));
+    }
+    for (size_t w = 0; w * 8 < bytes.size(); ++w) {
+        uint64_t word = 0;
+        for (uint32_t e = 0; e < perLong && w * perLong + e < count; ++e) {
+            word |= uint64_t(expected[w * perLong + e]) << (e * bits);
+        }
+        for (int b = 0; b < 8; ++b) {
+            bytes[w * 8 + b] = static_cast<uint8_t>(word >> (56 - 8 * b));
+        }
+    }
+    return bytes;
+}
+
+template <typename F>
+static double nanosPerRun(int runs, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; ++i) {
+        f();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / runs;
+}
+
+int main() {
+    const int runs = 2000;
+    const uint32_t sectionVolume = 4096;
+    UnpackPath paths[] = { UnpackPath::Scalar, UnpackPath::SSE41, UnpackPath::AVX2 };
+    int numPaths = static_cast<int>(bestUnpackPath()) + 1;
+    std::vector<uint16_t> out(sectionVolume);
+    bool ok = true;
+
+    std::printf("best path: %s\n", unpackPathName(bestUnpackPath()));
+    std::printf("%5s %5s %12s", "bits", "count", "enkiMI ns");
+    for (int p = 0; p < numPaths; ++p) {
+        std::printf(" %10s ns", unpackPathName(paths[p]));
+    }
+    std::printf("\n");
+
+    for (uint32_t count : { sectionVolume, 64u }) {
+        for (uint32_t bits = count == 64 ? 1 : 4; bits <= (count == 64 ? 6u : 15u); ++bits) {
+            std::vector<uint16_t> expected;
+            std::vector<uint8_t> longs = makeLongs(bits, count, expected);
+
+            double enkiNanos = 0.0;
+            if (count == sectionVolume) {
+                std::vector<int32_t> defaultBlockIndex(size_t(1) << bits, -1);
+                enkiChunkBlockData chunk = {};
+                chunk.dataVersion = 3465;
+                chunk.params.flags = enkiNBTReadChunkExFlags_NoPaletteTranslation;
+                chunk.sections[0] = longs.data();
+                chunk.palette[0].size = 1u << bits;
+                chunk.palette[0].numBitsPerBlock = bits;
+                chunk.palette[0].blockArraySize = static_cast<uint32_t>(longs.size() / 8);
+                chunk.palette[0].pDefaultBlockIndex = defaultBlockIndex.data();
+                enkiNanos = nanosPerRun(runs / 10, [&] {
+                    for (int32_t y = 0; y < 16; ++y)
+                        for (int32_t z = 0; z < 16; ++z)
+                            for (int32_t x = 0; x < 16; ++x) {
+                                out[(y * 16 + z) * 16 + x] = static_cast<uint16_t>(enkiGetChunkSectionVoxelData(&chunk, 0, { x, y, z }).paletteIndex);
+                            }
+                });
+                ok = ok && out == expected;
+            }
+
+            std::printf("%5u %5u %12.0f", bits, count, enkiNanos);
+            for (int p = 0; p < numPaths; ++p) {
+                std::fill(out.begin(), out.end(), 0xFFFF);
+                unpackBits(paths[p], longs.data(), bits, count, out.data());
+                ok = ok && std::equal(expected.begin(), expected.end(), out.begin());
+                double nanos = nanosPerRun(runs, [&] { unpackBits(paths[p], longs.data(), bits, count, out.data()); });
+                std::printf(" %13.0f", nanos);
+            }
+            std::printf("\n");
+        }
+    }
+
+    if (!ok) {
+        std::printf("MISMATCH\n");
+        return 1;
+    }
+    return 0;
+}
@@ -47,20 +47,100 @@ JNIEXPORT void JNICALL Java_com_example_OptixRenderer_updateData
 JNIEXPORT void JNICALL Java_com_example_OptixRenderer_loadChunk
   (JNIEnv *, jobject, jbyteArray, jint);
 
+/*
+ * Class:     com_example_OptixRenderer
+ * Method:    loadChunkAt
+ * Signature: (II[BI)V
+ */
+JNIEXPORT void JNICALL Java_com_example_OptixRenderer_loadChunkAt
+  (JNIEnv *, jobject, jint, jint, jbyteArray, jint);
+
+/*
+ * Class:     com_example_OptixRenderer
+ * Method:    openChunkCache
+ * Signature: (Ljava/lang/String;)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_example_OptixRenderer_openChunkCache
+  (JNIEnv *, jobject, jstring);
+
+/*
+ * Class:     com_example_OptixRenderer
+ * Method:    loadCachedChunk
+ * Signature: (II)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_example_OptixRenderer_loadCachedChunk
+  (JNIEnv *, jobject, jint, jint);
+
+/*
+ * Class:     com_example_OptixRenderer
+ * Method:    loadChunkDirect
+ * Signature: (Ljava/nio/ByteBuffer;IJ)V
+ */
+JNIEXPORT void JNICALL Java_com_example_OptixRenderer_loadChunkDirect
+  (JNIEnv *, jobject, jobject, jint, jlong);
+
+/*
+ * Class:     com_example_OptixRenderer
+ * Method:    updateDataDirect
+ * Signature: (Ljava/nio/ByteBuffer;I)V
+ */
+JNIEXPORT void JNICALL Java_com_example_OptixRenderer_updateDataDirect
+  (JNIEnv *, jobject, jobject, jint);
+
+/*
+ * Class:     com_example_OptixRenderer
+ * Method:    pollReleasedBuffers
+ * Signature: ()[J
+ */
+JNIEXPORT jlongArray JNICALL Java_com_example_OptixRenderer_pollReleasedBuffers
+  (JNIEnv *, jobject);
+
 /*
  * Class:     com_example_OptixRenderer
  * Method:    unloadChunk
- * Signature: ()V
+ * Signature: (II)V
  */
 JNIEXPORT void JNICALL Java_com_example_OptixRenderer_unloadChunk
-  (JNIEnv *, jobject);
+  (JNIEnv *, jobject, jint, jint);
 
 /*
  * Class:     com_example_OptixRenderer
  * Method:    updateChunk
- * Signature: ()V
+ * Signature: ([BI)V
  */
 JNIEXPORT void JNICALL Java_com_example_OptixRenderer_updateChunk
+  (JNIEnv *, jobject, jbyteArray, jint);
+
+/*
+ * Class:     com_example_OptixRenderer
+ * Method:    setMemoryBudget
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_example_OptixRenderer_setMemoryBudget
+  (JNIEnv *, jobject, jlong);
+
+/*
+ * Class:     com_example_OptixRenderer
+ * Method:    setCameraPosition
+ * Signature: (DDD)V
+ */
+JNIEXPORT void JNICALL Java_com_example_OptixRenderer_setCameraPosition
+  (JNIEnv *, jobject, jdouble, jdouble, jdouble);
+
+/*
+ * Class:     com_example_OptixRenderer
+ * Method:    setCameraRotation
+ * Signature: (FFFF)V
+ */
+JNIEXPORT void JNICALL Java_com_example_OptixRenderer_setCameraRotation
+  (JNIEnv *, jobject, jfloat, jfloat, jfloat, jfloat);
+
+/*
+ * Class:     com_example_OptixRenderer
+ * Method:    getMemoryStats
+ * Signature: ()[J
+ */
+JNIEXPORT jlongArray JNICALL Java_com_example_OptixRenderer_getMemoryStats
   (JNIEnv *, jobject);
 
 /*
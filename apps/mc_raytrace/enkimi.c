@@ -17,6 +17,8 @@
  * 2. Altered source versions must be plainly marked as such, and must not be
  *    misrepresented as being the original software.
  * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Altered for mc_raytrace: pluggable stream allocators (enkiNBTAllocator).
  */
 
 #include "enkimi.h"
@@ -27,6 +29,36 @@
 // Add allocation pAllocation_ to stream, which will be freed using enkiNBTFreeAllocations
 void enkiNBTAddAllocation( enkiNBTDataStream* pStream_, void* pAllocation_ );
 
+static void* AllocWith( const enkiNBTAllocator* pAllocator_, size_t size_ )
+{
+	if( pAllocator_ )
+	{
+		return pAllocator_->pAlloc( pAllocator_->pUserData, size_ );
+	}
+	return malloc( size_ );
+}
+
+static void FreeWith( const enkiNBTAllocator* pAllocator_, void* pAllocation_ )
+{
+	if( pAllocator_ )
+	{
+		if( pAllocator_->pFree )
+		{
+			pAllocator_->pFree( pAllocator_->pUserData, pAllocation_ );
+		}
+		return;
+	}
+	free( pAllocation_ );
+}
+
+// Allocate memory owned by the stream, freed by enkiNBTFreeAllocations
+static void* enkiNBTAlloc( enkiNBTDataStream* pStream_, size_t size_ )
+{
+	void* pAllocation = AllocWith( pStream_->pAllocator, size_ );
+	enkiNBTAddAllocation( pStream_, pAllocation );
+	return pAllocation;
+}
+
 static const uint32_t SECTOR_SIZE = 4096;
 
 static const char* tagIdString[] =
@@ -1543,10 +1575,24 @@ void enkiNBTInitFromMemoryUncompressed( enkiNBTDataStream* pStream_, uint8_t * p
 	pStream_->pNextTag = pStream_->pCurrPos;
 	pStream_->level = -1;
 	pStream_->pAllocations = NULL;
+	pStream_->pAllocator = NULL;
+}
+
+void enkiNBTSetAllocator( enkiNBTDataStream* pStream_, const enkiNBTAllocator* pAllocator_ )
+{
+	assert( NULL == pStream_->pAllocations );
+	pStream_->pAllocator = pAllocator_;
 }
 
 int enkiNBTInitFromMemoryCompressed( enkiNBTDataStream* pStream_, uint8_t * pCompressedData_,
 										uint32_t compressedDataSize_, uint32_t uncompressedSizeHint_)
+{
+	return enkiNBTInitFromMemoryCompressedEx( pStream_, pCompressedData_, compressedDataSize_, uncompressedSizeHint_, NULL );
+}
+
+int enkiNBTInitFromMemoryCompressedEx( enkiNBTDataStream* pStream_, uint8_t * pCompressedData_,
+										uint32_t compressedDataSize_, uint32_t uncompressedSizeHint_,
+										const enkiNBTAllocator* pAllocator_ )
 {
 	// check if gzip style first:  https://tools.ietf.org/html/rfc1952#section-2.2
 	static const uint32_t GZIP_HEADER_SIZE = 10;
@@ -1564,7 +1610,7 @@ int enkiNBTInitFromMemoryCompressed( enkiNBTDataStream* pStream_, uint8_t * pCom
 
 		int32_t ISIZE = *(int32_t*)(pCompressedData_ + compressedDataSize_ - 4);
 		assert(ISIZE > 0);
-		uint8_t* gzUncompressedData = (uint8_t*)malloc( (size_t)ISIZE );
+		uint8_t* gzUncompressedData = (uint8_t*)AllocWith( pAllocator_, (size_t)ISIZE );
 
 		// uncompress gzip
 		mz_stream stream;
@@ -1595,12 +1641,13 @@ int enkiNBTInitFromMemoryCompressed( enkiNBTDataStream* pStream_, uint8_t * pCom
 			if( status == MZ_OK )
 			{
 				enkiNBTInitFromMemoryUncompressed( pStream_, gzUncompressedData, ( uint32_t )stream.total_out );
+				enkiNBTSetAllocator( pStream_, pAllocator_ );
 				enkiNBTAddAllocation( pStream_, gzUncompressedData );
 				return 1;
 			}
 			else
 			{
-				free( gzUncompressedData );
+				FreeWith( pAllocator_, gzUncompressedData );
 			}
 		}
 	}
@@ -1612,35 +1659,44 @@ int enkiNBTInitFromMemoryCompressed( enkiNBTDataStream* pStream_, uint8_t * pCom
 		destLength = compressedDataSize_ * 4 + 1024; // estimate uncompressed size
 	}
 	mz_ulong startDestLength = destLength;
-	uint8_t* dataUnCompressed = (uint8_t*)malloc( destLength );
+	uint8_t* dataUnCompressed = (uint8_t*)AllocWith( pAllocator_, destLength );
 	int retval = uncompress( dataUnCompressed, &destLength, pCompressedData_, compressedDataSize_ );
 	if( retval == MZ_BUF_ERROR && startDestLength == destLength )
 	{
 		// failed to uncompress, buffer full
 		for( int attempts = 0; ( retval != MZ_OK ) && ( attempts < 3 ); ++attempts )
 		{
-			free( dataUnCompressed );
+			FreeWith( pAllocator_, dataUnCompressed );
 			destLength *= 4 + 1024;
-			dataUnCompressed = (uint8_t*)malloc( destLength );
+			dataUnCompressed = (uint8_t*)AllocWith( pAllocator_, destLength );
 			retval = uncompress( dataUnCompressed, &destLength, pCompressedData_, compressedDataSize_ );
 		}
 	}
 	if( retval != MZ_OK )
 	{
 		enkiNBTInitFromMemoryUncompressed( pStream_, NULL, 0 );
-		free( dataUnCompressed );
+		FreeWith( pAllocator_, dataUnCompressed );
 		return 0;
 	}
 
-	dataUnCompressed = (uint8_t*)realloc( dataUnCompressed, destLength ); // reallocate to actual size
+	if( NULL == pAllocator_ )
+	{
+		dataUnCompressed = (uint8_t*)realloc( dataUnCompressed, destLength ); // reallocate to actual size
+	}
 	enkiNBTInitFromMemoryUncompressed( pStream_, dataUnCompressed, ( uint32_t )destLength );
+	enkiNBTSetAllocator( pStream_, pAllocator_ );
 	enkiNBTAddAllocation( pStream_, dataUnCompressed );
 	return 1;
 }
 
 void enkiNBTAddAllocation( enkiNBTDataStream* pStream_, void* pAllocation_ )
 {
-	enkiNBTAllocation* pAlloc = (enkiNBTAllocation*)malloc(sizeof(enkiNBTAllocation));
+	const enkiNBTAllocator* pAllocator = pStream_->pAllocator;
+	if( pAllocator && NULL == pAllocator->pFree )
+	{
+		return; // released all at once by the owner of the allocator
+	}
+	enkiNBTAllocation* pAlloc = (enkiNBTAllocation*)AllocWith( pAllocator, sizeof(enkiNBTAllocation) );
 	pAlloc->pAllocation = pAllocation_;
 	pAlloc->pNext = pStream_->pAllocations;
 	pStream_->pAllocations = pAlloc;
@@ -1652,9 +1708,9 @@ void enkiNBTFreeAllocations( enkiNBTDataStream* pStream_ )
 	while( pNext )
 	{
 		enkiNBTAllocation* pCurr = pNext;
-		free( pCurr->pAllocation );
+		FreeWith( pStream_->pAllocator, pCurr->pAllocation );
 		pNext = pCurr->pNext;
-		free( pCurr );
+		FreeWith( pStream_->pAllocator, pCurr );
 	}
 	memset( pStream_, 0, sizeof(enkiNBTDataStream) );
 }
@@ -2040,13 +2096,10 @@ static void LoadChunkPalette( enkiNBTDataStream* pStream_, enkiChunkSectionPalet
 	uint32_t numBits = (uint32_t)numBitsFloat;
 	pSectionPalette_->numBitsPerBlock = numBits;
 
-	pSectionPalette_->pDefaultBlockIndex = (int32_t*)malloc(sizeof(int32_t)*pSectionPalette_->size);
-	enkiNBTAddAllocation( pStream_, pSectionPalette_->pDefaultBlockIndex );
-	pSectionPalette_->pNamespaceIDStrings = (enkiNBTString*)malloc(sizeof(enkiNBTString)*pSectionPalette_->size);
-	enkiNBTAddAllocation( pStream_, pSectionPalette_->pNamespaceIDStrings );
-	pSectionPalette_->pBlockStateProperties = (enkiMIProperties*)malloc(sizeof(enkiMIProperties)*pSectionPalette_->size);
+	pSectionPalette_->pDefaultBlockIndex = (int32_t*)enkiNBTAlloc( pStream_, sizeof(int32_t)*pSectionPalette_->size );
+	pSectionPalette_->pNamespaceIDStrings = (enkiNBTString*)enkiNBTAlloc( pStream_, sizeof(enkiNBTString)*pSectionPalette_->size );
+	pSectionPalette_->pBlockStateProperties = (enkiMIProperties*)enkiNBTAlloc( pStream_, sizeof(enkiMIProperties)*pSectionPalette_->size );
 	memset( pSectionPalette_->pBlockStateProperties, 0, sizeof(enkiMIProperties)*pSectionPalette_->size );
-	enkiNBTAddAllocation( pStream_, pSectionPalette_->pBlockStateProperties );
 
 	// read palettes
 	int levelPalette = pStream_->level;
@@ -2110,6 +2163,28 @@ static void LoadChunkPalette( enkiNBTDataStream* pStream_, enkiChunkSectionPalet
 	}
 }
 
+static void LoadChunkHeightmaps( enkiNBTDataStream* pStream_, enkiChunkBlockData* pChunk_ )
+{
+	static const char* names[ enkiMIHeightmap_Count ] = { "MOTION_BLOCKING", "WORLD_SURFACE" };
+	int32_t levelHeightmaps = pStream_->level;
+	while( enkiNBTReadNextTag( pStream_ ) && pStream_->level > levelHeightmaps )
+	{
+		if( enkiNBTTAG_Long_Array != pStream_->currentTag.tagId )
+		{
+			continue;
+		}
+		for( int32_t type = 0; type < enkiMIHeightmap_Count; ++type )
+		{
+			if( NULL == pChunk_->heightmaps[ type ] && enkiAreStringsEqual( names[ type ], pStream_->currentTag.pName ) )
+			{
+				pChunk_->heightmapsArraySize[ type ] = enkiNBTReadInt32( pStream_ ); // read number of items to advance pCurrPos to start of array
+				pChunk_->heightmaps[ type ] = pStream_->pCurrPos;
+				break;
+			}
+		}
+	}
+}
+
 enkiNBTReadChunkExParams enkiGetDefaultNBTReadChunkExParams()
 {
 	enkiNBTReadChunkExParams params;
@@ -2156,8 +2231,15 @@ enkiChunkBlockData enkiNBTReadChunkEx( enkiNBTDataStream * pStream_, enkiNBTRead
 		}
 		else if( enkiNBTTAG_Int == pStream_->currentTag.tagId && enkiAreStringsEqual( "yPos", pStream_->currentTag.pName ) )
 		{
-			// yPos appears to indicate smallest y index, currently do not use
+			// yPos appears to indicate smallest y index
 			yPos = enkiNBTReadInt32( pStream_ );
+			chunk.yPos = yPos;
+		}
+		else if( params_.flags & enkiNBTReadChunkExFlags_LoadHeightmaps &&
+		         enkiNBTTAG_Compound == pStream_->currentTag.tagId && enkiAreStringsEqual( "Heightmaps", pStream_->currentTag.pName ) )
+		{
+			// In data version 2844+ Heightmaps is at level 0
+			LoadChunkHeightmaps( pStream_, &chunk );
 		}
 		else if( enkiNBTTAG_List == pStream_->currentTag.tagId && 0 == foundSections && enkiAreStringsEqual( "sections", pStream_->currentTag.pName ) )
 		{
@@ -2211,8 +2293,7 @@ enkiChunkBlockData enkiNBTReadChunkEx( enkiNBTDataStream * pStream_, enkiNBTRead
                                 float numBitsFloat = floorf( 1.0f + log2f( (float)( sectionPalette.numBiomes - 1 ) ) );
 	                            sectionPalette.numBitsPerBiome = (uint32_t)numBitsFloat;
 
-                                sectionPalette.pBiomes = (enkiNBTString*)malloc(sizeof(enkiNBTString)*sectionPalette.numBiomes);
-	                            enkiNBTAddAllocation( pStream_, sectionPalette.pBiomes );
+                                sectionPalette.pBiomes = (enkiNBTString*)enkiNBTAlloc( pStream_, sizeof(enkiNBTString)*sectionPalette.numBiomes );
                                 for( uint32_t listItem = 0; listItem < sectionPalette.numBiomes; ++listItem )
                                 {
                                     // assert( pStream_->currentTag.listCurrItem > 0 );
@@ -2276,6 +2357,11 @@ enkiChunkBlockData enkiNBTReadChunkEx( enkiNBTDataStream * pStream_, enkiNBTRead
 					foundZPos = 1;
 					chunk.zPos = enkiNBTReadInt32( pStream_ );
 				}
+				else if( params_.flags & enkiNBTReadChunkExFlags_LoadHeightmaps &&
+				         enkiNBTTAG_Compound == pStream_->currentTag.tagId && enkiAreStringsEqual( "Heightmaps", pStream_->currentTag.pName ) )
+				{
+					LoadChunkHeightmaps( pStream_, &chunk );
+				}
 				else if( enkiNBTTAG_List == pStream_->currentTag.tagId && 0 == foundSections && enkiAreStringsEqual( "Sections", pStream_->currentTag.pName ) )
 				{
 					foundSections = 1;
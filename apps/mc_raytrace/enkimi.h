@@ -16,6 +16,8 @@
  * 2. Altered source versions must be plainly marked as such, and must not be
  *    misrepresented as being the original software.
  * 3. This notice may not be removed or altered from any source distribution.
+ *
+ * Altered for mc_raytrace: pluggable stream allocators (enkiNBTAllocator).
  */
 #pragma once
 
@@ -76,6 +78,16 @@ typedef struct enkiNBTAllocation_s
 	struct enkiNBTAllocation_s* pNext;
 } enkiNBTAllocation;
 
+// Allocator used for all memory a stream allocates.
+// If pFree is NULL allocations are never freed individually and are not tracked,
+// which suits arena allocators that are reset once the stream and chunk are no longer needed.
+typedef struct enkiNBTAllocator_s
+{
+	void* (*pAlloc)( void* pUserData_, size_t size_ );
+	void  (*pFree)( void* pUserData_, void* pAllocation_ );
+	void* pUserData;
+} enkiNBTAllocator;
+
 typedef struct enkiNBTDataStream_s
 {
 	enkiNBTTagHeader parentTags[ 512 ];
@@ -85,6 +97,7 @@ typedef struct enkiNBTDataStream_s
 	uint8_t* pData;
 	uint8_t* pNextTag;
 	enkiNBTAllocation* pAllocations;
+	const enkiNBTAllocator* pAllocator; // NULL uses malloc and free
 	uint32_t dataLength;
 	int32_t  level;
 } enkiNBTDataStream;
@@ -109,6 +122,16 @@ void enkiNBTInitFromMemoryUncompressed( enkiNBTDataStream* pStream_, uint8_t* pU
 int enkiNBTInitFromMemoryCompressed( enkiNBTDataStream* pStream_, uint8_t* pCompressedData_,
 									    uint32_t compressedDataSize_, uint32_t uncompressedSizeHint_ );
 
+// As enkiNBTInitFromMemoryCompressed but all stream allocations use pAllocator_.
+// pAllocator_ must remain valid until enkiNBTFreeAllocations() has been called.
+int enkiNBTInitFromMemoryCompressedEx( enkiNBTDataStream* pStream_, uint8_t* pCompressedData_,
+									    uint32_t compressedDataSize_, uint32_t uncompressedSizeHint_,
+									    const enkiNBTAllocator* pAllocator_ );
+
+// Set the allocator of a stream initialized with enkiNBTInitFromMemoryUncompressed.
+// Must be called before anything is read from the stream.
+void enkiNBTSetAllocator( enkiNBTDataStream* pStream_, const enkiNBTAllocator* pAllocator_ );
+
 
 // returns 0 if no next tag, 1 if there was
 int enkiNBTReadNextTag( enkiNBTDataStream* pStream_ );
@@ -192,8 +215,17 @@ typedef enum
 	enkiNBTReadChunkExFlags_None = 0,
 	enkiNBTReadChunkExFlags_NoPaletteTranslation = 1 << 0, // when loading palette do not translate namespace strings to blockID & dataValue - faster if you want to do your own translation / conversion to internal data
 	enkiNBTReadChunkExFlags_LoadBiomes           = 1 << 1,
+	enkiNBTReadChunkExFlags_LoadHeightmaps       = 1 << 2, // keep the MOTION_BLOCKING and WORLD_SURFACE long arrays of the Heightmaps tag
 } enkiNBTReadChunkExFlags;
 
+// Heightmaps kept with enkiNBTReadChunkExFlags_LoadHeightmaps
+typedef enum
+{
+	enkiMIHeightmap_MotionBlocking = 0,
+	enkiMIHeightmap_WorldSurface,
+	enkiMIHeightmap_Count,
+} enkiMIHeightmapType;
+
 typedef struct enkiNBTReadChunkExParams_s
 {
 	int32_t flags; // enkiNBTReadChunkExFlags defaults to enkiNBTReadChunkExFlags_None
@@ -240,6 +272,11 @@ typedef struct enkiChunkBlockData_s
 	int32_t zPos; // section coordinates
 	int32_t countOfSections;
 	int32_t dataVersion;
+	int32_t yPos; // lowest section y from data version 2844, 0 before
+	// Raw big endian long arrays, NULL if the chunk has no such heightmap. Entries are the y above the
+	// highest matching block relative to yPos * 16, packed like block states of the same data version.
+	uint8_t* heightmaps[ enkiMIHeightmap_Count ];
+	int32_t heightmapsArraySize[ enkiMIHeightmap_Count ]; // number of longs
     enkiNBTReadChunkExParams params;
 } enkiChunkBlockData;
 
@@ -1,5 +1,6 @@
 ﻿#include <prayground/prayground.h>
 #include "params.h"
+#include "VoxelTraversal.h"
 
 extern "C" __constant__ LaunchParams params;
 
@@ -190,14 +191,44 @@ extern "C" __device__ void __closesthit__shadow_mesh() // for shadow rays
 // -------------------------------------------------------------------------------------------------
 // Blocks
 
+// Custom primitive covering a whole VoxelWorldView, shape_data points to the view in device memory
 extern "C" __device__ void __intersection__block()
 {
-    
+    const HitgroupData* data = reinterpret_cast<HitgroupData*>(optixGetSbtDataPointer());
+    const auto* world = reinterpret_cast<const VoxelWorldView*>(data->shape_data);
+
+    const Ray ray = getLocalRay();
+    const float origin[3] = { ray.o.x(), ray.o.y(), ray.o.z() };
+    const float direction[3] = { ray.d.x(), ray.d.y(), ray.d.z() };
+
+    VoxelHit hit;
+    if (traceVoxels(*world, origin, direction, ray.tmin, ray.tmax, hit))
+        optixReportIntersection(hit.t, 0, hit.face, hit.state);
 }
 
 extern "C" __device__ void __closesthit__block()
 {
+    HitgroupData* data = reinterpret_cast<HitgroupData*>(optixGetSbtDataPointer());
 
+    SurfaceInteraction* si = getSurfaceInteraction();
+
+    Ray ray = getWorldRay();
+
+    // FaceDirection: axis * 2 + positive
+    const uint32_t face = optixGetAttribute_0();
+    Vec3f local_n(0.0f);
+    local_n[face >> 1] = (face & 1) ? 1.0f : -1.0f;
+    Vec3f world_n = normalize(optixTransformNormalFromObjectToWorldSpace(local_n));
+
+    // Tile the texture once per block on the two axes of the face
+    const Vec3f local_p = getLocalRay().at(ray.tmax);
+    const uint32_t u_axis = ((face >> 1) + 1) % 3;
+    const uint32_t v_axis = ((face >> 1) + 2) % 3;
+
+    si->p = ray.at(ray.tmax);
+    si->n = faceforward(world_n, -ray.d, world_n);
+    si->uv = Vec2f(local_p[u_axis] - floorf(local_p[u_axis]), local_p[v_axis] - floorf(local_p[v_axis]));
+    si->surface_info = data->surface_info;
 }
 
 // Diffuse
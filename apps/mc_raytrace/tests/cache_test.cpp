@@ -0,0 +1,219 @@
+// Writes chunks with ChunkCacheWriter and compares what ChunkCache loads back with the originals,
+// including replaced duplicates and records damaged after baking
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "../BlockStateRegistry.h"
+#include "../ChunkCache.h"
+
+// Random blocks drawn from the first paletteSize states, so every packing width shows up
+static std::shared_ptr<const Section> randomSection(int32_t y, const std::vector<uint16_t>& states, size_t paletteSize, std::mt19937& rng) {
+    uint16_t blocks[SECTION_VOLUME];
+    for (uint16_t& block : blocks) {
+        block = states[rng() % paletteSize];
+    }
+    return Section::pack(y, blocks);
+}
+
+static bool sameBlocks(const Chunk& a, const Chunk& b) {
+    if (a.pos.x != b.pos.x || a.pos.z != b.pos.z || a.dataVersion != b.dataVersion || a.sectionCount() != b.sectionCount()) {
+        return false;
+    }
+    uint16_t expected[SECTION_VOLUME], loaded[SECTION_VOLUME];
+    for (size_t i = 0; i < a.sectionCount(); ++i) {
+        if (a.sectionAt(i)->y != b.sectionAt(i)->y) {
+            return false;
+        }
+        a.sectionAt(i)->unpack(expected);
+        b.sectionAt(i)->unpack(loaded);
+        if (std::memcmp(expected, loaded, sizeof(expected)) != 0) {
+            return false;
+        }
+    }
+    for (size_t type = 0; type < static_cast<size_t>(HeightmapType::Count); ++type) {
+        Heightmap heights = Heightmap::compute(a, static_cast<HeightmapType>(type));
+        const Heightmap& rebuilt = b.heightmap(static_cast<HeightmapType>(type));
+        if (heights.empty() || rebuilt.empty()) {
+            if (heights.empty() != rebuilt.empty()) {
+                return false;
+            }
+            continue;
+        }
+        for (int32_t z = 0; z < SECTION_SIZE; ++z) {
+            for (int32_t x = 0; x < SECTION_SIZE; ++x) {
+                if (heights.height(x, z) != rebuilt.height(x, z)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Offset of the first section record of the chunk at pos, read from the raw index
+static uint64_t recordOffset(const std::vector<char>& bytes, ChunkPos pos) {
+    chunkcache::Header header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    for (uint32_t i = 0; i < header.chunkCount; ++i) {
+        chunkcache::IndexEntry entry;
+        std::memcpy(&entry, bytes.data() + header.indexOffset + i * sizeof(entry), sizeof(entry));
+        if (entry.x == pos.x && entry.z == pos.z) {
+            return entry.offset;
+        }
+    }
+    return 0;
+}
+
+static std::vector<char> readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const std::string& path, const std::vector<char>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+int main() {
+    BlockStateRegistry& registry = BlockStateRegistry::instance();
+    // Enough states for 16 bit sections, the ids of a fresh registry are not in file order
+    std::vector<uint16_t> states = { BlockStateRegistry::AIR, registry.id("minecraft:stone"), registry.id("minecraft:dirt") };
+    for (int i = 0; states.size() < 300; ++i) {
+        states.push_back(registry.idFromString("minecraft:cache_test_" + std::to_string(i)));
+    }
+    std::mt19937 rng(14);
+    std::shuffle(states.begin() + 1, states.end(), rng);
+
+    // 7 x 7 chunks with sections of every width, a few chunks without sections
+    const size_t paletteSizes[] = { 1, 2, 3, 5, 16, 17, 120, 300 };
+    std::vector<std::shared_ptr<const Chunk>> chunks;
+    for (int32_t z = -3; z < 4; ++z) {
+        for (int32_t x = -3; x < 4; ++x) {
+            auto chunk = std::make_shared<Chunk>();
+            chunk->pos = { x, z };
+            chunk->dataVersion = 3465 + x;
+            int32_t count = (x + z + 6) % 5;
+            for (int32_t y = -2; y < count - 2; ++y) {
+                chunk->sections.push_back(randomSection(y, states, paletteSizes[rng() % 8], rng));
+            }
+            chunks.push_back(chunk);
+        }
+    }
+    // Chunk 1, 1 is the one damaged below, its only section is 4 bits wide with 5 entries so
+    // nothing after the record hides the damage
+    const ChunkPos damagedPos = { 1, 1 };
+    std::shared_ptr<const Chunk> damagedChunk;
+    for (auto& chunk : chunks) {
+        if (chunk->pos.x == damagedPos.x && chunk->pos.z == damagedPos.z) {
+            auto copy = std::make_shared<Chunk>(*chunk);
+            copy->sections.assign(1, randomSection(0, states, 5, rng));
+            chunk = damagedChunk = copy;
+        }
+    }
+    std::string path = (std::filesystem::temp_directory_path() / "mc_raytrace_cache_test.bin").string();
+
+    ChunkCacheWriter writer;
+    if (!writer.open(path)) {
+        return 1;
+    }
+    for (const auto& chunk : chunks) {
+        writer.add(*chunk);
+    }
+    // Later copies of the same position replace earlier ones, whatever order they come in
+    for (size_t i : { size_t(3), size_t(40), size_t(17), size_t(3) }) {
+        auto copy = std::make_shared<Chunk>(*chunks[i]);
+        copy->sections.push_back(randomSection(6, states, paletteSizes[rng() % 8], rng));
+        chunks[i] = copy;
+        writer.add(*copy);
+    }
+    if (!writer.finish()) {
+        std::printf("could not write %s\n", path.c_str());
+        return 1;
+    }
+
+    int failures = 0;
+    {
+        ChunkCache cache;
+        if (!cache.open(path)) {
+            std::printf("could not open %s\n", path.c_str());
+            return 1;
+        }
+        if (cache.size() != chunks.size()) {
+            std::printf("%zu chunks in the cache, %zu written\n", cache.size(), chunks.size());
+            ++failures;
+        }
+        for (const auto& chunk : chunks) {
+            std::shared_ptr<Chunk> loaded = cache.load(chunk->pos);
+            if (!loaded || !sameBlocks(*chunk, *loaded)) {
+                std::printf("chunk %d %d differs\n", chunk->pos.x, chunk->pos.z);
+                ++failures;
+            }
+        }
+        if (cache.contains({ 4, 0 }) || cache.load(ChunkPos{ 0, -4 }) || cache.load(chunks.size())) {
+            std::printf("chunks that were never written\n");
+            ++failures;
+        }
+    }
+
+    // Damaged records: a width Section never uses, one past 16 bits, a palette bigger than the
+    // width can index and a uniform section with two entries. Loading fails, nothing is read past
+    // the record.
+    std::vector<char> baked = readFile(path);
+    uint64_t offset = recordOffset(baked, damagedPos);
+    const struct { uint8_t bits; uint16_t paletteSize; } damages[] = { { 3, 8 }, { 32, 2 }, { 2, 5 }, { 0, 2 } };
+    for (const auto& damage : damages) {
+        std::vector<char> bytes = baked;
+        chunkcache::SectionRecord record;
+        std::memcpy(&record, bytes.data() + offset, sizeof(record));
+        record.bitsPerBlock = damage.bits;
+        record.paletteSize = damage.paletteSize;
+        record.dataWords = SECTION_VOLUME * damage.bits / 64;
+        std::memcpy(bytes.data() + offset, &record, sizeof(record));
+        writeFile(path, bytes);
+
+        ChunkCache cache;
+        if (!cache.open(path) || cache.load(damagedPos)) {
+            std::printf("damaged record with %u bits and %u entries loaded\n", damage.bits, damage.paletteSize);
+            ++failures;
+        }
+    }
+
+    // Slots past the palette read as its first entry, every slot of the 4 bit section set to 15
+    {
+        std::vector<char> bytes = baked;
+        chunkcache::SectionRecord record;
+        std::memcpy(&record, bytes.data() + offset, sizeof(record));
+        size_t dataStart = offset + sizeof(record) + ((record.paletteSize * sizeof(uint16_t) + 7) & ~size_t(7));
+        std::memset(bytes.data() + dataStart, 0xFF, record.dataWords * sizeof(uint64_t));
+        writeFile(path, bytes);
+
+        ChunkCache cache;
+        std::shared_ptr<Chunk> loaded = cache.open(path) ? cache.load(damagedPos) : nullptr;
+        if (record.bitsPerBlock != 4 || record.paletteSize != 5 || !loaded) {
+            std::printf("section with slots past its palette did not load\n");
+            ++failures;
+        }
+        else {
+            uint16_t loadedStates[SECTION_VOLUME];
+            loaded->sectionAt(0)->unpack(loadedStates);
+            for (uint16_t state : loadedStates) {
+                if (state != damagedChunk->sectionAt(0)->palette[0]) {
+                    std::printf("slot past the palette reads %u\n", state);
+                    ++failures;
+                    break;
+                }
+            }
+        }
+    }
+    std::filesystem::remove(path);
+
+    std::printf("chunks: %zu, failures: %d\n", chunks.size(), failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+// Packs the heights of known columns like the chunk NBT does, in the spanning layout before 1.16
+// and the packed one after, for 256 and 384 block tall worlds, and compares what
+// Heightmap::fromNbt decodes with Heightmap::compute on the same chunk
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../BlockStateRegistry.h"
+#include "../DataManager.h"
+
+static constexpr uint32_t COLUMNS = SECTION_SIZE * SECTION_SIZE;
+
+// Stone up to a height per column with holes below the top block. Column 0, 0 is empty, 15, 15
+// reaches the top of the world and 1, 0 only has its bottom block.
+static std::shared_ptr<Chunk> column(ChunkPos pos, int32_t minY, int32_t top, std::mt19937& rng) {
+    const uint16_t stone = BlockStateRegistry::instance().id("minecraft:stone");
+    int32_t heights[COLUMNS];
+    for (uint32_t i = 0; i < COLUMNS; ++i) {
+        heights[i] = minY + static_cast<int32_t>(rng() % static_cast<uint32_t>(top - minY + 1));
+    }
+    heights[0] = minY;
+    heights[COLUMNS - 1] = top;
+    heights[1] = minY + 1;
+
+    auto chunk = std::make_shared<Chunk>();
+    chunk->pos = pos;
+    chunk->dataVersion = 3465;
+    for (int32_t sy = minY / SECTION_SIZE; sy < top / SECTION_SIZE; ++sy) {
+        uint16_t states[SECTION_VOLUME] = {};
+        for (int32_t y = 0; y < SECTION_SIZE; ++y) {
+            for (int32_t z = 0; z < SECTION_SIZE; ++z) {
+                for (int32_t x = 0; x < SECTION_SIZE; ++x) {
+                    int32_t wy = sy * SECTION_SIZE + y;
+                    int32_t height = heights[z * SECTION_SIZE + x];
+                    if (wy == height - 1 || (wy < height - 1 && rng() % 4 != 0)) {
+                        states[sectionIndex(x, y, z)] = stone;
+                    }
+                }
+            }
+        }
+        chunk->sections.push_back(Section::pack(sy, states));
+    }
+    return chunk;
+}
+
+// Big endian longs as they are stored in the NBT long array
+static std::vector<uint8_t> packNbt(const uint32_t* values, uint32_t bits, bool spanning) {
+    std::vector<uint64_t> words;
+    if (spanning) {
+        words.assign(COLUMNS * bits / 64, 0);
+        for (uint32_t i = 0; i < COLUMNS; ++i) {
+            uint32_t bit = i * bits;
+            words[bit >> 6] |= uint64_t(values[i]) << (bit & 63);
+            if ((bit & 63) + bits > 64) {
+                words[(bit >> 6) + 1] |= uint64_t(values[i]) >> (64 - (bit & 63));
+            }
+        }
+    }
+    else {
+        uint32_t perWord = 64 / bits;
+        words.assign((COLUMNS + perWord - 1) / perWord, 0);
+        for (uint32_t i = 0; i < COLUMNS; ++i) {
+            words[i / perWord] |= uint64_t(values[i]) << ((i % perWord) * bits);
+        }
+    }
+    std::vector<uint8_t> bytes;
+    for (uint64_t word : words) {
+        for (int32_t shift = 56; shift >= 0; shift -= 8) {
+            bytes.push_back(static_cast<uint8_t>(word >> shift));
+        }
+    }
+    return bytes;
+}
+
+int main() {
+    struct World {
+        int32_t minY, top;
+        bool spanning;
+    };
+    // Spanning 384 block worlds never existed, fromNbt does not know that
+    const World worlds[] = { { 0, 256, true }, { 0, 256, false }, { -64, 320, false }, { -64, 320, true } };
+
+    std::mt19937 rng(22);
+    DataManager dataManager;
+    int failures = 0;
+    int32_t cx = 0;
+    for (const World& world : worlds) {
+        for (int round = 0; round < 4; ++round, ++cx) {
+            std::shared_ptr<Chunk> chunk = column({ cx, 0 }, world.minY, world.top, rng);
+            Heightmap expected = Heightmap::compute(*chunk, HeightmapType::WorldSurface);
+
+            // 257 and 385 values need 9 bits, the same width vanilla writes
+            uint32_t values[COLUMNS];
+            for (uint32_t i = 0; i < COLUMNS; ++i) {
+                values[i] = static_cast<uint32_t>(expected.height(i % SECTION_SIZE, i / SECTION_SIZE) - world.minY);
+            }
+            std::vector<uint8_t> longs = packNbt(values, 9, world.spanning);
+            Heightmap decoded = Heightmap::fromNbt(longs.data(), static_cast<uint32_t>(longs.size() / 8), world.minY, world.spanning);
+            if (decoded.empty() || decoded.minY != world.minY) {
+                std::printf("%d to %d, spanning %d: %zu longs did not decode\n", world.minY, world.top, world.spanning, longs.size() / 8);
+                ++failures;
+                continue;
+            }
+            int mismatches = 0;
+            for (int32_t z = 0; z < SECTION_SIZE; ++z) {
+                for (int32_t x = 0; x < SECTION_SIZE; ++x) {
+                    mismatches += decoded.height(x, z) != expected.height(x, z);
+                }
+            }
+            if (mismatches) {
+                std::printf("%d to %d, spanning %d: %d columns differ\n", world.minY, world.top, world.spanning, mismatches);
+                ++failures;
+            }
+
+            // Through the world: the sky is seen from the height up, not from one block below
+            chunk->heightmaps[static_cast<size_t>(HeightmapType::MotionBlocking)] = decoded;
+            dataManager.write(chunk);
+            for (int32_t z = 0; z < SECTION_SIZE; ++z) {
+                for (int32_t x = 0; x < SECTION_SIZE; ++x) {
+                    int32_t bx = cx * SECTION_SIZE + x;
+                    int32_t height = expected.height(x, z);
+                    if (dataManager.height(bx, z) != height || !dataManager.seesSky({ bx, height, z }) ||
+                        dataManager.seesSky({ bx, height - 1, z })) {
+                        std::printf("%d to %d, spanning %d: sky at %d %d\n", world.minY, world.top, world.spanning, bx, z);
+                        ++failures;
+                        x = z = SECTION_SIZE;
+                    }
+                }
+            }
+        }
+
+        // Lengths that fit no width stay empty
+        std::vector<uint8_t> longs(8 * (world.spanning ? 35 : 38), 0);
+        if (!Heightmap::fromNbt(longs.data(), static_cast<uint32_t>(longs.size() / 8), world.minY, world.spanning).empty()) {
+            std::printf("%zu longs decoded\n", longs.size() / 8);
+            ++failures;
+        }
+    }
+
+    std::printf("chunks: %d, failures: %d\n", cx, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+// Producers push tagged events into ChangeJournal while a consumer drains it, every event must
+// arrive exactly once while there is room and overflow is reported exactly when it runs full
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "../ChangeJournal.h"
+
+static constexpr uint32_t PRODUCERS = 6;
+static constexpr uint32_t EVENTS_PER_PRODUCER = 40000;
+
+// Threads wait for each other so the pushes really overlap
+struct StartLine {
+    std::atomic<uint32_t> waiting;
+
+    explicit StartLine(uint32_t threads) : waiting(threads) {}
+    void arrive() {
+        waiting.fetch_sub(1);
+        while (waiting.load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+};
+
+// Producer in x, sequence number in z
+static ChangeEvent tagged(uint32_t producer, uint32_t sequence) {
+    return { ChangeEvent::Type::SectionChanged, { static_cast<int32_t>(producer), 0, static_cast<int32_t>(sequence) }, uint64_t(producer) << 32 | sequence };
+}
+
+int main() {
+    int failures = 0;
+
+    // Concurrent producers and a consumer draining in between. A producer whose push fails
+    // retries, so nothing may be lost even though drains can report overflow.
+    {
+        ChangeJournal journal(1024);
+        std::atomic<uint32_t> running{ PRODUCERS };
+        std::vector<std::thread> producers;
+        std::atomic<uint64_t> rejected{ 0 };
+        StartLine start(PRODUCERS);
+        for (uint32_t p = 0; p < PRODUCERS; ++p) {
+            producers.emplace_back([&, p]() {
+                start.arrive();
+                for (uint32_t i = 0; i < EVENTS_PER_PRODUCER; ++i) {
+                    while (!journal.push(tagged(p, i))) {
+                        rejected.fetch_add(1, std::memory_order_relaxed);
+                        std::this_thread::yield();
+                    }
+                }
+                running.fetch_sub(1);
+            });
+        }
+
+        std::vector<std::vector<uint32_t>> received(PRODUCERS);
+        std::vector<ChangeEvent> events;
+        bool overflowReported = false;
+        bool corrupt = false;
+        while (true) {
+            bool done = running.load() == 0;
+            events.clear();
+            overflowReported |= journal.drain(events);
+            for (const ChangeEvent& event : events) {
+                uint32_t p = static_cast<uint32_t>(event.pos.x);
+                if (p >= PRODUCERS || event.generation != (uint64_t(p) << 32 | static_cast<uint32_t>(event.pos.z))) {
+                    corrupt = true;
+                    continue;
+                }
+                received[p].push_back(static_cast<uint32_t>(event.pos.z));
+            }
+            if (done && events.empty()) {
+                break;
+            }
+        }
+        for (std::thread& producer : producers) {
+            producer.join();
+        }
+
+        if (corrupt) {
+            std::printf("torn event\n");
+            ++failures;
+        }
+        for (uint32_t p = 0; p < PRODUCERS; ++p) {
+            // One producer's events keep their order, the queue is FIFO
+            bool inOrder = received[p].size() == EVENTS_PER_PRODUCER;
+            for (uint32_t i = 0; inOrder && i < EVENTS_PER_PRODUCER; ++i) {
+                inOrder = received[p][i] == i;
+            }
+            if (!inOrder) {
+                std::printf("producer %u: %zu of %u events, lost, duplicated or out of order\n", p, received[p].size(), EVENTS_PER_PRODUCER);
+                ++failures;
+            }
+        }
+        if (overflowReported != (rejected.load() != 0)) {
+            std::printf("overflow reported %d, %llu pushes rejected\n", overflowReported, static_cast<unsigned long long>(rejected.load()));
+            ++failures;
+        }
+    }
+
+    // Concurrent producers without a consumer: exactly capacity events fit, every other push
+    // fails and the drain reports the overflow once
+    for (size_t capacity : { size_t(256), size_t(4096) }) {
+        ChangeJournal journal(capacity);
+        const uint32_t perProducer = static_cast<uint32_t>(capacity / PRODUCERS + 100);
+        std::atomic<uint64_t> accepted{ 0 };
+        std::vector<std::thread> producers;
+        StartLine start(PRODUCERS);
+        for (uint32_t p = 0; p < PRODUCERS; ++p) {
+            producers.emplace_back([&, p]() {
+                start.arrive();
+                for (uint32_t i = 0; i < perProducer; ++i) {
+                    if (journal.push(tagged(p, i))) {
+                        accepted.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            });
+        }
+        for (std::thread& producer : producers) {
+            producer.join();
+        }
+
+        std::vector<ChangeEvent> events;
+        bool overflowed = journal.drain(events);
+        std::vector<std::vector<bool>> seen(PRODUCERS, std::vector<bool>(perProducer, false));
+        size_t duplicates = 0;
+        for (const ChangeEvent& event : events) {
+            std::vector<bool>::reference flag = seen[event.pos.x][event.pos.z];
+            duplicates += flag;
+            flag = true;
+        }
+        if (accepted.load() != capacity || events.size() != capacity || duplicates || !overflowed) {
+            std::printf("capacity %zu: %llu accepted, %zu drained, %zu duplicates, overflow %d\n", capacity,
+                        static_cast<unsigned long long>(accepted.load()), events.size(), duplicates, overflowed);
+            ++failures;
+        }
+
+        // The flag is cleared by the drain, the emptied journal takes a full load again without overflowing
+        events.clear();
+        bool again = journal.drain(events);
+        for (uint32_t i = 0; i < capacity; ++i) {
+            again |= !journal.push(tagged(0, i));
+        }
+        events.clear();
+        again |= journal.drain(events);
+        if (again || events.size() != capacity) {
+            std::printf("capacity %zu: overflow after the drain\n", capacity);
+            ++failures;
+        }
+    }
+
+    // Capacity rounds up to a power of two, one more push than that overflows
+    {
+        ChangeJournal journal(1000);
+        size_t pushed = 0;
+        while (journal.push(tagged(0, static_cast<uint32_t>(pushed)))) {
+            ++pushed;
+        }
+        std::vector<ChangeEvent> events;
+        if (pushed != 1024 || !journal.drain(events) || events.size() != 1024) {
+            std::printf("capacity 1000 holds %zu events\n", pushed);
+            ++failures;
+        }
+    }
+
+    std::printf("producers: %u, events: %u, failures: %d\n", PRODUCERS, PRODUCERS * EVENTS_PER_PRODUCER, failures);
+    return failures == 0 ? 0 : 1;
+}
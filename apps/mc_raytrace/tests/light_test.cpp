@@ -0,0 +1,258 @@
+// Compares LightEngine with a flood fill of the whole world from scratch, after loading chunks one
+// at a time and after incremental edits with updateChunk
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../BlockDelta.h"
+#include "../BlockStateRegistry.h"
+#include "../LightEngine.h"
+
+static constexpr int32_t SIZE = 3; // chunks per side
+
+// Both channels of every block of the resident chunks by a single flood fill over everything
+struct Reference {
+    struct Column {
+        const Chunk* chunk = nullptr;
+        int32_t bottom = 0, top = 0;
+    };
+
+    Column columns[SIZE * SIZE];
+    int32_t minY = 0, maxY = 0;
+    std::vector<uint8_t> light[2]; // block, sky by (y - minY) * width^2 + z * width + x
+    int32_t heights[SIZE * SIZE * SECTION_SIZE * SECTION_SIZE];
+
+    static constexpr int32_t WIDTH = SIZE * SECTION_SIZE;
+
+    static LightProperties properties(uint16_t state) {
+        return LightEngine::classify(BlockStateRegistry::instance().state(state));
+    }
+    const Column* column(int32_t x, int32_t z) const {
+        return x >= 0 && z >= 0 && x < WIDTH && z < WIDTH ? &columns[(z >> 4) * SIZE + (x >> 4)] : nullptr;
+    }
+    bool inside(int32_t x, int32_t y, int32_t z) const {
+        const Column* c = column(x, z);
+        return c && c->chunk && y >= c->bottom && y < c->top;
+    }
+    uint16_t state(int32_t x, int32_t y, int32_t z) const {
+        const Section* section = column(x, z)->chunk->section(y >> 4);
+        return section ? section->blockAt(x & 15, y & 15, z & 15) : BlockStateRegistry::AIR;
+    }
+    size_t index(int32_t x, int32_t y, int32_t z) const { return (static_cast<size_t>(y - minY) * WIDTH + z) * WIDTH + x; }
+
+    void build(const std::vector<std::shared_ptr<const Chunk>>& chunks) {
+        minY = 1 << 30;
+        maxY = -(1 << 30);
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            Column& c = columns[i];
+            c.chunk = chunks[i].get();
+            size_t count = c.chunk ? c.chunk->sectionCount() : 0;
+            if (count == 0) {
+                c.chunk = nullptr;
+                continue;
+            }
+            c.bottom = c.chunk->sectionAt(0)->y * SECTION_SIZE;
+            c.top = (c.chunk->sectionAt(count - 1)->y + 1) * SECTION_SIZE;
+            minY = std::min(minY, c.bottom);
+            maxY = std::max(maxY, c.top);
+        }
+        for (std::vector<uint8_t>& channel : light) {
+            channel.assign(static_cast<size_t>(maxY - minY) * WIDTH * WIDTH, 0);
+        }
+
+        std::vector<std::array<int32_t, 3>> queue[2];
+        for (int32_t z = 0; z < WIDTH; ++z) {
+            for (int32_t x = 0; x < WIDTH; ++x) {
+                const Column* c = column(x, z);
+                if (!c->chunk) {
+                    continue;
+                }
+                int32_t& height = heights[z * WIDTH + x];
+                height = c->bottom;
+                for (int32_t y = c->top - 1; y >= c->bottom; --y) {
+                    if (properties(state(x, y, z)).opacity) {
+                        height = y + 1;
+                        break;
+                    }
+                }
+                for (int32_t y = c->bottom; y < c->top; ++y) {
+                    if (y >= height) {
+                        light[1][index(x, y, z)] = LightEngine::MAX_LIGHT;
+                        queue[1].push_back({ x, y, z });
+                    }
+                    if (uint8_t emission = properties(state(x, y, z)).emission) {
+                        light[0][index(x, y, z)] = emission;
+                        queue[0].push_back({ x, y, z });
+                    }
+                }
+            }
+        }
+
+        const int32_t offsets[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+        for (int channel = 0; channel < 2; ++channel) {
+            for (size_t head = 0; head < queue[channel].size(); ++head) {
+                auto [x, y, z] = queue[channel][head];
+                uint8_t level = light[channel][index(x, y, z)];
+                for (const auto& offset : offsets) {
+                    int32_t nx = x + offset[0], ny = y + offset[1], nz = z + offset[2];
+                    if (!inside(nx, ny, nz)) {
+                        continue;
+                    }
+                    int32_t lit = level - std::max<int32_t>(1, properties(state(nx, ny, nz)).opacity);
+                    uint8_t& stored = light[channel][index(nx, ny, nz)];
+                    if (lit > stored) {
+                        stored = static_cast<uint8_t>(lit);
+                        queue[channel].push_back({ nx, ny, nz });
+                    }
+                }
+            }
+        }
+    }
+};
+
+static std::shared_ptr<Chunk> terrain(ChunkPos pos, std::mt19937& rng) {
+    BlockStateRegistry& registry = BlockStateRegistry::instance();
+    const uint16_t stone = registry.id("minecraft:stone");
+    const uint16_t dirt = registry.id("minecraft:dirt");
+    const uint16_t glowstone = registry.id("minecraft:glowstone");
+    const uint16_t water = registry.id("minecraft:water");
+    const uint16_t leaves = registry.id("minecraft:oak_leaves");
+    const uint16_t glass = registry.id("minecraft:glass");
+
+    auto chunk = std::make_shared<Chunk>();
+    chunk->pos = pos;
+    chunk->dataVersion = 3465;
+    // Rolling ground from y 4 to 28 with caves, a pond, a few trees, glass and lights
+    int32_t ground[SECTION_SIZE * SECTION_SIZE];
+    for (int32_t z = 0; z < SECTION_SIZE; ++z) {
+        for (int32_t x = 0; x < SECTION_SIZE; ++x) {
+            ground[z * SECTION_SIZE + x] = 4 + static_cast<int32_t>((pos.x * 16 + x + 2 * (pos.z * 16 + z)) % 20) + static_cast<int32_t>(rng() % 5);
+        }
+    }
+    int32_t topSection = pos.x == 1 && pos.z == 1 ? 3 : 2;
+    for (int32_t sy = -1; sy <= topSection; ++sy) {
+        uint16_t states[SECTION_VOLUME] = {};
+        for (int32_t y = 0; y < SECTION_SIZE; ++y) {
+            for (int32_t z = 0; z < SECTION_SIZE; ++z) {
+                for (int32_t x = 0; x < SECTION_SIZE; ++x) {
+                    int32_t wy = sy * SECTION_SIZE + y;
+                    int32_t height = ground[z * SECTION_SIZE + x];
+                    uint16_t& state = states[sectionIndex(x, y, z)];
+                    if (wy < height - 1) {
+                        state = rng() % 9 == 0 ? BlockStateRegistry::AIR : stone;
+                    }
+                    else if (wy == height - 1) {
+                        state = dirt;
+                    }
+                    else if (wy < 10) {
+                        state = water;
+                    }
+                    else if (wy < height + 5 && rng() % 40 == 0) {
+                        state = rng() % 2 ? leaves : glass;
+                    }
+                    if (rng() % 300 == 0) {
+                        state = glowstone;
+                    }
+                }
+            }
+        }
+        chunk->sections.push_back(Section::pack(sy, states));
+    }
+    return chunk;
+}
+
+// Mismatches of both channels over every stored block
+static int compare(const LightEngine& engine, const Reference& reference, const char* what) {
+    int mismatches = 0;
+    for (int32_t z = 0; z < Reference::WIDTH; ++z) {
+        for (int32_t x = 0; x < Reference::WIDTH; ++x) {
+            const Reference::Column* c = reference.column(x, z);
+            if (!c->chunk) {
+                continue;
+            }
+            if (engine.height(x, z) != reference.heights[z * Reference::WIDTH + x]) {
+                ++mismatches;
+            }
+            for (int32_t y = c->bottom; y < c->top; ++y) {
+                BlockPos pos = { x, y, z };
+                mismatches += engine.blockLight(pos) != reference.light[0][reference.index(x, y, z)];
+                mismatches += engine.skyLight(pos) != reference.light[1][reference.index(x, y, z)];
+            }
+        }
+    }
+    if (mismatches) {
+        std::printf("%s: %d mismatches\n", what, mismatches);
+    }
+    return mismatches;
+}
+
+int main() {
+    BlockStateRegistry& registry = BlockStateRegistry::instance();
+    const uint16_t palette[] = {
+        BlockStateRegistry::AIR,
+        registry.id("minecraft:stone"),
+        registry.id("minecraft:glowstone"),
+        registry.id("minecraft:water"),
+        registry.id("minecraft:glass"),
+        registry.id("minecraft:oak_leaves"),
+        registry.id("minecraft:torch"),
+    };
+
+    std::mt19937 rng(21);
+    std::vector<std::shared_ptr<const Chunk>> chunks(SIZE * SIZE);
+    for (int32_t z = 0; z < SIZE; ++z) {
+        for (int32_t x = 0; x < SIZE; ++x) {
+            chunks[z * SIZE + x] = terrain({ x, z }, rng);
+        }
+    }
+
+    // Loaded in a scattered order so chunks join neighbours on different sides
+    LightEngine engine;
+    std::vector<size_t> order(chunks.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+    for (size_t i : order) {
+        engine.addChunk(chunks[i]);
+    }
+    Reference reference;
+    reference.build(chunks);
+    int failures = compare(engine, reference, "after loading") != 0;
+
+    // Edits around the surface and in the caves, on chunk borders and in a new section on top
+    int edits = 0;
+    for (int round = 0; round < 60; ++round) {
+        size_t c = rng() % chunks.size();
+        std::vector<BlockDelta::Edit> batch;
+        for (int i = 0; i < 8; ++i) {
+            int32_t x = rng() % SECTION_SIZE, z = rng() % SECTION_SIZE;
+            if (i % 3 == 0) {
+                x = rng() % 2 ? 0 : SECTION_SIZE - 1;
+            }
+            int32_t y = static_cast<int32_t>(rng() % 40) - 4;
+            if (round % 20 == 19 && i == 0) {
+                y = 52 + static_cast<int32_t>(rng() % 8);
+            }
+            batch.push_back({ y >> 4, static_cast<uint16_t>(sectionIndex(x, y & 15, z)), palette[rng() % 7] });
+        }
+        std::vector<int32_t> touched;
+        std::shared_ptr<const Chunk> edited = applyEdits(*chunks[c], std::move(batch), touched);
+        chunks[c] = edited;
+        engine.updateChunk(edited, touched);
+        edits += 8;
+    }
+
+    LightEngine fresh;
+    for (const auto& chunk : chunks) {
+        fresh.addChunk(chunk);
+    }
+    reference.build(chunks);
+    failures += compare(fresh, reference, "fresh after edits") != 0;
+    failures += compare(engine, reference, "incremental after edits") != 0;
+
+    std::printf("chunks: %zu, edits: %d, failures: %d\n", chunks.size(), edits, failures);
+    return failures == 0 ? 0 : 1;
+}
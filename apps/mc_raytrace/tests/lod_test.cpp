@@ -0,0 +1,192 @@
+// Checks VoxelLod votes against a brute force majority of the blocks, the collapse of uniform
+// bricks, thin floors staying closed and levelFor growing with distance and pixel error
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../BlockStateRegistry.h"
+#include "../VoxelLod.h"
+#include "../VoxelWorld.h"
+
+static std::shared_ptr<Chunk> makeChunk(ChunkPos pos) {
+    auto chunk = std::make_shared<Chunk>();
+    chunk->pos = pos;
+    chunk->dataVersion = 3465;
+    return chunk;
+}
+
+static void addSection(Chunk& chunk, int32_t y, const uint16_t* states) {
+    chunk.sections.push_back(Section::pack(y, states));
+}
+
+// Most common state, ties go to the first one unless that is air
+static uint16_t expectedMajority(const std::vector<uint16_t>& states) {
+    uint16_t best = BlockStateRegistry::AIR;
+    size_t bestCount = 0;
+    for (uint16_t state : states) {
+        size_t count = std::count(states.begin(), states.end(), state);
+        if (count > bestCount || (count == bestCount && best == BlockStateRegistry::AIR)) {
+            best = state;
+            bestCount = count;
+        }
+    }
+    return best;
+}
+
+int main() {
+    BlockStateRegistry& registry = BlockStateRegistry::instance();
+    const uint16_t air = BlockStateRegistry::AIR;
+    const uint16_t stone = registry.id("minecraft:stone");
+    const uint16_t dirt = registry.id("minecraft:dirt");
+
+    // Chunks 0..1 x 0..1: sections 0 and 1 of uniform stone, a level 2 brick of one state.
+    // Chunk 2, 0: section 0 is a one block floor at y 5, section 1 stone with a dirt block in
+    // some 2x2x2 groups. Chunk 3, 0: section 0 random, 1 a mix of dirt and stone.
+    std::mt19937 rng(20);
+    std::vector<std::shared_ptr<const Chunk>> chunks;
+    uint16_t states[SECTION_VOLUME];
+    for (int32_t cz = 0; cz < 2; ++cz) {
+        for (int32_t cx = 0; cx < 2; ++cx) {
+            auto chunk = makeChunk({ cx, cz });
+            std::fill(std::begin(states), std::end(states), stone);
+            addSection(*chunk, 0, states);
+            addSection(*chunk, 1, states);
+            chunks.push_back(chunk);
+        }
+    }
+    {
+        auto chunk = makeChunk({ 2, 0 });
+        std::fill(std::begin(states), std::end(states), air);
+        for (int32_t z = 0; z < SECTION_SIZE; ++z) {
+            for (int32_t x = 0; x < SECTION_SIZE; ++x) {
+                states[sectionIndex(x, 5, z)] = stone;
+            }
+        }
+        addSection(*chunk, 0, states);
+        std::fill(std::begin(states), std::end(states), stone);
+        for (int32_t y = 0; y < SECTION_SIZE; y += 2) {
+            for (int32_t z = 0; z < SECTION_SIZE; z += 2) {
+                for (int32_t x = 0; x < SECTION_SIZE; x += 2) {
+                    if (rng() % 2) {
+                        states[sectionIndex(x + rng() % 2, y + rng() % 2, z + rng() % 2)] = dirt;
+                    }
+                }
+            }
+        }
+        addSection(*chunk, 1, states);
+        chunks.push_back(chunk);
+    }
+    {
+        auto chunk = makeChunk({ 3, 0 });
+        const uint16_t palette[] = { air, stone, dirt };
+        for (uint16_t& state : states) {
+            state = palette[rng() % 3];
+        }
+        addSection(*chunk, 0, states);
+        for (uint16_t& state : states) {
+            state = rng() % 2 ? stone : dirt;
+        }
+        addSection(*chunk, 1, states);
+        chunks.push_back(chunk);
+    }
+
+    VoxelWorld world;
+    world.build(chunks);
+    const VoxelWorldView& view = world.view();
+    VoxelLod lod;
+    lod.build(view, 4);
+    int failures = 0;
+
+    // Level 1 cells against the majority of their eight blocks
+    for (int32_t y = 0; y < 2 * SECTION_SIZE; y += 2) {
+        for (int32_t z = 0; z < 2 * SECTION_SIZE; z += 2) {
+            for (int32_t x = 0; x < 4 * SECTION_SIZE; x += 2) {
+                std::vector<uint16_t> votes;
+                for (int32_t i = 0; i < 8; ++i) {
+                    votes.push_back(voxel::blockState(view, x + (i & 1), y + (i >> 2), z + ((i >> 1) & 1)));
+                }
+                if (lod.cell(1, x >> 1, y >> 1, z >> 1) != expectedMajority(votes)) {
+                    std::printf("level 1 cell %d %d %d\n", x >> 1, y >> 1, z >> 1);
+                    ++failures;
+                }
+            }
+        }
+    }
+
+    // Uniform sections stay single slots, at level 2 the 2x2x2 sections of stone are one slot
+    const VoxelLod::Level& level1 = lod.level(1);
+    const VoxelLod::Level& level2 = lod.level(2);
+    if (level1.slot(0, 0, 0) != (VoxelLod::UNIFORM | stone) || level2.slot(0, 0, 0) != (VoxelLod::UNIFORM | stone)) {
+        std::printf("uniform stone did not collapse\n");
+        ++failures;
+    }
+    // Dirt never wins a vote in section 1 of chunk 2, 0, the brick collapses after voting
+    if (level1.slot(2, 1, 0) != (VoxelLod::UNIFORM | stone)) {
+        std::printf("voted stone brick did not collapse\n");
+        ++failures;
+    }
+    // Only the floor and the random sections take pool space
+    size_t pooled = level1.cells.size() / VoxelLod::BRICK_VOLUME;
+    if (pooled != 3) {
+        std::printf("level 1 pools %zu bricks\n", pooled);
+        ++failures;
+    }
+
+    // Half of every 2x2x2 group of the floor is air, the tie keeps it closed at level 1 and 2
+    for (int32_t z = 0; z < SECTION_SIZE; ++z) {
+        for (int32_t x = 0; x < SECTION_SIZE; ++x) {
+            int32_t bx = 2 * SECTION_SIZE + x;
+            if (lod.cell(1, bx >> 1, 5 >> 1, z >> 1) != stone || lod.cell(2, bx >> 2, 5 >> 2, z >> 2) != stone) {
+                std::printf("floor opens at %d %d\n", bx, z);
+                ++failures;
+                break;
+            }
+            if (lod.cell(1, bx >> 1, 7 >> 1, z >> 1) != air) {
+                std::printf("floor grew at %d %d\n", bx, z);
+                ++failures;
+                break;
+            }
+        }
+    }
+
+    // levelFor only grows with distance and pixel error and stays within the built levels
+    const float fovY = 60.0f;
+    const uint32_t height = 1080;
+    int32_t previous = 0;
+    for (float distance = 0.0f; distance < 20000.0f; distance += 1.0f + distance * 0.01f) {
+        int32_t level = lod.levelFor(distance, fovY, height, 2.0f);
+        if (level < previous || level < 0 || level > lod.maxLevel()) {
+            std::printf("level %d at distance %.1f after %d\n", level, distance, previous);
+            ++failures;
+        }
+        previous = level;
+    }
+    if (previous != lod.maxLevel() || lod.levelFor(0.0f, fovY, height, 2.0f) != 0) {
+        std::printf("levelFor does not span 0 to %d\n", lod.maxLevel());
+        ++failures;
+    }
+    for (float distance = 10.0f; distance < 2000.0f; distance *= 1.7f) {
+        previous = 0;
+        for (float error = 0.25f; error < 64.0f; error *= 1.3f) {
+            int32_t level = lod.levelFor(distance, fovY, height, error);
+            if (level < previous) {
+                std::printf("level %d at pixel error %.2f after %d\n", level, error, previous);
+                ++failures;
+            }
+            previous = level;
+        }
+    }
+    // The box overload measures from the nearest point of the box
+    const float eye[3] = { -100.0f, 8.0f, 8.0f };
+    const float boxMin[3] = { 300.0f, 0.0f, 0.0f }, boxMax[3] = { 316.0f, 16.0f, 16.0f };
+    const float inside[3] = { 310.0f, 8.0f, 8.0f };
+    if (lod.levelFor(eye, boxMin, boxMax, fovY, height, 4.0f) != lod.levelFor(400.0f, fovY, height, 4.0f) ||
+        lod.levelFor(inside, boxMin, boxMax, fovY, height, 4.0f) != 0) {
+        std::printf("box distance\n");
+        ++failures;
+    }
+
+    std::printf("levels: %d, pooled level 1 bricks: %zu, failures: %d\n", lod.maxLevel(), pooled, failures);
+    return failures == 0 ? 0 : 1;
+}
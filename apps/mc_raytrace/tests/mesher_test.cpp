@@ -0,0 +1,266 @@
+// Compares meshes built by ParallelMesher and sections re-meshed in place with the serial ChunkMesher
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../BlockDelta.h"
+#include "../BlockStateRegistry.h"
+#include "../ChunkMesher.h"
+#include "../ParallelMesher.h"
+#include "../TaskPool.h"
+
+static std::shared_ptr<Chunk> randomChunk(ChunkPos pos, std::mt19937& rng) {
+    BlockStateRegistry& registry = BlockStateRegistry::instance();
+    const uint16_t palette[] = {
+        registry.id("minecraft:stone"),
+        registry.id("minecraft:glass"),
+        registry.id("minecraft:oak_leaves"),
+        registry.id("minecraft:water"),
+        registry.id("minecraft:oak_slab"),
+    };
+
+    auto chunk = std::make_shared<Chunk>();
+    chunk->pos = pos;
+    chunk->dataVersion = 3465;
+    for (int32_t sy = -2; sy < 4; ++sy) {
+        uint16_t states[SECTION_VOLUME] = {};
+        if (sy == -2) {
+            std::fill(std::begin(states), std::end(states), palette[0]); // uniform, only border faces
+        }
+        else if (sy != 2) { // section 2 stays air
+            for (uint16_t& state : states) {
+                if (rng() % 3 == 0) {
+                    state = palette[rng() % 5];
+                }
+            }
+        }
+        chunk->sections.push_back(Section::pack(sy, states));
+    }
+    return chunk;
+}
+
+static bool sameMesh(const ChunkMesh& a, const ChunkMesh& b) {
+    if (a.pos != b.pos || a.sections.size() != b.sections.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.sections.size(); ++i) {
+        const ChunkMesh::SectionRange& x = a.sections[i];
+        const ChunkMesh::SectionRange& y = b.sections[i];
+        if (x.y != y.y || x.firstVertex != y.firstVertex || x.vertexCount != y.vertexCount ||
+            x.vertexCapacity != y.vertexCapacity || x.firstTriangle != y.firstTriangle ||
+            x.triangleCount != y.triangleCount || x.triangleCapacity != y.triangleCapacity) {
+            return false;
+        }
+    }
+    return a.positions == b.positions && a.texcoords == b.texcoords && a.triangles == b.triangles &&
+        a.directions == b.directions && a.states == b.states;
+}
+
+// Counted vertices and triangles of two ranges match, and everything past the counts is padding
+static bool sameSection(const ChunkMesh& a, const ChunkMesh::SectionRange& x, const ChunkMesh& b, const ChunkMesh::SectionRange& y) {
+    if (x.y != y.y || x.vertexCount != y.vertexCount || x.triangleCount != y.triangleCount) {
+        return false;
+    }
+    for (uint32_t v = 0; v < x.vertexCount; ++v) {
+        if (a.positions[x.firstVertex + v] != b.positions[y.firstVertex + v] ||
+            a.texcoords[x.firstVertex + v] != b.texcoords[y.firstVertex + v]) {
+            return false;
+        }
+    }
+    for (uint32_t t = 0; t < x.triangleCount; ++t) {
+        const auto& p = a.triangles[x.firstTriangle + t];
+        const auto& q = b.triangles[y.firstTriangle + t];
+        for (int i = 0; i < 3; ++i) {
+            if (p[i] - x.firstVertex != q[i] - y.firstVertex) {
+                return false;
+            }
+        }
+        if (a.directions[x.firstTriangle + t] != b.directions[y.firstTriangle + t] ||
+            a.states[x.firstTriangle + t] != b.states[y.firstTriangle + t]) {
+            return false;
+        }
+    }
+    for (uint32_t v = x.vertexCount; v < x.vertexCapacity; ++v) {
+        if (!std::isnan(a.positions[x.firstVertex + v][0])) {
+            return false;
+        }
+    }
+    for (uint32_t t = x.triangleCount; t < x.triangleCapacity; ++t) {
+        const auto& p = a.triangles[x.firstTriangle + t];
+        if (p[0] < x.firstVertex + x.vertexCount || p[0] >= x.firstVertex + x.vertexCapacity || p[0] != p[1] || p[1] != p[2]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Edits sections of chunks with padded meshes, re-meshes the touched sections and the neighbours
+// flagged by changedBorders in place and compares every mesh with a fresh one of the edited world
+static int checkRemesh(std::vector<std::shared_ptr<const Chunk>>& chunks, int32_t size, std::mt19937& rng) {
+    BlockStateRegistry& registry = BlockStateRegistry::instance();
+    const uint16_t palette[] = {
+        registry.id("minecraft:air"),
+        registry.id("minecraft:stone"),
+        registry.id("minecraft:glass"),
+        registry.id("minecraft:water"),
+    };
+    auto at = [&](int32_t x, int32_t z) -> std::shared_ptr<const Chunk> {
+        return x >= 0 && x < size && z >= 0 && z < size ? chunks[z * size + x] : nullptr;
+    };
+    ChunkMesher mesher;
+    auto fresh = [&](int32_t x, int32_t z, ChunkMesh& out) {
+        std::shared_ptr<const Chunk> negX = at(x - 1, z), posX = at(x + 1, z), negZ = at(x, z - 1), posZ = at(x, z + 1);
+        mesher.mesh(*at(x, z), { negX.get(), posX.get(), negZ.get(), posZ.get() }, out);
+    };
+
+    std::vector<ChunkMesh> meshes(chunks.size());
+    for (int32_t z = 0; z < size; ++z) {
+        for (int32_t x = 0; x < size; ++x) {
+            fresh(x, z, meshes[z * size + x]);
+            meshes[z * size + x].addSlack(0.25f, 16);
+        }
+    }
+
+    int failures = 0, remeshed = 0, overflows = 0;
+    SectionBorders borders;
+    // Like App::remeshResidentSection, a full mesh when the section outgrew its range
+    auto remesh = [&](int32_t x, int32_t z, int32_t y) {
+        std::shared_ptr<const Chunk> chunk = at(x, z);
+        if (!chunk || !chunk->section(y)) {
+            return;
+        }
+        std::shared_ptr<const Chunk> negX = at(x - 1, z), posX = at(x + 1, z), negZ = at(x, z - 1), posZ = at(x, z + 1);
+        ChunkMesher::captureBorders(*chunk, y, { negX.get(), posX.get(), negZ.get(), posZ.get() }, borders);
+        ChunkMesh& mesh = meshes[z * size + x];
+        if (mesher.remeshSection(*chunk->section(y), borders, mesh) < 0) {
+            ++overflows;
+            fresh(x, z, mesh);
+            mesh.addSlack(0.25f, 16);
+        }
+        ++remeshed;
+    };
+    auto edit = [&](int32_t x, int32_t z, std::vector<BlockDelta::Edit> edits) {
+        std::shared_ptr<const Chunk> before = at(x, z);
+        std::vector<int32_t> touched;
+        chunks[z * size + x] = applyEdits(*before, std::move(edits), touched);
+        for (int32_t y : touched) {
+            uint8_t changed = ChunkMesher::changedBorders(*before->section(y), *at(x, z)->section(y));
+            remesh(x, z, y);
+            if (changed & (1 << static_cast<int>(FaceDirection::NegX))) remesh(x - 1, z, y);
+            if (changed & (1 << static_cast<int>(FaceDirection::PosX))) remesh(x + 1, z, y);
+            if (changed & (1 << static_cast<int>(FaceDirection::NegY))) remesh(x, z, y - 1);
+            if (changed & (1 << static_cast<int>(FaceDirection::PosY))) remesh(x, z, y + 1);
+            if (changed & (1 << static_cast<int>(FaceDirection::NegZ))) remesh(x, z - 1, y);
+            if (changed & (1 << static_cast<int>(FaceDirection::PosZ))) remesh(x, z + 1, y);
+        }
+    };
+
+    // A few scattered blocks per section fit the slack, plus some on every border of the section
+    constexpr int32_t LAST = SECTION_SIZE - 1;
+    for (int round = 0; round < 16; ++round) {
+        std::vector<BlockDelta::Edit> edits;
+        for (int i = 0; i < 12; ++i) {
+            int32_t y = static_cast<int32_t>(rng() % 3) - 1;
+            int32_t a = rng() % SECTION_SIZE, b = rng() % SECTION_SIZE, side = (rng() & 1) * LAST;
+            uint32_t index = rng() % SECTION_VOLUME;
+            if (i % 4 == 1) index = sectionIndex(side, a, b);
+            if (i % 4 == 2) index = sectionIndex(a, side, b);
+            if (i % 4 == 3) index = sectionIndex(a, b, side);
+            edits.push_back({ y, static_cast<uint16_t>(index), palette[rng() % 4] });
+        }
+        edit(rng() % size, rng() % size, std::move(edits));
+    }
+    // A checkerboard in the air section outgrows its range
+    int previous = overflows;
+    std::vector<BlockDelta::Edit> checkerboard;
+    for (int32_t y = 0; y < SECTION_SIZE; ++y) {
+        for (int32_t z = 0; z < SECTION_SIZE; ++z) {
+            for (int32_t x = (y + z) & 1; x < SECTION_SIZE; x += 2) {
+                checkerboard.push_back({ 2, static_cast<uint16_t>(sectionIndex(x, y, z)), palette[1] });
+            }
+        }
+    }
+    edit(1, 1, std::move(checkerboard));
+    if (overflows == previous) {
+        std::printf("checkerboard section fit its range\n");
+        ++failures;
+    }
+
+    for (int32_t z = 0; z < size; ++z) {
+        for (int32_t x = 0; x < size; ++x) {
+            ChunkMesh expected;
+            fresh(x, z, expected);
+            const ChunkMesh& mesh = meshes[z * size + x];
+            bool same = mesh.sections.size() == expected.sections.size();
+            for (size_t i = 0; same && i < mesh.sections.size(); ++i) {
+                same = sameSection(mesh, mesh.sections[i], expected, expected.sections[i]);
+            }
+            if (!same) {
+                std::printf("chunk %d %d differs after re-meshing in place\n", at(x, z)->pos.x, at(x, z)->pos.z);
+                ++failures;
+            }
+        }
+    }
+    std::printf("re-meshed sections: %d, overflows: %d\n", remeshed, overflows);
+    return failures;
+}
+
+int main() {
+    std::mt19937 rng(7);
+    const int32_t size = 4;
+    std::vector<std::shared_ptr<const Chunk>> chunks(size * size);
+    for (int32_t z = 0; z < size; ++z) {
+        for (int32_t x = 0; x < size; ++x) {
+            chunks[z * size + x] = randomChunk({ x - 1, z - 2 }, rng);
+        }
+    }
+    auto at = [&](int32_t x, int32_t z) -> std::shared_ptr<const Chunk> {
+        return x >= 0 && x < size && z >= 0 && z < size ? chunks[z * size + x] : nullptr;
+    };
+
+    TaskPool pool(4);
+    ParallelMesher parallel(pool);
+    parallel.reserve(64); // small, so worker outputs have to grow
+    ChunkMesher serial;
+    std::vector<ChunkMesh> meshes;
+    int failures = 0;
+    size_t triangles = 0;
+
+    // Two batches through the same mesher, the second one reuses the worker outputs
+    for (int batch = 0; batch < 2; ++batch) {
+        std::vector<ChunkPos> added;
+        for (int32_t z = 0; z < size; ++z) {
+            for (int32_t x = batch; x < size; x += 2) {
+                size_t index = parallel.add(at(x, z), at(x - 1, z), at(x + 1, z), at(x, z - 1), at(x, z + 1));
+                if (index != added.size()) {
+                    ++failures;
+                }
+                added.push_back({ x, z });
+            }
+        }
+        parallel.finish(meshes);
+        if (meshes.size() != added.size()) {
+            ++failures;
+            continue;
+        }
+
+        for (size_t i = 0; i < added.size(); ++i) {
+            int32_t x = added[i].x, z = added[i].z;
+            std::shared_ptr<const Chunk> negX = at(x - 1, z), posX = at(x + 1, z), negZ = at(x, z - 1), posZ = at(x, z + 1);
+            ChunkMesher::Neighbours neighbours = { negX.get(), posX.get(), negZ.get(), posZ.get() };
+            ChunkMesh expected;
+            serial.mesh(*at(x, z), neighbours, expected);
+            triangles += expected.triangles.size();
+            if (!sameMesh(meshes[i], expected)) {
+                std::printf("chunk %d %d differs from the serial mesh\n", at(x, z)->pos.x, at(x, z)->pos.z);
+                ++failures;
+            }
+        }
+    }
+
+    failures += checkRemesh(chunks, size, rng);
+
+    std::printf("chunks: %d, triangles: %zu, failures: %d\n", size * size, triangles, failures);
+    return failures == 0 ? 0 : 1;
+}
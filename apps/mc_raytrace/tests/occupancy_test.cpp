@@ -0,0 +1,318 @@
+// Compares OccupancyMap queries with brute force scans of the blocks, including lazy chunks whose
+// sections count as full
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string_view>
+#include <vector>
+#include "../BlockStateRegistry.h"
+#include "../ChunkMesher.h"
+#include "../LazySections.h"
+#include "../NbtReader.h"
+#include "../OccupancyMap.h"
+
+// Just enough big endian NBT for LazySections::makeChunk
+struct NbtWriter {
+    std::vector<uint8_t> bytes;
+
+    void u8(uint8_t v) { bytes.push_back(v); }
+    void i32(int32_t v) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            bytes.push_back(static_cast<uint8_t>(static_cast<uint32_t>(v) >> shift));
+        }
+    }
+    void i64(uint64_t v) {
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            bytes.push_back(static_cast<uint8_t>(v >> shift));
+        }
+    }
+    void string(std::string_view s) {
+        bytes.push_back(static_cast<uint8_t>(s.size() >> 8));
+        bytes.push_back(static_cast<uint8_t>(s.size()));
+        bytes.insert(bytes.end(), s.begin(), s.end());
+    }
+    void tag(uint8_t type, std::string_view name) {
+        u8(type);
+        string(name);
+    }
+};
+
+// Sections of a single block state, or of air with one block of stone at (5, 5, 5) when the name is empty
+static std::shared_ptr<Chunk> lazyChunk(ChunkPos pos, const std::vector<std::pair<int32_t, std::string_view>>& sections) {
+    NbtWriter w;
+    w.tag(nbt::TAG_Compound, "");
+    w.tag(nbt::TAG_Int, "DataVersion");
+    w.i32(3465);
+    w.tag(nbt::TAG_Int, "xPos");
+    w.i32(pos.x);
+    w.tag(nbt::TAG_Int, "zPos");
+    w.i32(pos.z);
+    w.tag(nbt::TAG_List, "sections");
+    w.u8(nbt::TAG_Compound);
+    w.i32(static_cast<int32_t>(sections.size()));
+    for (const auto& [y, uniform] : sections) {
+        bool withData = uniform.empty();
+        w.tag(nbt::TAG_Byte, "Y");
+        w.u8(static_cast<uint8_t>(y));
+        w.tag(nbt::TAG_Compound, "block_states");
+        w.tag(nbt::TAG_List, "palette");
+        w.u8(nbt::TAG_Compound);
+        w.i32(withData ? 2 : 1);
+        w.tag(nbt::TAG_String, "Name");
+        w.string(withData ? "minecraft:air" : uniform);
+        w.u8(nbt::TAG_End);
+        if (withData) {
+            w.tag(nbt::TAG_String, "Name");
+            w.string("minecraft:stone");
+            w.u8(nbt::TAG_End);
+            // 4 bits per block, 16 blocks per long
+            w.tag(nbt::TAG_Long_Array, "data");
+            w.i32(SECTION_VOLUME / 16);
+            uint32_t stone = sectionIndex(5, 5, 5);
+            for (uint32_t i = 0; i < SECTION_VOLUME / 16; ++i) {
+                w.i64(i == stone / 16 ? uint64_t(1) << ((stone % 16) * 4) : 0);
+            }
+        }
+        w.u8(nbt::TAG_End);
+        w.u8(nbt::TAG_End);
+    }
+    w.u8(nbt::TAG_End);
+    return LazySections::makeChunk(w.bytes.data(), w.bytes.size());
+}
+
+// What the map should see, resident chunks by position with lazy sections of block data as full
+struct BruteForce {
+    std::vector<std::shared_ptr<const Chunk>> chunks;
+
+    const Chunk* find(int32_t cx, int32_t cz) const {
+        for (const auto& chunk : chunks) {
+            if (chunk->pos.x == cx && chunk->pos.z == cz) {
+                return chunk.get();
+            }
+        }
+        return nullptr;
+    }
+    bool occupied(int32_t x, int32_t y, int32_t z) const {
+        const Chunk* chunk = find(x >> 4, z >> 4);
+        if (!chunk) {
+            return false;
+        }
+        if (chunk->lazy) {
+            int32_t i = chunk->lazy->find(y >> 4);
+            if (i >= 0 && chunk->lazy->hasBlockData(i)) {
+                return true;
+            }
+        }
+        const Section* section = chunk->section(y >> 4);
+        if (!section) {
+            return false;
+        }
+        const BlockState& state = BlockStateRegistry::instance().state(section->blockAt(x & 15, y & 15, z & 15));
+        return ChunkMesher::classify(state) != BlockMaterial::Invisible;
+    }
+    bool regionEmpty(BlockPos min, BlockPos max) const {
+        for (int32_t y = min.y; y <= max.y; ++y) {
+            for (int32_t z = min.z; z <= max.z; ++z) {
+                for (int32_t x = min.x; x <= max.x; ++x) {
+                    if (occupied(x, y, z)) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+};
+
+// Entry of a ray into a brick of 4x4x4 blocks within [tMin, tMax]
+static bool slab(const float origin[3], const float direction[3], const int32_t brick[3], float tMin, float tMax, float& tNear) {
+    float t0 = tMin, t1 = tMax;
+    for (int i = 0; i < 3; ++i) {
+        float lo = static_cast<float>(brick[i] * 4), hi = lo + 4.0f;
+        if (direction[i] == 0.0f) {
+            if (origin[i] < lo || origin[i] >= hi) {
+                return false;
+            }
+            continue;
+        }
+        float a = (lo - origin[i]) / direction[i];
+        float b = (hi - origin[i]) / direction[i];
+        t0 = std::max(t0, std::min(a, b));
+        t1 = std::min(t1, std::max(a, b));
+    }
+    tNear = t0;
+    return t0 <= t1;
+}
+
+int main() {
+    BlockStateRegistry& registry = BlockStateRegistry::instance();
+    const uint16_t palette[] = {
+        registry.id("minecraft:stone"),
+        registry.id("minecraft:water"),
+        registry.id("minecraft:barrier"), // invisible, does not occupy
+    };
+
+    // 3 x 3 columns around the origin, sections -1 to 2, sparse enough to leave most bricks empty.
+    // One column is missing, one is all air and one is lazy.
+    std::mt19937 rng(19);
+    BruteForce world;
+    OccupancyMap map;
+    for (int32_t cz = -1; cz < 2; ++cz) {
+        for (int32_t cx = -1; cx < 2; ++cx) {
+            if (cx == 1 && cz == -1) {
+                continue;
+            }
+            std::shared_ptr<Chunk> chunk;
+            if (cx == 1 && cz == 1) {
+                // Section 0 has block data and counts as full, 1 is uniform stone, 2 uniform air
+                chunk = lazyChunk({ cx, cz }, { { 0, "" }, { 1, "minecraft:stone" }, { 2, "minecraft:air" } });
+                if (!chunk) {
+                    std::printf("lazy chunk could not be read\n");
+                    return 1;
+                }
+            }
+            else {
+                chunk = std::make_shared<Chunk>();
+                chunk->pos = { cx, cz };
+                chunk->dataVersion = 3465;
+                for (int32_t sy = -1; sy < 3; ++sy) {
+                    uint16_t states[SECTION_VOLUME] = {};
+                    for (int32_t i = 0; !(cx == 0 && cz == -1) && sy != 1 && i < 24; ++i) {
+                        states[sectionIndex(rng() % 16, rng() % 16, rng() % 16)] = palette[rng() % 3];
+                    }
+                    chunk->sections.push_back(Section::pack(sy, states));
+                }
+            }
+            world.chunks.push_back(chunk);
+            map.insert(chunk->pos, OccupancyMap::build(*chunk));
+        }
+    }
+    // Uniform stone in the lazy chunk is decoded and exact
+    const Chunk* lazy = world.find(1, 1);
+    if (lazy->section(1)->palette[0] != palette[0]) {
+        std::printf("lazy uniform section did not decode\n");
+        return 1;
+    }
+
+    int failures = 0;
+    for (int32_t cz = -2; cz < 3; ++cz) {
+        for (int32_t cx = -2; cx < 3; ++cx) {
+            bool chunkEmpty = true;
+            for (int32_t sy = -2; sy < 4; ++sy) {
+                BlockPos min = { cx * 16, sy * 16, cz * 16 };
+                BlockPos max = { min.x + 15, min.y + 15, min.z + 15 };
+                bool expected = world.regionEmpty(min, max);
+                chunkEmpty &= expected;
+                if (map.isSectionEmpty({ cx, sy, cz }) != expected) {
+                    std::printf("section %d %d %d\n", cx, sy, cz);
+                    ++failures;
+                }
+            }
+            if (map.isChunkEmpty({ cx, cz }) != chunkEmpty) {
+                std::printf("chunk %d %d\n", cx, cz);
+                ++failures;
+            }
+        }
+    }
+
+    // Boxes of every size, some only cover the air next to the stone of the lazy section
+    const int regions = 4000;
+    int emptyRegions = 0;
+    for (int r = 0; r < regions; ++r) {
+        BlockPos min = { static_cast<int32_t>(rng() % 64) - 24, static_cast<int32_t>(rng() % 80) - 24, static_cast<int32_t>(rng() % 64) - 24 };
+        int32_t extent = r % 4 == 0 ? 20 : 5;
+        BlockPos max = { min.x + static_cast<int32_t>(rng() % extent), min.y + static_cast<int32_t>(rng() % extent), min.z + static_cast<int32_t>(rng() % extent) };
+        if (r % 10 == 0) {
+            min = { 16 + static_cast<int32_t>(rng() % 4), static_cast<int32_t>(rng() % 4), 16 + static_cast<int32_t>(rng() % 4) };
+            max = min;
+        }
+        bool expected = world.regionEmpty(min, max);
+        emptyRegions += expected;
+        if (map.isRegionEmpty(min, max) != expected) {
+            std::printf("region %d %d %d to %d %d %d\n", min.x, min.y, min.z, max.x, max.y, max.z);
+            ++failures;
+        }
+    }
+
+    // Every occupied brick, nextOccupied has to find the nearest one along the ray
+    std::vector<std::array<int32_t, 3>> bricks;
+    for (int32_t by = -8; by < 16; ++by) {
+        for (int32_t bz = -4; bz < 8; ++bz) {
+            for (int32_t bx = -4; bx < 8; ++bx) {
+                if (!world.regionEmpty({ bx * 4, by * 4, bz * 4 }, { bx * 4 + 3, by * 4 + 3, bz * 4 + 3 })) {
+                    bricks.push_back({ bx, by, bz });
+                }
+            }
+        }
+    }
+
+    const int rays = 3000;
+    int hits = 0;
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    for (int r = 0; r < rays; ++r) {
+        // Half of the rays start outside the bounds, half inside
+        float origin[3] = { uniform(rng) * 60.0f + 8.0f, uniform(rng) * 60.0f + 16.0f, uniform(rng) * 60.0f + 8.0f };
+        if (r % 2) {
+            origin[0] = uniform(rng) * 24.0f + 8.0f;
+            origin[1] = uniform(rng) * 32.0f + 16.0f;
+            origin[2] = uniform(rng) * 24.0f + 8.0f;
+        }
+        float direction[3] = { uniform(rng), uniform(rng), uniform(rng) };
+        if (r % 7 == 0) {
+            direction[r % 3] = 0.0f;
+        }
+        float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+        if (length == 0.0f) {
+            continue;
+        }
+        for (float& d : direction) {
+            d /= length;
+        }
+        float tMin = r % 3 == 0 ? uniform(rng) * 10.0f + 10.0f : 0.0f;
+        float tMax = r % 5 == 0 ? tMin + 20.0f : 1e30f;
+
+        float best = 1e30f;
+        bool expected = false;
+        for (const auto& brick : bricks) {
+            float t;
+            if (slab(origin, direction, brick.data(), tMin, tMax, t) && t < best) {
+                best = t;
+                expected = true;
+            }
+        }
+
+        OccupancyMap::Hit hit;
+        bool found = map.nextOccupied(origin, direction, tMin, tMax, hit);
+        if (found != expected) {
+            // A ray grazing the corner of a brick may go either way
+            if (!found || std::fabs(hit.t - tMax) > 1e-3f) {
+                ++failures;
+            }
+            continue;
+        }
+        if (!found) {
+            continue;
+        }
+        ++hits;
+        // Bricks touching at the entry point are all right, the found one has to be occupied
+        const int32_t at[3] = { hit.x, hit.y, hit.z };
+        float t;
+        bool occupied = std::find(bricks.begin(), bricks.end(), std::array<int32_t, 3>{ hit.x, hit.y, hit.z }) != bricks.end();
+        if (std::fabs(hit.t - best) > 1e-3f || !occupied || !slab(origin, direction, at, tMin, tMax, t)) {
+            ++failures;
+        }
+    }
+
+    // Clearing the lazy section through an edit makes its air exact again
+    uint16_t air[SECTION_VOLUME] = {};
+    map.updateSection({ 1, 1 }, *Section::pack(0, air));
+    if (!map.isRegionEmpty({ 16, 0, 16 }, { 31, 15, 31 }) || map.isSectionEmpty({ 1, 1, 1 })) {
+        ++failures;
+    }
+
+    std::printf("regions: %d, empty: %d, rays: %d, hits: %d, failures: %d\n", regions, emptyRegions, rays, hits, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+// Compares traceVoxels against a brute force slab test of every solid block, then renders a small reference image
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../BlockStateRegistry.h"
+#include "../ReferenceRenderer.h"
+#include "../VoxelWorld.h"
+
+struct SolidBlock {
+    int32_t x, y, z;
+    uint16_t state;
+};
+
+static bool slab(const float origin[3], const float direction[3], const SolidBlock& block, float& tNear) {
+    const int32_t p[3] = { block.x, block.y, block.z };
+    float t0 = 0.0f, t1 = 1e30f;
+    for (int i = 0; i < 3; ++i) {
+        if (direction[i] == 0.0f) {
+            if (origin[i] < p[i] || origin[i] >= p[i] + 1) {
+                return false;
+            }
+            continue;
+        }
+        float a = (p[i] - origin[i]) / direction[i];
+        float b = (p[i] + 1 - origin[i]) / direction[i];
+        t0 = std::max(t0, std::min(a, b));
+        t1 = std::min(t1, std::max(a, b));
+    }
+    tNear = t0;
+    return t0 <= t1;
+}
+
+int main() {
+    BlockStateRegistry& registry = BlockStateRegistry::instance();
+    const uint16_t palette[] = {
+        registry.id("minecraft:stone"),
+        registry.id("minecraft:dirt"),
+        registry.id("minecraft:glass"),
+        registry.id("minecraft:barrier"), // invisible, rays pass through
+    };
+
+    // 3 x 2 columns with one missing, sections -1 to 2 with section 1 left empty
+    std::mt19937 rng(42);
+    std::vector<std::shared_ptr<const Chunk>> chunks;
+    std::vector<SolidBlock> solid;
+    for (int32_t cz = -1; cz < 1; ++cz) {
+        for (int32_t cx = -1; cx < 2; ++cx) {
+            if (cx == 1 && cz == -1) {
+                continue;
+            }
+            auto chunk = std::make_shared<Chunk>();
+            chunk->pos = { cx, cz };
+            chunk->dataVersion = 3465;
+            for (int32_t sy = -1; sy < 3; ++sy) {
+                uint16_t states[SECTION_VOLUME] = {};
+                for (int32_t i = 0; sy != 1 && i < 60; ++i) {
+                    states[sectionIndex(rng() % 16, rng() % 16, rng() % 16)] = palette[rng() % 4];
+                }
+                for (int32_t y = 0; y < 16; ++y) {
+                    for (int32_t z = 0; z < 16; ++z) {
+                        for (int32_t x = 0; x < 16; ++x) {
+                            uint16_t state = states[sectionIndex(x, y, z)];
+                            if (state != BlockStateRegistry::AIR && state != palette[3]) {
+                                solid.push_back({ cx * 16 + x, sy * 16 + y, cz * 16 + z, state });
+                            }
+                        }
+                    }
+                }
+                chunk->sections.push_back(Section::pack(sy, states));
+            }
+            chunks.push_back(chunk);
+        }
+    }
+
+    VoxelWorld world;
+    world.build(chunks);
+    const VoxelWorldView& view = world.view();
+
+    const int rays = 3000;
+    int hits = 0;
+    int failures = 0;
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    for (int r = 0; r < rays; ++r) {
+        // Half of the rays start outside the grid, half inside
+        float origin[3] = { uniform(rng) * 40.0f, uniform(rng) * 40.0f + 16.0f, uniform(rng) * 40.0f };
+        if (r % 2) {
+            origin[0] = uniform(rng) * 20.0f;
+            origin[1] = uniform(rng) * 20.0f + 10.0f;
+            origin[2] = uniform(rng) * 14.0f - 4.0f;
+        }
+        float direction[3] = { uniform(rng), uniform(rng), uniform(rng) };
+        if (r % 7 == 0) {
+            direction[r % 3] = 0.0f;
+        }
+        float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+        if (length == 0.0f) {
+            continue;
+        }
+        for (float& d : direction) {
+            d /= length;
+        }
+
+        float best = 1e30f;
+        bool expected = false;
+        for (const SolidBlock& block : solid) {
+            float t;
+            if (slab(origin, direction, block, t) && t < best) {
+                best = t;
+                expected = true;
+            }
+        }
+
+        VoxelHit hit;
+        bool found = traceVoxels(view, origin, direction, 0.0f, 1e30f, hit);
+        if (found != expected) {
+            ++failures;
+            continue;
+        }
+        if (!found) {
+            continue;
+        }
+        ++hits;
+        // Two blocks at the same distance may both be right, compare t and the state at the hit
+        if (std::fabs(hit.t - best) > 1e-3f || hit.state != voxel::blockState(view, hit.x, hit.y, hit.z)) {
+            ++failures;
+        }
+    }
+    std::printf("rays: %d, hits: %d, failures: %d\n", rays, hits, failures);
+
+    ReferenceCamera camera = { { -30.0f, 60.0f, -30.0f }, { 8.0f, 8.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 50.0f };
+    std::vector<uint32_t> pixels;
+    renderReference(view, camera, 64, 48, pixels);
+    size_t background = std::count(pixels.begin(), pixels.end(), pixels[0]);
+    std::printf("reference image: %zu pixels, %zu background\n", pixels.size(), background);
+    if (pixels.size() != 64 * 48 || background == pixels.size()) {
+        ++failures;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
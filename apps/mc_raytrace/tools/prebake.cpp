@@ -0,0 +1,103 @@
+// Bakes every chunk of a saved world into a chunk cache the renderer can map directly.
+//
+//   mc_raytrace_prebake <world directory> <output cache> [--dimension <dir>] [--threads <n>]
+//
+// --dimension picks the folder holding region/, e.g. DIM-1 for the nether. Defaults to the world root.
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ChunkCache.h"
+#include "DataManager.h"
+
+namespace fs = std::filesystem;
+
+static int usage() {
+    std::cerr << "usage: mc_raytrace_prebake <world directory> <output cache> [--dimension <dir>] [--threads <n>]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        return usage();
+    }
+    fs::path world = argv[1];
+    std::string output = argv[2];
+    fs::path dimension;
+    uint32_t threads = 0;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--dimension") == 0) {
+            dimension = argv[i + 1];
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0) {
+            threads = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else {
+            return usage();
+        }
+    }
+
+    fs::path regionDir = world / dimension / "region";
+    std::error_code error;
+    std::vector<fs::path> regions;
+    for (const fs::directory_entry& entry : fs::directory_iterator(regionDir, error)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".mca") {
+            regions.push_back(entry.path());
+        }
+    }
+    if (error || regions.empty()) {
+        std::cerr << "No region files in " << regionDir << std::endl;
+        return 1;
+    }
+    std::sort(regions.begin(), regions.end());
+
+    ChunkCacheWriter writer;
+    if (!writer.open(output)) {
+        return 1;
+    }
+
+    // A region is at most 1024 chunks, keep them all resident until they are written. The cache
+    // stores blocks only, nothing is lit.
+    DataManager dataManager;
+    dataManager.setup(RegionFile::CHUNKS_PER_SIDE * RegionFile::CHUNKS_PER_SIDE, threads);
+    dataManager.setLighting(false);
+
+    std::vector<ChangeEvent> events;
+    size_t regionNr = 0;
+    for (const fs::path& region : regions) {
+        size_t submitted = dataManager.loadRegion(region.string());
+        dataManager.flush();
+
+        events.clear();
+        if (dataManager.drainChanges(events)) {
+            std::cerr << "Change journal overflowed while baking " << region << std::endl;
+            return 1;
+        }
+        size_t written = 0;
+        for (const ChangeEvent& event : events) {
+            if (event.type != ChangeEvent::Type::ChunkLoaded) {
+                continue;
+            }
+            std::shared_ptr<const Chunk> chunk = dataManager.worldStore().find({ event.pos.x, event.pos.z });
+            if (chunk && writer.add(*chunk)) {
+                ++written;
+            }
+        }
+        // Along with their occupancy, only one region is ever resident
+        dataManager.unloadAll();
+
+        std::cout << "[" << ++regionNr << "/" << regions.size() << "] " << region.filename().string()
+                  << ": " << written << " of " << submitted << " chunks" << std::endl;
+    }
+    dataManager.close();
+
+    if (!writer.finish()) {
+        std::cerr << "Failed to write " << output << std::endl;
+        return 1;
+    }
+    std::cout << "Baked " << writer.size() << " chunks into " << output << std::endl;
+    return 0;
+}